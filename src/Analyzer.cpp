@@ -0,0 +1,329 @@
+#include <algorithm>
+#include "Analyzer.h"
+
+static const uint16_t ROM_START = 0x200;
+static const size_t ADDRESS_SPACE = 4096;
+
+Analysis::Analysis() : rom_end(ROM_START) {}
+
+uint16_t Analysis::opcode(uint16_t addr) const {
+    return (uint16_t) ((this->memory[addr] << 8u) | this->memory[addr + 1]);
+}
+
+bool Analysis::analyze(const uint8_t *rom, size_t size) {
+    this->memory.assign(ADDRESS_SPACE, 0);
+    this->flags.assign(ADDRESS_SPACE, 0);
+    this->rom_end = ROM_START;
+    this->basic_blocks.clear();
+    this->subroutine_addresses.clear();
+    this->indirect_jumps.clear();
+    this->unknown_opcodes.clear();
+    this->self_modifying_writes.clear();
+    if (size > ADDRESS_SPACE - ROM_START) {
+        return false;
+    }
+
+    std::copy(rom, rom + size, this->memory.begin() + ROM_START);
+    this->rom_end = (uint16_t) (ROM_START + size);
+
+    std::vector<uint16_t> pending{ROM_START};
+    this->flags[ROM_START] |= LEADER;
+    while (!pending.empty()) {
+        uint16_t start = pending.back();
+        pending.pop_back();
+        this->trace(start, pending);
+    }
+
+    std::sort(this->subroutine_addresses.begin(), this->subroutine_addresses.end());
+    this->subroutine_addresses.erase(std::unique(this->subroutine_addresses.begin(), this->subroutine_addresses.end()),
+                                     this->subroutine_addresses.end());
+    std::sort(this->indirect_jumps.begin(), this->indirect_jumps.end());
+    std::sort(this->unknown_opcodes.begin(), this->unknown_opcodes.end());
+
+    this->buildBlocks();
+    return true;
+}
+
+void Analysis::trace(uint16_t start, std::vector<uint16_t> &pending) {
+    auto branch = [this, &pending](uint16_t target) {
+        if (target < ADDRESS_SPACE) {
+            this->flags[target] |= LEADER;
+            pending.push_back(target);
+        }
+    };
+
+    // instructions have to lie entirely inside the ROM; anything else is never reached by a sane ROM
+    for (uint16_t pc = start; pc >= ROM_START && pc + 2 <= this->rom_end; pc += 2) {
+        if (this->flags[pc] & INSTRUCTION) {
+            // joining code traced before, so a block has to start here
+            this->flags[pc] |= LEADER;
+            return;
+        }
+        this->flags[pc] |= INSTRUCTION | CODE;
+        this->flags[pc + 1] |= CODE;
+
+        Instruction inst = decode(this->opcode(pc));
+        switch (inst.op) {
+            case Op::JP:
+                branch(inst.nnn);
+                return;
+            case Op::CALL:
+                this->subroutine_addresses.push_back(inst.nnn);
+                if (inst.nnn < ADDRESS_SPACE) {
+                    this->flags[inst.nnn] |= SUBROUTINE;
+                }
+                branch(inst.nnn);
+                branch(pc + 2);
+                return;
+            case Op::RET:
+                return;
+            case Op::JP_V0:
+                this->indirect_jumps.push_back(pc);
+                return;
+            case Op::SE_VX_NN:
+            case Op::SNE_VX_NN:
+            case Op::SE_VX_VY:
+            case Op::SNE_VX_VY:
+            case Op::SKP:
+            case Op::SKNP:
+                branch(pc + 2);
+                branch(pc + 4);
+                return;
+            case Op::Unknown:
+            case Op::SYS:
+                this->unknown_opcodes.push_back(pc);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void Analysis::buildBlocks() {
+    for (uint16_t start = ROM_START; start < this->rom_end; ++start) {
+        if ((this->flags[start] & (INSTRUCTION | LEADER)) != (INSTRUCTION | LEADER)) {
+            continue;
+        }
+
+        BasicBlock block{start, start, {}};
+        // I is only tracked from LD I within the block; at its start it could be anything
+        bool i_known = false;
+        uint16_t i = 0;
+        uint16_t pc = start;
+        bool ends = false;
+        while (!ends) {
+            Instruction inst = decode(this->opcode(pc));
+            uint8_t written = 0;
+            switch (inst.op) {
+                case Op::JP:
+                    block.successors = {inst.nnn};
+                    ends = true;
+                    break;
+                case Op::CALL:
+                    block.successors = {inst.nnn, (uint16_t) (pc + 2)};
+                    ends = true;
+                    break;
+                case Op::RET:
+                case Op::JP_V0:
+                    ends = true;
+                    break;
+                case Op::SE_VX_NN:
+                case Op::SNE_VX_NN:
+                case Op::SE_VX_VY:
+                case Op::SNE_VX_VY:
+                case Op::SKP:
+                case Op::SKNP:
+                    block.successors = {(uint16_t) (pc + 2), (uint16_t) (pc + 4)};
+                    ends = true;
+                    break;
+                case Op::LD_I:
+                    i_known = true;
+                    i = inst.nnn;
+                    break;
+                case Op::ADD_I_VX:
+                case Op::LD_F_VX:
+                    i_known = false;
+                    break;
+                case Op::LD_B_VX:
+                    written = 3;
+                    break;
+                case Op::LD_I_VX:
+                    written = (uint8_t) (inst.x + 1);
+                    break;
+                default:
+                    break;
+            }
+
+            if (written > 0 && i_known) {
+                for (unsigned addr = i; addr < i + written && addr < ADDRESS_SPACE; ++addr) {
+                    if (this->flags[addr] & CODE) {
+                        this->self_modifying_writes.push_back(SelfModifyingWrite{pc, i, written});
+                        break;
+                    }
+                }
+            }
+            if (inst.op == Op::LD_I_VX || inst.op == Op::LD_VX_I) {
+                // whether these move I past the registers depends on the quirk profile
+                i_known = false;
+            }
+
+            pc += 2;
+            if (!ends && (pc + 2 > this->rom_end || !(this->flags[pc] & INSTRUCTION))) {
+                // ran off the end of the ROM
+                ends = true;
+            } else if (!ends && (this->flags[pc] & LEADER)) {
+                block.successors = {pc};
+                ends = true;
+            }
+        }
+
+        block.end = pc;
+        std::sort(block.successors.begin(), block.successors.end());
+        block.successors.erase(std::unique(block.successors.begin(), block.successors.end()), block.successors.end());
+        this->basic_blocks.push_back(block);
+    }
+}
+
+bool Analysis::isInstruction(uint16_t addr) const {
+    return addr < this->flags.size() && (this->flags[addr] & INSTRUCTION);
+}
+
+bool Analysis::isCode(uint16_t addr) const {
+    return addr < this->flags.size() && (this->flags[addr] & CODE);
+}
+
+std::vector<uint16_t> Analysis::instructions() const {
+    std::vector<uint16_t> out;
+    for (uint16_t addr = ROM_START; addr < this->rom_end; ++addr) {
+        if (this->flags[addr] & INSTRUCTION) {
+            out.push_back(addr);
+        }
+    }
+    return out;
+}
+
+const std::vector<BasicBlock> &Analysis::blocks() const {
+    return this->basic_blocks;
+}
+
+const std::vector<uint16_t> &Analysis::subroutines() const {
+    return this->subroutine_addresses;
+}
+
+const std::vector<uint16_t> &Analysis::indirectJumps() const {
+    return this->indirect_jumps;
+}
+
+const std::vector<uint16_t> &Analysis::unknownOpcodes() const {
+    return this->unknown_opcodes;
+}
+
+const std::vector<SelfModifyingWrite> &Analysis::selfModifyingWrites() const {
+    return this->self_modifying_writes;
+}
+
+std::vector<std::pair<uint16_t, uint16_t>> Analysis::dataRegions() const {
+    std::vector<std::pair<uint16_t, uint16_t>> regions;
+    for (uint16_t addr = ROM_START; addr < this->rom_end; ++addr) {
+        if (this->flags[addr] & CODE) {
+            continue;
+        }
+        if (!regions.empty() && regions.back().second == addr) {
+            regions.back().second++;
+        } else {
+            regions.emplace_back(addr, addr + 1);
+        }
+    }
+    return regions;
+}
+
+static bool writeAddresses(FILE *file, const char *name, const std::vector<uint16_t> &addresses) {
+    bool written = fprintf(file, ",\n  \"%s\": [", name) > 0;
+    const char *separator = "";
+    for (uint16_t addr : addresses) {
+        written &= fprintf(file, "%s%u", separator, addr) > 0;
+        separator = ", ";
+    }
+    written &= fprintf(file, "]") > 0;
+    return written;
+}
+
+bool Analysis::writeJson(FILE *file) const {
+    std::vector<uint16_t> code = this->instructions();
+    size_t code_bytes = (size_t) std::count_if(this->flags.begin(), this->flags.end(), [](uint8_t flags) {
+        return (flags & CODE) != 0;
+    });
+    bool written = fprintf(file, "{\n  \"size\": %u,\n  \"instructions\": %zu,\n  \"code_bytes\": %zu",
+                           this->rom_end - ROM_START, code.size(), code_bytes) > 0;
+
+    written &= fprintf(file, ",\n  \"data\": [") > 0;
+    const char *separator = "";
+    for (auto &region : this->dataRegions()) {
+        written &= fprintf(file, "%s{\"start\": %u, \"end\": %u}", separator, region.first, region.second) > 0;
+        separator = ", ";
+    }
+    written &= fprintf(file, "]") > 0;
+
+    written &= writeAddresses(file, "subroutines", this->subroutine_addresses);
+    written &= writeAddresses(file, "indirect_jumps", this->indirect_jumps);
+    written &= writeAddresses(file, "unknown_opcodes", this->unknown_opcodes);
+
+    written &= fprintf(file, ",\n  \"self_modifying_writes\": [") > 0;
+    separator = "";
+    for (auto &write : this->self_modifying_writes) {
+        written &= fprintf(file, "%s{\"pc\": %u, \"target\": %u, \"length\": %u}", separator, write.pc, write.target,
+                           write.length) > 0;
+        separator = ", ";
+    }
+
+    written &= fprintf(file, "],\n  \"blocks\": [") > 0;
+    separator = "\n";
+    for (auto &block : this->basic_blocks) {
+        written &= fprintf(file, "%s    {\"start\": %u, \"end\": %u, \"successors\": [", separator, block.start,
+                           block.end) > 0;
+        for (size_t i = 0; i < block.successors.size(); ++i) {
+            written &= fprintf(file, i == 0 ? "%u" : ", %u", block.successors[i]) > 0;
+        }
+        written &= fprintf(file, "]}") > 0;
+        separator = ",\n";
+    }
+
+    written &= fprintf(file, "\n  ],\n  \"disassembly\": [") > 0;
+    separator = "\n";
+    char text[32];
+    for (uint16_t addr : code) {
+        disassemble(this->opcode(addr), text, sizeof(text));
+        written &= fprintf(file, "%s    {\"address\": %u, \"opcode\": \"%04X\", \"text\": \"%s\"}", separator, addr,
+                           this->opcode(addr), text) > 0;
+        separator = ",\n";
+    }
+    written &= fprintf(file, "\n  ]\n}") > 0;
+    return written;
+}
+
+bool Analysis::writeListing(FILE *file) const {
+    bool written = true;
+    char text[32];
+    uint16_t addr = ROM_START;
+    while (addr < this->rom_end) {
+        if (this->flags[addr] & INSTRUCTION) {
+            if (this->flags[addr] & SUBROUTINE) {
+                written &= fprintf(file, "\nsub_%03X:\n", addr) > 0;
+            } else if (this->flags[addr] & LEADER) {
+                written &= fprintf(file, "loc_%03X:\n", addr) > 0;
+            }
+            disassemble(this->opcode(addr), text, sizeof(text));
+            written &= fprintf(file, "  %03X  %04X  %s\n", addr, this->opcode(addr), text) > 0;
+            addr += 2;
+            continue;
+        }
+
+        // data runs up to the next instruction, eight bytes to a line
+        written &= fprintf(file, "  %03X        DB", addr) > 0;
+        for (int i = 0; i < 8 && addr < this->rom_end && !(this->flags[addr] & INSTRUCTION); ++i, ++addr) {
+            written &= fprintf(file, i == 0 ? " 0x%02X" : ", 0x%02X", this->memory[addr]) > 0;
+        }
+        written &= fprintf(file, "\n") > 0;
+    }
+    return written;
+}
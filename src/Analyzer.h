@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <utility>
+#include <vector>
+#include "Instruction.h"
+
+/**
+ * A run of instructions that is only ever entered at start and left after its last instruction
+ */
+struct BasicBlock {
+    uint16_t start;
+
+    /**
+     * The address after the last instruction
+     */
+    uint16_t end;
+
+    /**
+     * Where execution can continue after the block, in ascending order. Calls lead to the subroutine
+     * and to the instruction after the call, which the subroutine returns to.
+     */
+    std::vector<uint16_t> successors;
+};
+
+/**
+ * An FX33 or FX55 whose I is known, writing length bytes at target, some of which are reachable code
+ */
+struct SelfModifyingWrite {
+    uint16_t pc;
+    uint16_t target;
+    uint8_t length;
+};
+
+/**
+ * Static analysis of a ROM as loaded at 0x200.
+ *
+ * Disassembles from 0x200, following jumps, calls, returns and both outcomes of every skip, into a
+ * control-flow graph of basic blocks. Everything reached is code, the rest of the ROM is data.
+ * BNNN jumps to an address only known at run time, so ROMs using it may reach code the analysis misses;
+ * these jumps are reported. I is tracked within each block, so FX33 and FX55 storing into code,
+ * usually self-modifying code, are reported too.
+ *
+ * Instructions are decoded as Cpu does: unknown opcodes are skipped and execution continues after them,
+ * which the analysis follows up to the end of the ROM.
+ */
+class Analysis {
+public:
+    Analysis();
+
+    /**
+     * Analyzes a ROM, replacing any previous results.
+     * Returns false, leaving the analysis empty, if it does not fit between 0x200 and 0xFFF.
+     */
+    bool analyze(const uint8_t *rom, size_t size);
+
+    /**
+     * Returns true if an instruction reached by the analysis starts at addr
+     */
+    bool isInstruction(uint16_t addr) const;
+
+    /**
+     * Returns true if addr holds either byte of a reachable instruction
+     */
+    bool isCode(uint16_t addr) const;
+
+    /**
+     * Every reachable instruction address, in ascending order
+     */
+    std::vector<uint16_t> instructions() const;
+
+    /**
+     * The basic blocks, ordered by start address
+     */
+    const std::vector<BasicBlock> &blocks() const;
+
+    /**
+     * The targets of 2NNN, in ascending order
+     */
+    const std::vector<uint16_t> &subroutines() const;
+
+    /**
+     * The reachable BNNN instructions
+     */
+    const std::vector<uint16_t> &indirectJumps() const;
+
+    /**
+     * Reachable instructions that decode to Op::Unknown, which Cpu skips
+     */
+    const std::vector<uint16_t> &unknownOpcodes() const;
+
+    const std::vector<SelfModifyingWrite> &selfModifyingWrites() const;
+
+    /**
+     * The parts of the ROM that are not code, as [start, end) address pairs in ascending order
+     */
+    std::vector<std::pair<uint16_t, uint16_t>> dataRegions() const;
+
+    /**
+     * Writes every result, including a disassembly of the reachable instructions, as a JSON object
+     */
+    bool writeJson(FILE *file) const;
+
+    /**
+     * Writes a listing of the whole ROM: labelled instructions where there is code, bytes elsewhere
+     */
+    bool writeListing(FILE *file) const;
+
+private:
+    enum Flags : uint8_t {
+        INSTRUCTION = 1u << 0u,
+        CODE = 1u << 1u,
+        SUBROUTINE = 1u << 2u,
+        LEADER = 1u << 3u,
+    };
+
+    /**
+     * The ROM at its load address, and flags for every address
+     */
+    std::vector<uint8_t> memory;
+    std::vector<uint8_t> flags;
+    uint16_t rom_end;
+
+    std::vector<BasicBlock> basic_blocks;
+    std::vector<uint16_t> subroutine_addresses;
+    std::vector<uint16_t> indirect_jumps;
+    std::vector<uint16_t> unknown_opcodes;
+    std::vector<SelfModifyingWrite> self_modifying_writes;
+
+    uint16_t opcode(uint16_t addr) const;
+
+    /**
+     * Marks the instructions reachable from start, queueing the targets of branches
+     */
+    void trace(uint16_t start, std::vector<uint16_t> &pending);
+
+    /**
+     * Splits the marked instructions into blocks and tracks I through each
+     */
+    void buildBlocks();
+};
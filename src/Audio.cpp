@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <cmath>
+#include "Audio.h"
+
+constexpr size_t Buzzer::TABLE_SIZE;
+
+// the timers tick at 60 Hz, so a frame of cycles_per_frame cycles lasts 1/60 s
+static const double FRAME_RATE = 60.0;
+
+static const float AMPLITUDE = 0.25f;
+
+static const double FADE_SECONDS = 0.001;
+
+static const double PI = 3.14159265358979323846;
+
+void NullSink::write(const float *samples, size_t count) {
+    this->samples.insert(this->samples.end(), samples, samples + count);
+}
+
+RingSink::RingSink(size_t capacity, size_t max_queued) : head(0), tail(0), dropped_samples(0), underrun_count(0) {
+    this->capacity = 1;
+    while (this->capacity < capacity) {
+        this->capacity <<= 1u;
+    }
+    this->max_queued = std::min(max_queued, this->capacity);
+    this->samples.reset(new float[this->capacity]);
+}
+
+void RingSink::write(const float *samples, size_t count) {
+    size_t head = this->head.load(std::memory_order_relaxed);
+    size_t queued = head - this->tail.load(std::memory_order_acquire);
+    size_t accepted = queued >= this->max_queued ? 0 : std::min(count, this->max_queued - queued);
+
+    for (size_t i = 0; i < accepted; ++i) {
+        this->samples[(head + i) & (this->capacity - 1)] = samples[i];
+    }
+    this->head.store(head + accepted, std::memory_order_release);
+
+    if (accepted < count) {
+        this->dropped_samples.fetch_add(count - accepted, std::memory_order_relaxed);
+    }
+}
+
+size_t RingSink::read(float *out, size_t count) {
+    size_t tail = this->tail.load(std::memory_order_relaxed);
+    size_t available = this->head.load(std::memory_order_acquire) - tail;
+    size_t taken = std::min(available, count);
+
+    for (size_t i = 0; i < taken; ++i) {
+        out[i] = this->samples[(tail + i) & (this->capacity - 1)];
+    }
+    std::fill(out + taken, out + count, 0.0f);
+
+    this->tail.store(tail + taken, std::memory_order_release);
+    if (taken < count) {
+        this->underrun_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    return taken;
+}
+
+size_t RingSink::queued() const {
+    return this->head.load(std::memory_order_acquire) - this->tail.load(std::memory_order_acquire);
+}
+
+uint64_t RingSink::dropped() const {
+    return this->dropped_samples.load(std::memory_order_relaxed);
+}
+
+uint64_t RingSink::underruns() const {
+    return this->underrun_count.load(std::memory_order_relaxed);
+}
+
+Buzzer::Buzzer(AudioSink &sink, uint32_t sample_rate, double frequency) :
+        sink(sink), sample_rate(sample_rate), phase(0), on(false), gain(0), rendered_cycle(0), sample_offset(0) {
+    // a square wave is the sum of its odd harmonics; leaving out those above the Nyquist frequency
+    // keeps it from aliasing
+    float peak = 0;
+    for (size_t i = 0; i < TABLE_SIZE; ++i) {
+        double x = 2 * PI * i / TABLE_SIZE;
+        double value = 0;
+        for (int k = 1; k * frequency < sample_rate / 2.0; k += 2) {
+            value += std::sin(k * x) / k;
+        }
+        this->table[i] = (float) value;
+        peak = std::max(peak, std::fabs(this->table[i]));
+    }
+    for (float &value : this->table) {
+        value = peak > 0 ? value / peak : 0;
+    }
+
+    this->phase_step = (uint32_t) (frequency / sample_rate * 4294967296.0);
+    this->gain_step = (float) (1.0 / std::max(1.0, FADE_SECONDS * sample_rate));
+}
+
+uint32_t Buzzer::sampleRate() const {
+    return this->sample_rate;
+}
+
+void Buzzer::onSound(uint64_t cycle, uint64_t end) {
+    // the new timer value replaces whatever the old one had scheduled from here on
+    while (!this->edges.empty() && this->edges.back().cycle >= cycle) {
+        this->edges.pop_back();
+    }
+    this->edges.push_back(Edge{cycle, end > cycle});
+    if (end > cycle) {
+        this->edges.push_back(Edge{end, false});
+    }
+}
+
+void Buzzer::sync(const Cpu &cpu) {
+    this->edges.clear();
+    this->on = false;
+    this->rendered_cycle = cpu.cycles;
+    this->sample_offset = 0;
+    if (cpu.soundTimer() > 0) {
+        this->edges.push_back(Edge{cpu.cycles, true});
+        this->edges.push_back(Edge{cpu.soundEnd(), false});
+    }
+}
+
+void Buzzer::render(const Cpu &cpu) {
+    if (cpu.cycles < this->rendered_cycle) {
+        this->sync(cpu);
+        return;
+    }
+
+    double per_cycle = this->sample_rate / (FRAME_RATE * cpu.cyclesPerFrame());
+    // the index of the first sample at or after cycle, counting from the next sample to be rendered,
+    // which lies sample_offset samples after rendered_cycle
+    auto sampleAt = [this, per_cycle](uint64_t cycle) {
+        double position = (double) (cycle - this->rendered_cycle) * per_cycle - this->sample_offset;
+        return position > 0 ? (size_t) std::ceil(position) : (size_t) 0;
+    };
+
+    size_t count = sampleAt(cpu.cycles);
+    this->buffer.clear();
+    while (!this->edges.empty() && this->edges.front().cycle <= cpu.cycles) {
+        this->synthesize(std::min(sampleAt(this->edges.front().cycle), count) - this->buffer.size());
+        this->on = this->edges.front().on;
+        this->edges.pop_front();
+    }
+    this->synthesize(count - this->buffer.size());
+
+    this->sample_offset += count - (double) (cpu.cycles - this->rendered_cycle) * per_cycle;
+    this->rendered_cycle = cpu.cycles;
+    if (!this->buffer.empty()) {
+        this->sink.write(this->buffer.data(), this->buffer.size());
+    }
+}
+
+void Buzzer::synthesize(size_t count) {
+    static const unsigned FRACTION_BITS = 22;
+    static_assert(TABLE_SIZE << FRACTION_BITS == 1ull << 32u, "the phase spans the table");
+
+    for (size_t i = 0; i < count; ++i) {
+        this->gain = this->on ? std::min(1.0f, this->gain + this->gain_step) : std::max(0.0f, this->gain - this->gain_step);
+        if (this->gain == 0) {
+            // every tone starts at the same phase
+            this->phase = 0;
+            this->buffer.push_back(0.0f);
+            continue;
+        }
+
+        uint32_t index = this->phase >> FRACTION_BITS;
+        float fraction = (float) (this->phase & ((1u << FRACTION_BITS) - 1)) / (1u << FRACTION_BITS);
+        float a = this->table[index];
+        float b = this->table[(index + 1) & (TABLE_SIZE - 1)];
+        this->buffer.push_back((a + (b - a) * fraction) * this->gain * AMPLITUDE);
+        this->phase += this->phase_step;
+    }
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+#include "Cpu.h"
+
+/**
+ * Where rendered audio goes: mono float samples in [-1, 1]
+ */
+class AudioSink {
+public:
+    virtual ~AudioSink() = default;
+
+    /**
+     * Takes count samples following the ones written before
+     */
+    virtual void write(const float *samples, size_t count) = 0;
+};
+
+/**
+ * Keeps every sample written, for tests and offline rendering
+ */
+class NullSink : public AudioSink {
+public:
+    void write(const float *samples, size_t count) override;
+
+    std::vector<float> samples;
+};
+
+/**
+ * Lock-free single-producer single-consumer ring of samples, drained by an audio device callback.
+ *
+ * The emulation thread writes a frame of samples at a time. To bound latency, at most max_queued samples
+ * wait to be played; the samples of a write that do not fit are dropped. The device callback reads through
+ * read(), which never allocates, locks or blocks, and plays silence when the ring runs dry.
+ */
+class RingSink : public AudioSink {
+public:
+    /**
+     * Creates a ring holding capacity samples, rounded up to a power of two
+     */
+    RingSink(size_t capacity, size_t max_queued);
+
+    RingSink(const RingSink &) = delete;
+    RingSink &operator=(const RingSink &) = delete;
+
+    /**
+     * Called by the producer only
+     */
+    void write(const float *samples, size_t count) override;
+
+    /**
+     * Fills out with count samples, padding with silence once the ring is empty; called by the
+     * consumer only. Returns the number of samples taken from the ring.
+     */
+    size_t read(float *out, size_t count);
+
+    /**
+     * The number of samples waiting to be read
+     */
+    size_t queued() const;
+
+    /**
+     * Samples dropped to bound latency or because the ring was full
+     */
+    uint64_t dropped() const;
+
+    /**
+     * Reads that ran out of samples and were padded with silence
+     */
+    uint64_t underruns() const;
+
+private:
+    size_t capacity;
+    size_t max_queued;
+    std::unique_ptr<float[]> samples;
+    std::atomic<size_t> head;
+    std::atomic<size_t> tail;
+    std::atomic<uint64_t> dropped_samples;
+    std::atomic<uint64_t> underrun_count;
+};
+
+/**
+ * Renders the buzzer, which sounds while the sound timer is non-zero, as a band-limited square wave.
+ *
+ * Attached to a Cpu as its SoundListener, the buzzer learns the exact cycles every tone starts and
+ * stops at; render() then turns the cycles run since the last call into samples, so the edges land on
+ * the samples matching those cycles. One period of the tone is precomputed from the odd harmonics
+ * below the Nyquist frequency, so it does not alias, and edges fade over a millisecond to avoid clicks.
+ */
+class Buzzer : public SoundListener {
+public:
+    Buzzer(AudioSink &sink, uint32_t sample_rate, double frequency = 440.0);
+
+    void onSound(uint64_t cycle, uint64_t end) override;
+
+    /**
+     * Renders the cycles cpu ran since the last call into the sink. Call it at the end of every frame.
+     */
+    void render(const Cpu &cpu);
+
+    /**
+     * Continues from cpu's current cycle and sound timer, without rendering the cycles in between,
+     * e.g. after a state was loaded or rewound to
+     */
+    void sync(const Cpu &cpu);
+
+    uint32_t sampleRate() const;
+
+private:
+    static constexpr size_t TABLE_SIZE = 1024;
+
+    /**
+     * The buzzer switches on or off before the given cycle
+     */
+    struct Edge {
+        uint64_t cycle;
+        bool on;
+    };
+
+    AudioSink &sink;
+    uint32_t sample_rate;
+    float table[TABLE_SIZE];
+
+    /**
+     * Position in the table, with 32 - log2(TABLE_SIZE) fractional bits, and its step per sample
+     */
+    uint32_t phase;
+    uint32_t phase_step;
+
+    bool on;
+    float gain;
+    float gain_step;
+
+    std::deque<Edge> edges;
+    uint64_t rendered_cycle;
+
+    /**
+     * The fraction of a sample rendered_cycle falls past the last sample rendered
+     */
+    double sample_offset;
+
+    std::vector<float> buffer;
+
+    /**
+     * Appends count samples of the current tone to buffer
+     */
+    void synthesize(size_t count);
+};
@@ -0,0 +1,435 @@
+#include <algorithm>
+#include "BatchCpu.h"
+
+/*
+ * The kernels below loop over every lane from the first lane of the group and blend the new value
+ * in with the lane mask, rather than branching per lane. Kept branchless, these loops vectorize
+ * into byte-wide SIMD operations; the aliasing of VX, VY and VF is handled by writing each result
+ * in a separate pass, in the same order the scalar handlers in Cpu.cpp do.
+ */
+
+static inline uint8_t blend(uint8_t mask, uint8_t value, uint8_t old) {
+    return (uint8_t) ((value & mask) | (old & ~mask));
+}
+
+static inline bool isScalarOp(Op op) {
+    switch (op) {
+        case Op::Unknown:
+        case Op::SYS:
+        case Op::CLS:
+        case Op::RND:
+        case Op::DRW:
+        case Op::SKP:
+        case Op::SKNP:
+        case Op::LD_VX_DT:
+        case Op::LD_VX_K:
+        case Op::LD_DT_VX:
+        case Op::LD_ST_VX:
+        case Op::LD_B_VX:
+        case Op::LD_I_VX:
+        case Op::LD_VX_I:
+        case Op::SCD:
+        case Op::SCR:
+        case Op::SCL:
+        case Op::LOW:
+        case Op::HIGH:
+            return true;
+        default:
+            return false;
+    }
+}
+
+BatchCpu::BatchCpu(size_t count, const uint8_t *rom, size_t size, uint32_t seed, QuirkProfile quirks) :
+        count(count),
+        data_registers(16 * count, 0),
+        pcs(count, Machine::PROGRAM_START),
+        instruction_registers(count, 0),
+        delay_timers(count, 0),
+        sound_timers(count, 0),
+        stacks(Cpu::STACK_SIZE * count, 0),
+        stack_pointers(count, 0),
+        cycle_counts(count, 0),
+        frame_countdowns(count, Cpu::DEFAULT_CYCLES_PER_FRAME),
+        waiting(count, 0),
+        states(count, State::Running),
+        cycles_per_frame(Cpu::DEFAULT_CYCLES_PER_FRAME),
+        mask(count, 0),
+        done(count, 0),
+        flags(count, 0) {
+    for (size_t i = 0; i < count; ++i) {
+        this->machines.emplace_back(new Machine());
+        this->machines.back()->loadRom(rom, size);
+        this->machines.back()->cpu.seed(seed + (uint32_t) i);
+        this->machines.back()->cpu.setQuirks(quirks);
+    }
+
+    switch (quirks) {
+        case QuirkProfile::CosmacVip:
+            this->execute_group = &BatchCpu::executeGroup<QuirkProfile::CosmacVip>;
+            break;
+        case QuirkProfile::SuperChip:
+            this->execute_group = &BatchCpu::executeGroup<QuirkProfile::SuperChip>;
+            break;
+        default:
+            this->execute_group = &BatchCpu::executeGroup<QuirkProfile::Modern>;
+            break;
+    }
+}
+
+size_t BatchCpu::size() const {
+    return this->count;
+}
+
+uint16_t BatchCpu::pc(size_t lane) const {
+    return this->pcs[lane];
+}
+
+uint16_t BatchCpu::instructionRegister(size_t lane) const {
+    return this->instruction_registers[lane];
+}
+
+uint8_t BatchCpu::dataRegister(size_t lane, uint8_t reg) const {
+    return this->data_registers[reg * this->count + lane];
+}
+
+uint64_t BatchCpu::cycles(size_t lane) const {
+    return this->cycle_counts[lane];
+}
+
+uint8_t BatchCpu::delayTimer(size_t lane) const {
+    return this->delay_timers[lane];
+}
+
+uint8_t BatchCpu::soundTimer(size_t lane) const {
+    return this->sound_timers[lane];
+}
+
+State BatchCpu::state(size_t lane) const {
+    return this->states[lane];
+}
+
+Machine &BatchCpu::machine(size_t lane) {
+    return *this->machines[lane];
+}
+
+uint8_t *BatchCpu::reg(uint8_t r) {
+    return this->data_registers.data() + r * this->count;
+}
+
+void BatchCpu::run(uint64_t steps) {
+    for (uint64_t i = 0; i < steps; ++i) {
+        this->step();
+    }
+}
+
+void BatchCpu::step() {
+    std::fill(this->done.begin(), this->done.end(), 0);
+
+    for (size_t first = 0; first < this->count; ++first) {
+        if (this->done[first]) {
+            continue;
+        }
+
+        uint16_t pc = this->pcs[first];
+        if (!(pc < 4096 && pc >= 512)) {
+            this->states[first] = State::PcOutOfBounds;
+            this->done[first] = 1;
+            continue;
+        }
+
+        if (this->waiting[first]) {
+            this->executeScalar(first);
+            this->done[first] = 1;
+            continue;
+        }
+
+        const Memory &memory = this->machines[first]->memory;
+        uint8_t hi = memory.read(pc);
+        uint8_t lo = memory.read(pc + 1);
+
+        // lanes at the same pc, still running the same code there
+        const uint16_t *pcs = this->pcs.data();
+        const uint8_t *done = this->done.data();
+        const uint8_t *waiting = this->waiting.data();
+        uint8_t *mask = this->mask.data();
+        for (size_t j = first; j < this->count; ++j) {
+            mask[j] = (pcs[j] == pc && !done[j] && !waiting[j]) ? 0xFF : 0;
+        }
+        for (size_t j = first; j < this->count; ++j) {
+            if (mask[j]) {
+                const Memory &lane_memory = this->machines[j]->memory;
+                if (lane_memory.read(pc) != hi || lane_memory.read(pc + 1) != lo) {
+                    mask[j] = 0;
+                } else {
+                    this->done[j] = 1;
+                }
+            }
+        }
+
+        Instruction inst = decode((uint16_t) ((hi << 8u) | lo));
+        if (isScalarOp(inst.op)) {
+            for (size_t j = first; j < this->count; ++j) {
+                if (mask[j]) {
+                    this->executeScalar(j);
+                }
+            }
+        } else {
+            (this->*execute_group)(inst, first);
+        }
+    }
+}
+
+void BatchCpu::executeScalar(size_t lane) {
+    Cpu &cpu = this->machines[lane]->cpu;
+    size_t n = this->count;
+
+    cpu.pc = this->pcs[lane];
+    cpu.instruction_register = this->instruction_registers[lane];
+    cpu.delay_timer = this->delay_timers[lane];
+    cpu.sound_timer = this->sound_timers[lane];
+    cpu.cycles = this->cycle_counts[lane];
+    cpu.frame_countdown = this->frame_countdowns[lane];
+    for (int r = 0; r < 16; ++r) {
+        cpu.data_registers[r] = this->data_registers[r * n + lane];
+    }
+
+    State result;
+    if (cpu.waiting_for_key) {
+        result = cpu.step();
+    } else {
+        const Memory &memory = this->machines[lane]->memory;
+        result = cpu.execute(decode((uint16_t) ((memory.read(cpu.pc) << 8u) | memory.read(cpu.pc + 1))));
+    }
+
+    this->pcs[lane] = cpu.pc;
+    this->instruction_registers[lane] = cpu.instruction_register;
+    this->delay_timers[lane] = cpu.delay_timer;
+    this->sound_timers[lane] = cpu.sound_timer;
+    this->cycle_counts[lane] = cpu.cycles;
+    this->frame_countdowns[lane] = cpu.frame_countdown;
+    for (int r = 0; r < 16; ++r) {
+        this->data_registers[r * n + lane] = cpu.data_registers[r];
+    }
+    this->waiting[lane] = cpu.waiting_for_key ? 1 : 0;
+    this->states[lane] = result;
+}
+
+void BatchCpu::advance(uint16_t amount, size_t first) {
+    uint16_t *pcs = this->pcs.data();
+    const uint8_t *mask = this->mask.data();
+    for (size_t j = first; j < this->count; ++j) {
+        pcs[j] += mask[j] ? amount : 0;
+    }
+}
+
+void BatchCpu::elapse(size_t first) {
+    const uint8_t *m = this->mask.data();
+    uint64_t *cycles = this->cycle_counts.data();
+    uint32_t *countdown = this->frame_countdowns.data();
+    uint8_t *delay = this->delay_timers.data();
+    uint8_t *sound = this->sound_timers.data();
+    const uint32_t reload = this->cycles_per_frame;
+
+    for (size_t j = first; j < this->count; ++j) {
+        cycles[j] += m[j] & 1u;
+    }
+    for (size_t j = first; j < this->count; ++j) {
+        uint32_t left = countdown[j] - (m[j] & 1u);
+        uint8_t tick = left == 0 ? 1 : 0;
+        countdown[j] = tick ? reload : left;
+        delay[j] -= tick & (delay[j] != 0);
+        sound[j] -= tick & (sound[j] != 0);
+    }
+}
+
+void BatchCpu::elapseLane(size_t lane) {
+    this->cycle_counts[lane]++;
+    if (--this->frame_countdowns[lane] == 0) {
+        this->frame_countdowns[lane] = this->cycles_per_frame;
+        this->delay_timers[lane] -= this->delay_timers[lane] != 0;
+        this->sound_timers[lane] -= this->sound_timers[lane] != 0;
+    }
+}
+
+template<QuirkProfile P>
+void BatchCpu::executeGroup(const Instruction &inst, size_t first) {
+    const size_t n = this->count;
+    const uint8_t *m = this->mask.data();
+    uint16_t *pc = this->pcs.data();
+    uint16_t *I = this->instruction_registers.data();
+    uint8_t *vx = this->reg(inst.x);
+    uint8_t *vy = this->reg(inst.y);
+    uint8_t *vf = this->reg(0xF);
+    uint8_t *flag = this->flags.data();
+    const uint8_t nn = inst.nn;
+    const uint16_t nnn = inst.nnn;
+
+    if (inst.op == Op::CALL || inst.op == Op::RET) {
+        // per-lane stack pointers make these gathers; lanes in lockstep usually share them anyway
+        for (size_t j = first; j < n; ++j) {
+            if (!m[j]) {
+                continue;
+            }
+            uint8_t &sp = this->stack_pointers[j];
+            if (inst.op == Op::CALL) {
+                if (sp == Cpu::STACK_SIZE) {
+                    this->states[j] = State::StackOverflow;
+                    continue;
+                }
+                this->stacks[sp * n + j] = pc[j] + 2;
+                sp++;
+                pc[j] = nnn;
+            } else {
+                if (sp == 0) {
+                    this->states[j] = State::StackUnderflow;
+                    continue;
+                }
+                sp--;
+                pc[j] = this->stacks[sp * n + j];
+            }
+            this->states[j] = State::Running;
+            this->elapseLane(j);
+        }
+        return;
+    }
+
+    this->elapse(first);
+    for (size_t j = first; j < n; ++j) {
+        if (m[j]) {
+            this->states[j] = State::Running;
+        }
+    }
+    this->advance(2, first);
+
+    switch (inst.op) {
+        case Op::JP:
+            for (size_t j = first; j < n; ++j) {
+                pc[j] = m[j] ? nnn : pc[j];
+            }
+            break;
+        case Op::JP_V0: {
+            const uint8_t *base = this->reg(Quirks<P>::jump_vx ? inst.x : 0);
+            for (size_t j = first; j < n; ++j) {
+                pc[j] = m[j] ? (uint16_t) (nnn + base[j]) : pc[j];
+            }
+            break;
+        }
+        case Op::SE_VX_NN:
+            for (size_t j = first; j < n; ++j) {
+                pc[j] += (m[j] & (vx[j] == nn ? 2 : 0));
+            }
+            break;
+        case Op::SNE_VX_NN:
+            for (size_t j = first; j < n; ++j) {
+                pc[j] += (m[j] & (vx[j] != nn ? 2 : 0));
+            }
+            break;
+        case Op::SE_VX_VY:
+            for (size_t j = first; j < n; ++j) {
+                pc[j] += (m[j] & (vx[j] == vy[j] ? 2 : 0));
+            }
+            break;
+        case Op::SNE_VX_VY:
+            for (size_t j = first; j < n; ++j) {
+                pc[j] += (m[j] & (vx[j] != vy[j] ? 2 : 0));
+            }
+            break;
+        case Op::LD_VX_NN:
+            for (size_t j = first; j < n; ++j) {
+                vx[j] = blend(m[j], nn, vx[j]);
+            }
+            break;
+        case Op::ADD_VX_NN:
+            for (size_t j = first; j < n; ++j) {
+                vx[j] = (uint8_t) (vx[j] + (nn & m[j]));
+            }
+            break;
+        case Op::LD_VX_VY:
+            for (size_t j = first; j < n; ++j) {
+                vx[j] = blend(m[j], vy[j], vx[j]);
+            }
+            break;
+        case Op::OR:
+            for (size_t j = first; j < n; ++j) {
+                vx[j] = blend(m[j], vx[j] | vy[j], vx[j]);
+            }
+            break;
+        case Op::AND:
+            for (size_t j = first; j < n; ++j) {
+                vx[j] = blend(m[j], vx[j] & vy[j], vx[j]);
+            }
+            break;
+        case Op::XOR:
+            for (size_t j = first; j < n; ++j) {
+                vx[j] = blend(m[j], vx[j] ^ vy[j], vx[j]);
+            }
+            break;
+        case Op::ADD_VX_VY:
+            for (size_t j = first; j < n; ++j) {
+                vf[j] = blend(m[j], (uint8_t) (vx[j] + vy[j] > 0xFF), vf[j]);
+            }
+            for (size_t j = first; j < n; ++j) {
+                vx[j] = blend(m[j], vx[j] + vy[j], vx[j]);
+            }
+            break;
+        case Op::SUB:
+            for (size_t j = first; j < n; ++j) {
+                vf[j] = blend(m[j], (uint8_t) (vx[j] >= vy[j]), vf[j]);
+            }
+            for (size_t j = first; j < n; ++j) {
+                vx[j] = blend(m[j], vx[j] - vy[j], vx[j]);
+            }
+            break;
+        case Op::SHR: {
+            const uint8_t *src = Quirks<P>::shift_vy ? vy : vx;
+            for (size_t j = first; j < n; ++j) {
+                flag[j] = src[j] & 1u;
+            }
+            for (size_t j = first; j < n; ++j) {
+                vx[j] = blend(m[j], src[j] >> 1u, vx[j]);
+            }
+            for (size_t j = first; j < n; ++j) {
+                vf[j] = blend(m[j], flag[j], vf[j]);
+            }
+            break;
+        }
+        case Op::SUBN:
+            for (size_t j = first; j < n; ++j) {
+                vf[j] = blend(m[j], (uint8_t) (vy[j] >= vx[j]), vf[j]);
+            }
+            for (size_t j = first; j < n; ++j) {
+                vx[j] = blend(m[j], vy[j] - vx[j], vx[j]);
+            }
+            break;
+        case Op::SHL: {
+            const uint8_t *src = Quirks<P>::shift_vy ? vy : vx;
+            for (size_t j = first; j < n; ++j) {
+                flag[j] = src[j] >> 7u;
+            }
+            for (size_t j = first; j < n; ++j) {
+                vx[j] = blend(m[j], src[j] << 1u, vx[j]);
+            }
+            for (size_t j = first; j < n; ++j) {
+                vf[j] = blend(m[j], flag[j], vf[j]);
+            }
+            break;
+        }
+        case Op::LD_I:
+            for (size_t j = first; j < n; ++j) {
+                I[j] = m[j] ? nnn : I[j];
+            }
+            break;
+        case Op::ADD_I_VX:
+            for (size_t j = first; j < n; ++j) {
+                I[j] += m[j] ? vx[j] : 0;
+            }
+            break;
+        case Op::LD_F_VX:
+            for (size_t j = first; j < n; ++j) {
+                I[j] = m[j] ? (uint16_t) ((vx[j] & 0xFu) * 0x5u) : I[j];
+            }
+            break;
+        default:
+            break;
+    }
+}
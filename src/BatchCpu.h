@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "Cpu.h"
+#include "Machine.h"
+
+/**
+ * Lockstep interpreter for many machines running the same program.
+ *
+ * Registers, pc, I, timers and call stacks of all machines are stored as structure-of-arrays,
+ * one contiguous array per register with one entry per machine ("lane"). Every step executes one
+ * instruction on every lane: lanes whose pc and opcode agree form a group, and the instruction is
+ * applied to the whole group at once by branchless masked kernels that the compiler turns into
+ * SSE/AVX lanes. Lanes that diverge simply form further groups.
+ *
+ * Instructions that touch a lane's memory, display, keypad, timers or random number generator run
+ * through that lane's own Cpu, so results are bit-identical to stepping N separate Cpus. The kernels
+ * are instantiated per quirk profile, like the Cpu's handlers.
+ */
+class BatchCpu {
+public:
+    /**
+     * Creates count machines running the same program under a quirk profile. Lane i is seeded with seed + i.
+     */
+    BatchCpu(size_t count, const uint8_t *rom, size_t size, uint32_t seed,
+             QuirkProfile quirks = QuirkProfile::Modern);
+
+    BatchCpu(const BatchCpu &) = delete;
+    BatchCpu &operator=(const BatchCpu &) = delete;
+
+    size_t size() const;
+
+    /**
+     * Executes one instruction on every machine
+     */
+    void step();
+
+    /**
+     * Executes the given number of instructions on every machine
+     */
+    void run(uint64_t steps);
+
+    uint16_t pc(size_t lane) const;
+    uint16_t instructionRegister(size_t lane) const;
+    uint8_t dataRegister(size_t lane, uint8_t reg) const;
+    uint64_t cycles(size_t lane) const;
+    uint8_t delayTimer(size_t lane) const;
+    uint8_t soundTimer(size_t lane) const;
+
+    /**
+     * The result of the last instruction executed on a lane
+     */
+    State state(size_t lane) const;
+
+    /**
+     * The memory, display and keypad of a lane. Its cpu does not hold the lane's registers.
+     */
+    Machine &machine(size_t lane);
+
+private:
+    size_t count;
+    std::vector<std::unique_ptr<Machine>> machines;
+
+    // one array per register, each with one entry per lane
+    std::vector<uint8_t> data_registers; // register r of lane i is at [r * count + i]
+    std::vector<uint16_t> pcs;
+    std::vector<uint16_t> instruction_registers;
+    std::vector<uint8_t> delay_timers;
+    std::vector<uint8_t> sound_timers;
+    std::vector<uint16_t> stacks;        // entry s of lane i is at [s * count + i]
+    std::vector<uint8_t> stack_pointers;
+    std::vector<uint64_t> cycle_counts;
+    std::vector<uint32_t> frame_countdowns;
+    std::vector<uint8_t> waiting;
+    std::vector<State> states;
+
+    uint32_t cycles_per_frame;
+
+    /**
+     * 0xFF for lanes in the group being executed, 0 otherwise.
+     * Only entries from the first lane of the group onwards are valid.
+     */
+    std::vector<uint8_t> mask;
+
+    /**
+     * Lanes that have executed their instruction in the current step
+     */
+    std::vector<uint8_t> done;
+
+    /**
+     * Scratch space for results that have to be written after VX, one entry per lane
+     */
+    std::vector<uint8_t> flags;
+
+    uint8_t *reg(uint8_t r);
+
+    /**
+     * executeGroup() instantiated for the quirk profile of the lanes
+     */
+    void (BatchCpu::*execute_group)(const Instruction &inst, size_t first);
+
+    template<QuirkProfile P>
+    void executeGroup(const Instruction &inst, size_t first);
+    void executeScalar(size_t lane);
+    void advance(uint16_t amount, size_t first);
+
+    /**
+     * Counts one cycle for every lane in the group, ticking the timers of lanes reaching a frame boundary
+     */
+    void elapse(size_t first);
+    void elapseLane(size_t lane);
+};
@@ -1,381 +1,776 @@
+#include <algorithm>
+#include <random>
 #include "Cpu.h"
 #include "Graphics.h"
-#include <iostream>
 
-static inline uint8_t getNN(uint16_t opcode) {
-    return opcode & 0x00FFu;
+constexpr size_t CpuState::STACK_SIZE;
+constexpr uint16_t Cpu::CACHE_START;
+constexpr uint16_t Cpu::CACHE_SIZE;
+constexpr uint32_t Cpu::DEFAULT_CYCLES_PER_FRAME;
+
+template<QuirkProfile P>
+const Cpu::Handler Cpu::handlers[(size_t) Op::Count] = {
+        &Cpu::op_unknown,
+        &Cpu::op_0NNN,
+        &Cpu::op_00E0,
+        &Cpu::op_00EE,
+        &Cpu::op_1NNN,
+        &Cpu::op_2NNN,
+        &Cpu::op_3XNN,
+        &Cpu::op_4XNN,
+        &Cpu::op_5XY0,
+        &Cpu::op_6XNN,
+        &Cpu::op_7XNN,
+        &Cpu::op_8XY0,
+        &Cpu::op_8XY1,
+        &Cpu::op_8XY2,
+        &Cpu::op_8XY3,
+        &Cpu::op_8XY4,
+        &Cpu::op_8XY5,
+        &Cpu::op_8XY6<P>,
+        &Cpu::op_8XY7,
+        &Cpu::op_8XYE<P>,
+        &Cpu::op_9XY0,
+        &Cpu::op_ANNN,
+        &Cpu::op_BNNN<P>,
+        &Cpu::op_CXNN,
+        &Cpu::op_DXYN<P>,
+        &Cpu::op_EX9E,
+        &Cpu::op_EXA1,
+        &Cpu::op_FX07,
+        &Cpu::op_FX0A,
+        &Cpu::op_FX15,
+        &Cpu::op_FX18,
+        &Cpu::op_FX1E,
+        &Cpu::op_FX29,
+        &Cpu::op_FX33,
+        &Cpu::op_FX55<P>,
+        &Cpu::op_FX65<P>,
+        &Cpu::op_00CN,
+        &Cpu::op_00FB,
+        &Cpu::op_00FC,
+        &Cpu::op_00FE,
+        &Cpu::op_00FF,
+};
+
+Cpu::Cpu(Memory &memory, Graphics &graphics, Input &input, int starting_addr) :
+        CpuState(), memory(memory), graphics(graphics), input(input) {
+    this->pc = starting_addr;
+    this->cycles_per_frame = DEFAULT_CYCLES_PER_FRAME;
+    this->frame_countdown = DEFAULT_CYCLES_PER_FRAME;
+    this->state = State::Running;
+    this->trace_buffer = nullptr;
+    this->profiler = nullptr;
+    this->sound_listener = nullptr;
+    this->translation = nullptr;
+    this->quirk_profile = QuirkProfile::Modern;
+    this->handler_table = handlers<QuirkProfile::Modern>;
+
+    std::random_device dev;
+    this->seed(dev());
+
+    this->memory.addListener(this);
 }
 
-static inline uint16_t getNNN(uint16_t opcode) {
-    return opcode & 0x0FFFu;
+Cpu::~Cpu() {
+    this->memory.removeListener(this);
 }
 
-static inline uint8_t getX(uint16_t opcode) {
-    return (opcode & 0x0F00u) >> 8u;
+void Cpu::onWrite(uint16_t addr) {
+    if (this->jit) {
+        this->jit->invalidate(addr);
+    }
+    if (this->translation != nullptr) {
+        this->translation->invalidate(addr);
+    }
+    if (!this->decode_cache) {
+        return;
+    }
+
+    // an instruction is two bytes wide, so a write also affects the instruction starting one byte earlier
+    if (addr >= CACHE_START && addr < CACHE_START + CACHE_SIZE) {
+        this->decode_cache[addr - CACHE_START].handler = nullptr;
+    }
+    if (addr > CACHE_START && addr <= CACHE_START + CACHE_SIZE) {
+        this->decode_cache[addr - 1 - CACHE_START].handler = nullptr;
+    }
 }
 
-static inline uint8_t getY(uint16_t opcode) {
-    return (opcode & 0x00F0u) >> 4u;
+void Cpu::onRestore() {
+    if (this->jit) {
+        this->jit->flush();
+    }
+    if (this->translation != nullptr) {
+        this->translation->validate(this->memory);
+    }
+    if (this->decode_cache) {
+        std::fill(this->decode_cache.get(), this->decode_cache.get() + CACHE_SIZE, DecodedInstruction{});
+    }
 }
 
-Cpu::Cpu(Memory &memory, Graphics &graphics, Input &input, int starting_addr) : memory(memory), graphics(graphics), input(input) {
-    this->pc = starting_addr;
-    this->instruction_register = 0;
-    this->stack = std::stack<uint16_t>();
+const Cpu::DecodedInstruction &Cpu::fetch(uint16_t addr) {
+    if (!this->decode_cache) {
+        this->decode_cache.reset(new DecodedInstruction[CACHE_SIZE]());
+    }
 
-    std::random_device dev;
-    this->rng = std::mt19937(dev());
-    this->rng_dist = std::uniform_int_distribution<std::mt19937::result_type>(0, 0xFF);
+    DecodedInstruction &slot = this->decode_cache[addr - CACHE_START];
+    if (slot.handler == nullptr) {
+        // instructions are stores in big-endian format
+        uint16_t inst = ((uint16_t) (this->memory.read(addr) << 8u)) | this->memory.read(addr + 1);
+        slot.instruction = decode(inst);
+        slot.handler = this->handler_table[(size_t) slot.instruction.op];
+    }
+    return slot;
+}
 
-    this->skip_update_pc = false;
+void Cpu::prefetch(uint16_t start, uint16_t end) {
+    for (uint16_t addr = std::max(start, CACHE_START); addr < end && addr + 1 < 4096; addr += 2) {
+        this->fetch(addr);
+    }
+#ifdef CHIP8_JIT
+    if (!this->jit) {
+        this->jit.reset(new Jit(this->quirk_profile));
+    }
+    this->jit->lookup(start, this->memory);
+#endif
 }
 
-void Cpu::step() {
-    if (!(this->pc < 4096 && this->pc >= 512)) {
-        std::cerr << "PC register is out of bounds: " << std::hex << this->pc << std::endl;
-        exit(2);
+void Cpu::seed(uint32_t seed) {
+    // splitmix64 spreads similar seeds over the whole state space
+    uint64_t z = seed + 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30u)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27u)) * 0x94D049BB133111EBull;
+    z ^= z >> 31u;
+    this->rng_state = z != 0 ? z : 1;
+}
+
+inline uint8_t Cpu::nextRandom() {
+    // xorshift64*; the high bits are the best distributed
+    this->rng_state ^= this->rng_state >> 12u;
+    this->rng_state ^= this->rng_state << 25u;
+    this->rng_state ^= this->rng_state >> 27u;
+    return (uint8_t) ((this->rng_state * 0x2545F4914F6CDD1Dull) >> 56u);
+}
+
+const CpuState &Cpu::snapshot() const {
+    return *this;
+}
+
+bool Cpu::isValid(const CpuState &state) {
+    return state.stack_pointer <= STACK_SIZE
+           && state.waiting_for_key_reg < 16
+           && state.cycles_per_frame > 0
+           && state.frame_countdown > 0 && state.frame_countdown <= state.cycles_per_frame
+           && state.rng_state != 0;
+}
+
+bool Cpu::restore(const CpuState &state) {
+    if (!isValid(state)) {
+        return false;
     }
+    static_cast<CpuState &>(*this) = state;
+    return true;
+}
 
-    if (waiting_for_key) {
-        if (input.triggered()) {
-            data_registers[waiting_for_key_reg] = input.triggeredKey();
-            waiting_for_key = false;
-        }
+void Cpu::setCyclesPerFrame(uint32_t cycles_per_frame) {
+    this->cycles_per_frame = std::max<uint32_t>(cycles_per_frame, 1);
+    this->frame_countdown = std::min(this->frame_countdown, this->cycles_per_frame);
+}
+
+uint32_t Cpu::cyclesPerFrame() const {
+    return this->cycles_per_frame;
+}
+
+uint8_t Cpu::delayTimer() const {
+    return this->delay_timer;
+}
+
+uint8_t Cpu::soundTimer() const {
+    return this->sound_timer;
+}
+
+uint64_t Cpu::soundEnd() const {
+    if (this->sound_timer == 0) {
+        return this->cycles;
+    }
+    // the first tick comes after frame_countdown cycles, every later one after a whole frame
+    return this->cycles + this->frame_countdown + (uint64_t) (this->sound_timer - 1) * this->cycles_per_frame;
+}
+
+void Cpu::setSoundListener(SoundListener *listener) {
+    this->sound_listener = listener;
+}
+
+inline void Cpu::elapse(uint64_t count) {
+    this->cycles += count;
+    if (count < this->frame_countdown) {
+        this->frame_countdown -= count;
         return;
     }
 
-    // instructions are stores in big-endian format
-    uint16_t inst = ((uint16_t) (this->memory[this->pc] << 8u)) | this->memory[this->pc + 1];
-    std::cerr << "Running opcode: " << std::hex << inst << " " << std::hex << this->pc << " " << std::hex
-              << ((inst & 0xF000u) >> 12u) << std::endl;
+    // crossed at least one frame boundary; long runs from compiled blocks may cross several
+    count -= this->frame_countdown;
+    uint64_t ticks = 1 + count / this->cycles_per_frame;
+    this->frame_countdown = this->cycles_per_frame - (uint32_t) (count % this->cycles_per_frame);
+    this->delay_timer = ticks >= this->delay_timer ? 0 : (uint8_t) (this->delay_timer - ticks);
+    this->sound_timer = ticks >= this->sound_timer ? 0 : (uint8_t) (this->sound_timer - ticks);
+}
 
-    switch ((inst & 0xF000u) >> 12u) {
-        case 0:
-            this->opcode_0xxx(inst);
-            break;
-        case 1:
-            this->opcode_1xxx(inst);
-            break;
-        case 2:
-            this->opcode_2xxx(inst);
-            break;
-        case 3:
-            this->opcode_3xxx(inst);
-            break;
-        case 4:
-            this->opcode_4xxx(inst);
-            break;
-        case 5:
-            this->opcode_5xxx(inst);
-            break;
-        case 6:
-            this->opcode_6xxx(inst);
-            break;
-        case 7:
-            this->opcode_7xxx(inst);
-            break;
-        case 8:
-            this->opcode_8xxx(inst);
-            break;
-        case 9:
-            this->opcode_9xxx(inst);
-            break;
-        case 0xA:
-            this->opcode_Axxx(inst);
-            break;
-        case 0xB:
-            this->opcode_Bxxx(inst);
-            break;
-        case 0xC:
-            this->opcode_Cxxx(inst);
-            break;
-        case 0xD:
-            this->opcode_Dxxx(inst);
-            break;
-        case 0xE:
-            this->opcode_Exxx(inst);
+bool Cpu::setTranslation(Translation *translation) {
+    if (translation != nullptr && translation->quirks() != this->quirk_profile) {
+        this->translation = nullptr;
+        return false;
+    }
+    this->translation = translation;
+    if (translation != nullptr) {
+        translation->validate(this->memory);
+    }
+    return true;
+}
+
+void Cpu::setQuirks(QuirkProfile profile) {
+    switch (profile) {
+        case QuirkProfile::CosmacVip:
+            this->handler_table = handlers<QuirkProfile::CosmacVip>;
             break;
-        case 0xF:
-            this->opcode_Fxxx(inst);
+        case QuirkProfile::SuperChip:
+            this->handler_table = handlers<QuirkProfile::SuperChip>;
             break;
         default:
-            std::cout << std::hex << this->pc << std::endl;
-            this->pc += 2;
+            profile = QuirkProfile::Modern;
+            this->handler_table = handlers<QuirkProfile::Modern>;
             break;
     }
+    this->quirk_profile = profile;
+
+    // decoded slots hold handlers of the old profile, and compiled blocks its shifts
+    if (this->decode_cache) {
+        std::fill(this->decode_cache.get(), this->decode_cache.get() + CACHE_SIZE, DecodedInstruction{});
+    }
+    if (this->jit) {
+        this->jit.reset(new Jit(profile));
+    }
+    if (this->translation != nullptr && this->translation->quirks() != profile) {
+        this->translation = nullptr;
+    }
+}
+
+QuirkProfile Cpu::quirks() const {
+    return this->quirk_profile;
+}
+
+void Cpu::setTraceBuffer(TraceBuffer *buffer) {
+    this->trace_buffer = buffer;
+}
+
+void Cpu::setProfiler(Profiler *profiler) {
+    this->profiler = profiler;
+}
 
-    if (this->skip_update_pc) {
-        this->skip_update_pc = false;
+void Cpu::trace(TraceKind kind, uint16_t addr, uint8_t detail) {
+    if (this->trace_buffer == nullptr) {
         return;
     }
 
+    TraceRecord record{};
+    record.cycle = this->cycles;
+    record.pc = addr;
+    record.opcode = (uint16_t) ((this->memory.read(addr) << 8u) | this->memory.read(addr + 1));
+    record.instruction_register = this->instruction_register;
+    record.kind = (uint8_t) kind;
+    record.detail = detail;
+    std::copy(this->data_registers, this->data_registers + 16, record.data_registers);
+    this->trace_buffer->push(record);
+}
+
+State Cpu::step() {
+    if (!(this->pc < 4096 && this->pc >= 512)) {
+        CHIP8_TRACE_EVENT(*this, TraceKind::Fault, this->pc, (uint8_t) State::PcOutOfBounds);
+        return State::PcOutOfBounds;
+    }
+
+    if (waiting_for_key) {
+        CHIP8_PROFILE_EVENT(*this, waitForKey(this->pc - 2));
+        this->elapse(1);
+        if (input.triggered()) {
+            data_registers[waiting_for_key_reg] = input.triggeredKey();
+            waiting_for_key = 0;
+            return State::Running;
+        }
+        return State::WaitingForKey;
+    }
+
+    const DecodedInstruction &decoded = this->fetch(this->pc);
+    CHIP8_TRACE_INSTRUCTION(*this);
+    CHIP8_PROFILE_EVENT(*this, instruction(this->pc, decoded.instruction.op));
+
+    return this->dispatch(decoded.handler, decoded.instruction);
+}
+
+State Cpu::execute(const Instruction &inst) {
+    return this->dispatch(this->handler_table[(size_t) inst.op], inst);
+}
+
+inline State Cpu::dispatch(Handler handler, const Instruction &inst) {
+    this->state = State::Running;
+    // pc is advanced before executing, so jumps and skips simply overwrite or add to it
     this->pc += 2;
+    handler(*this, inst);
+
+    if (isFault(this->state)) {
+        // leave the faulting instruction to be reported again
+        this->pc -= 2;
+        CHIP8_TRACE_EVENT(*this, TraceKind::Fault, this->pc, (uint8_t) this->state);
+    } else {
+        this->elapse(1);
+    }
+    return this->state;
 }
 
-inline void Cpu::opcode_0xxx(uint16_t opcode) {
-    if (opcode == 0x00E0) {
-        // 00E0 - Clear the screen
-        this->graphics.clear();
-    } else if (opcode == 0x00EE) {
-        // 00EE - Return from subroutine
-        this->pc = this->stack.top();
-        this->stack.pop();
+uint64_t Cpu::skipIdle(uint64_t budget) {
+    if ((CHIP8_TRACE_LEVEL >= CHIP8_TRACE_INSTRUCTIONS && this->trace_buffer != nullptr) || CHIP8_PROFILING(*this)) {
+        return 0;
+    }
+
+    // keys only change between runs, so waits and key spins last at least for the rest of this one
+    if (this->waiting_for_key) {
+        if (this->input.triggered()) {
+            return 0;
+        }
+        this->elapse(budget);
+        return budget;
+    }
+    if (this->pc < CACHE_START || this->pc + 1 >= 4096) {
+        return 0;
+    }
+
+    const Instruction &first = this->fetch(this->pc).instruction;
+    if (first.op == Op::JP && first.nnn == this->pc) {
+        this->elapse(budget);
+        return budget;
+    }
+    if (first.op == Op::DRW && this->frame_countdown != this->cycles_per_frame
+        && quirkFlags(this->quirk_profile).display_wait) {
+        // each retry of a draw waiting for the display takes a cycle, until the next frame starts
+        uint64_t skipped = std::min<uint64_t>(budget, this->frame_countdown);
+        this->elapse(skipped);
+        return skipped;
+    }
+    if ((first.op != Op::SKP && first.op != Op::SKNP && first.op != Op::LD_VX_DT) || this->pc + 3 >= 4096) {
+        return 0;
+    }
+
+    const Instruction &second = this->fetch(this->pc + 2).instruction;
+    if ((first.op == Op::SKP || first.op == Op::SKNP) && second.op == Op::JP && second.nnn == this->pc) {
+        uint8_t key = this->data_registers[first.x];
+        if (key >= 16 || this->input.keys[key] != (first.op == Op::SKNP)) {
+            return 0;
+        }
+        uint64_t skipped = budget - budget % 2;
+        this->elapse(skipped);
+        return skipped;
+    }
+    if (this->pc + 5 >= 4096 || first.op != Op::LD_VX_DT
+        || (second.op != Op::SE_VX_NN && second.op != Op::SNE_VX_NN) || second.x != first.x) {
+        return 0;
+    }
+    const Instruction &third = this->fetch(this->pc + 4).instruction;
+    if (third.op != Op::JP || third.nnn != this->pc) {
+        return 0;
+    }
+
+    // FX07, then 3XNN or 4XNN skipping the 1NNN back: the loop runs until FX07 reads a value that
+    // makes the skip happen. The timer only counts down, so that is the first such value below it.
+    const uint8_t delay = this->delay_timer;
+    int exit_value;
+    if (second.op == Op::SE_VX_NN) {
+        exit_value = second.nn <= delay ? second.nn : -1;
     } else {
-        std::cerr << "Unknown opcode: " << std::hex << opcode << std::endl;
+        exit_value = second.nn != delay ? delay : delay - 1;
+    }
+
+    uint64_t iterations = budget / 3;
+    if (exit_value >= 0) {
+        // the timer reads exit_value once this many cycles have passed
+        uint64_t ticks = (uint64_t) (delay - exit_value);
+        uint64_t cycles = ticks == 0 ? 0 : this->frame_countdown + (ticks - 1) * this->cycles_per_frame;
+        iterations = std::min(iterations, (cycles + 2) / 3);
+    }
+    if (iterations == 0) {
+        return 0;
+    }
+
+    // VX holds what the last FX07 read
+    uint64_t before_last = 3 * (iterations - 1);
+    uint64_t ticks = before_last < this->frame_countdown ? 0
+                   : 1 + (before_last - this->frame_countdown) / this->cycles_per_frame;
+    this->data_registers[first.x] = ticks >= delay ? 0 : (uint8_t) (delay - ticks);
+    this->elapse(3 * iterations);
+    return 3 * iterations;
+}
+
+State Cpu::run(uint64_t instructions) {
+#ifdef CHIP8_JIT
+    if (!this->jit) {
+        this->jit.reset(new Jit(this->quirk_profile));
     }
+#endif
+
+    while (instructions > 0) {
+        // instructions inside translated or compiled blocks cannot be traced or profiled individually
+        bool blocks = !this->waiting_for_key && this->pc >= CACHE_START && this->pc < 4096
+                      && (CHIP8_TRACE_LEVEL < CHIP8_TRACE_INSTRUCTIONS || this->trace_buffer == nullptr)
+                      && !CHIP8_PROFILING(*this);
+        if (blocks && this->translation != nullptr) {
+            const TranslatedBlock *block = this->translation->lookup(this->pc);
+            if (block != nullptr && block->length <= instructions) {
+                this->pc = block->fn(this->data_registers, &this->instruction_register);
+                this->elapse(block->length);
+                instructions -= block->length;
+                if (this->pc <= block->start && instructions > 0) {
+                    instructions -= this->skipIdle(instructions);
+                }
+                continue;
+            }
+        }
+#ifdef CHIP8_JIT
+        if (blocks) {
+            const Jit::Block *block = this->jit->lookup(this->pc, this->memory);
+            if (block != nullptr && block->length <= instructions) {
+                uint16_t start = this->pc;
+                this->pc = block->fn(this->data_registers, &this->instruction_register);
+                this->elapse(block->length);
+                instructions -= block->length;
+                if (this->pc <= start && instructions > 0) {
+                    instructions -= this->skipIdle(instructions);
+                }
+                continue;
+            }
+        }
+#endif
+        uint16_t start = this->pc;
+        State result = this->step();
+        if (isFault(result)) {
+            return result;
+        }
+        instructions--;
+
+        // the idle loops recognized are at most three instructions long and end by jumping back to
+        // their start, so only short backward jumps and draws waiting for the display are worth a closer look
+        if ((uint16_t) (start - this->pc) <= 4 && instructions > 0
+            && (this->waiting_for_key
+                || (this->decode_cache && this->decode_cache[start - CACHE_START].instruction.op == Op::JP)
+                || this->pc == start)) {
+            instructions -= this->skipIdle(instructions);
+        }
+    }
+    return this->waiting_for_key ? State::WaitingForKey : State::Running;
+}
+
+void Cpu::op_unknown(Cpu &cpu, const Instruction &inst) {
+    // unknown opcodes are skipped
+    CHIP8_TRACE_EVENT(cpu, TraceKind::UnknownOpcode, cpu.pc - 2, 0);
 }
 
-inline void Cpu::opcode_1xxx(uint16_t opcode) {
+void Cpu::op_0NNN(Cpu &cpu, const Instruction &inst) {
+    // 0NNN - Execute machine language subroutine at NNN; not supported
+    op_unknown(cpu, inst);
+}
+
+void Cpu::op_00E0(Cpu &cpu, const Instruction &inst) {
+    // 00E0 - Clear the screen
+    cpu.graphics.clear();
+}
+
+void Cpu::op_00EE(Cpu &cpu, const Instruction &inst) {
+    // 00EE - Return from subroutine
+    if (cpu.stack_pointer == 0) {
+        cpu.state = State::StackUnderflow;
+        return;
+    }
+    cpu.pc = cpu.stack[--cpu.stack_pointer];
+    CHIP8_PROFILE_EVENT(cpu, ret());
+}
+
+void Cpu::op_1NNN(Cpu &cpu, const Instruction &inst) {
     // 1NNN - Jump to address NNN
-    this->pc = getNNN(opcode);
-    this->skip_update_pc = true;
+    cpu.pc = inst.nnn;
 }
 
-inline void Cpu::opcode_2xxx(uint16_t opcode) {
+void Cpu::op_2NNN(Cpu &cpu, const Instruction &inst) {
     // 2NNN - Execute subroutine at NNN
-    this->stack.push(this->pc);
-    this->pc = getNNN(opcode);
-    this->skip_update_pc = true;
+    if (cpu.stack_pointer == STACK_SIZE) {
+        cpu.state = State::StackOverflow;
+        return;
+    }
+    cpu.stack[cpu.stack_pointer++] = cpu.pc;
+    cpu.pc = inst.nnn;
+    CHIP8_PROFILE_EVENT(cpu, call(inst.nnn));
 }
 
-inline void Cpu::opcode_3xxx(uint16_t opcode) {
+void Cpu::op_3XNN(Cpu &cpu, const Instruction &inst) {
     // 3XNN - Skip the following instruction if register VX equals NN
-    uint8_t reg = getX(opcode);
-    uint16_t val = getNN(opcode);
-
-    if (this->data_registers[reg] == val) {
-        this->pc += 2;
+    if (cpu.data_registers[inst.x] == inst.nn) {
+        cpu.pc += 2;
     }
 }
 
-inline void Cpu::opcode_4xxx(uint16_t opcode) {
+void Cpu::op_4XNN(Cpu &cpu, const Instruction &inst) {
     // 4XNN - Skip the following instruction if register VX does not equals NN
-    uint8_t reg = getX(opcode);
-    uint8_t val = getNN(opcode);
-
-    if (this->data_registers[reg] != val) {
-        this->pc += 2;
+    if (cpu.data_registers[inst.x] != inst.nn) {
+        cpu.pc += 2;
     }
 }
 
-inline void Cpu::opcode_5xxx(uint16_t opcode) {
+void Cpu::op_5XY0(Cpu &cpu, const Instruction &inst) {
     // 5XY0 - Skip the following instruction if VX equals XY
-    uint8_t regx = getX(opcode);
-    uint8_t regy = getY(opcode);
-
-    if (data_registers[regx] == data_registers[regy]) {
-        this->pc += 2;
+    if (cpu.data_registers[inst.x] == cpu.data_registers[inst.y]) {
+        cpu.pc += 2;
     }
 }
 
-inline void Cpu::opcode_6xxx(uint16_t opcode) {
+void Cpu::op_6XNN(Cpu &cpu, const Instruction &inst) {
     // 6XNN Store number NN in register VX
+    cpu.data_registers[inst.x] = inst.nn;
+}
 
-    uint8_t data = getNN(opcode);
-    uint8_t reg = getX(opcode);
+void Cpu::op_7XNN(Cpu &cpu, const Instruction &inst) {
+    // 7XNN - Add NN to VX
+    cpu.data_registers[inst.x] += inst.nn;
+}
 
-    data_registers[reg] = data;
+void Cpu::op_8XY0(Cpu &cpu, const Instruction &inst) {
+    // 8XY0 - Store VY in VX
+    cpu.data_registers[inst.x] = cpu.data_registers[inst.y];
 }
 
-inline void Cpu::opcode_7xxx(uint16_t opcode) {
-    // 7XNN - Add NN to VX
-    uint8_t reg = getX(opcode);
-    uint8_t data = getNN(opcode);
+void Cpu::op_8XY1(Cpu &cpu, const Instruction &inst) {
+    // 8XY1 - VX = VX | VY
+    cpu.data_registers[inst.x] |= cpu.data_registers[inst.y];
+}
 
-    data_registers[reg] += data;
+void Cpu::op_8XY2(Cpu &cpu, const Instruction &inst) {
+    // 8XY2 - VX = VX & VY
+    cpu.data_registers[inst.x] &= cpu.data_registers[inst.y];
 }
 
-inline void Cpu::opcode_8xxx(uint16_t opcode) {
-    uint8_t regx = getX(opcode);
-    uint8_t regy = getY(opcode);
+void Cpu::op_8XY3(Cpu &cpu, const Instruction &inst) {
+    // 8XY3 - VX = VX ^ VY
+    cpu.data_registers[inst.x] ^= cpu.data_registers[inst.y];
+}
 
-    switch (opcode & (unsigned) 0x000F) {
-        case 0:
-            // 8XY0 - Store VY in VX
-            data_registers[regx] = data_registers[regy];
-            break;
-        case 1:
-            // 8XY1 - VX = VX | VY
-            data_registers[regx] |= data_registers[regy];
-            break;
-        case 2:
-            // 8XY2 - VX = VX & VY
-            data_registers[regx] &= data_registers[regy];
-            break;
-        case 3:
-            // 8XY3 - VX = VX ^ VY
-            data_registers[regx] ^= data_registers[regy];
-            break;
-        case 4:
-            // VX = VX + VY; Set VF to 0 if carry occurs
-            if ((int) data_registers[regx] + (int) data_registers[regy] > 0xFF) {
-                // carry
-                data_registers[0xF] = 0x01;
-            } else {
-                data_registers[0xF] = 0x00;
-            }
-            data_registers[regx] += data_registers[regy];
-            break;
-        case 5:
-            // VX = VX - VY; Set VF to 0 if borrow occurs
-            if ((int) data_registers[regx] - (int) data_registers[regy] < 0) {
-                // borrow
-                data_registers[0xF] = 0x00;
-            } else {
-                data_registers[0xF] = 0x01;
-            }
-            data_registers[regx] -= data_registers[regy];
-            break;
-        case 6:
-            // VX = VY >> 1; VF = VY &0x1;
-            data_registers[regx] = data_registers[regx] >> (unsigned) 1;
-            data_registers[0xf] = data_registers[regy] & (unsigned) 0x1;
-            break;
-        case 7:
-            // VX = VY - VX; Set VF to 0 if borrow occurs
-            if ((int) data_registers[regy] - (int) data_registers[regx] < 0) {
-                // borrow
-                data_registers[0xF] = 0x00;
-            } else {
-                data_registers[0xF] = 0x01;
-            }
-            data_registers[regx] = data_registers[regy] - data_registers[regx];
-            break;
-        case 0xE:
-            // VX = VY << 1; VF = VY &0x1;
-            data_registers[regx] = data_registers[regx] << (unsigned) 1;
-            data_registers[0xf] = data_registers[regy] >> (unsigned) 7;
-            break;
+void Cpu::op_8XY4(Cpu &cpu, const Instruction &inst) {
+    // 8XY4 - VX = VX + VY; Set VF to 0 if carry occurs
+    uint8_t *v = cpu.data_registers;
+    if ((int) v[inst.x] + (int) v[inst.y] > 0xFF) {
+        // carry
+        v[0xF] = 0x01;
+    } else {
+        v[0xF] = 0x00;
     }
+    v[inst.x] += v[inst.y];
 }
 
-inline void Cpu::opcode_9xxx(uint16_t opcode) {
-    // 9XY0 - Skip next instruction if VX is not equal to VY
-    uint8_t regx = getX(opcode);
-    uint8_t regy = getY(opcode);
+void Cpu::op_8XY5(Cpu &cpu, const Instruction &inst) {
+    // 8XY5 - VX = VX - VY; Set VF to 0 if borrow occurs
+    uint8_t *v = cpu.data_registers;
+    if ((int) v[inst.x] - (int) v[inst.y] < 0) {
+        // borrow
+        v[0xF] = 0x00;
+    } else {
+        v[0xF] = 0x01;
+    }
+    v[inst.x] -= v[inst.y];
+}
+
+template<QuirkProfile P>
+void Cpu::op_8XY6(Cpu &cpu, const Instruction &inst) {
+    // 8XY6 - VX = VY >> 1 (COSMAC VIP) or VX >> 1; VF = the bit shifted out, set last
+    uint8_t *v = cpu.data_registers;
+    uint8_t value = v[Quirks<P>::shift_vy ? inst.y : inst.x];
+    v[inst.x] = value >> (unsigned) 1;
+    v[0xF] = value & (unsigned) 0x1;
+}
 
-    if (data_registers[regx] != data_registers[regy]) {
-        this->pc += 2;
+void Cpu::op_8XY7(Cpu &cpu, const Instruction &inst) {
+    // 8XY7 - VX = VY - VX; Set VF to 0 if borrow occurs
+    uint8_t *v = cpu.data_registers;
+    if ((int) v[inst.y] - (int) v[inst.x] < 0) {
+        // borrow
+        v[0xF] = 0x00;
+    } else {
+        v[0xF] = 0x01;
     }
+    v[inst.x] = v[inst.y] - v[inst.x];
 }
 
-inline void Cpu::opcode_Axxx(uint16_t opcode) {
-    // ANNN - Store memory address NNN in register I
-    this->instruction_register = opcode & 0x0FFFu;
+template<QuirkProfile P>
+void Cpu::op_8XYE(Cpu &cpu, const Instruction &inst) {
+    // 8XYE - VX = VY << 1 (COSMAC VIP) or VX << 1; VF = the bit shifted out, set last
+    uint8_t *v = cpu.data_registers;
+    uint8_t value = v[Quirks<P>::shift_vy ? inst.y : inst.x];
+    v[inst.x] = value << (unsigned) 1;
+    v[0xF] = value >> (unsigned) 7;
 }
 
-inline void Cpu::opcode_Bxxx(uint16_t opcode) {
-    // BNNN - Jump to NNN + V0
-    this->pc = getNNN(opcode) + data_registers[0];
-    this->skip_update_pc = true;
+void Cpu::op_9XY0(Cpu &cpu, const Instruction &inst) {
+    // 9XY0 - Skip next instruction if VX is not equal to VY
+    if (cpu.data_registers[inst.x] != cpu.data_registers[inst.y]) {
+        cpu.pc += 2;
+    }
 }
 
-inline void Cpu::opcode_Cxxx(uint16_t opcode) {
-    // CXNN - Set VX to a random number with mask NN
-    uint8_t mask = getNN(opcode);
-    uint8_t regx = getX(opcode);
+void Cpu::op_ANNN(Cpu &cpu, const Instruction &inst) {
+    // ANNN - Store memory address NNN in register I
+    cpu.instruction_register = inst.nnn;
+}
 
-    uint16_t number = rng_dist(rng);
+template<QuirkProfile P>
+void Cpu::op_BNNN(Cpu &cpu, const Instruction &inst) {
+    // BNNN - Jump to NNN + V0; BXNN (SUPER-CHIP) - Jump to XNN + VX
+    cpu.pc = inst.nnn + cpu.data_registers[Quirks<P>::jump_vx ? inst.x : 0];
+}
 
-    data_registers[regx] = number & mask;
+void Cpu::op_CXNN(Cpu &cpu, const Instruction &inst) {
+    // CXNN - Set VX to a random number with mask NN
+    cpu.data_registers[inst.x] = cpu.nextRandom() & inst.nn;
 }
 
-void Cpu::opcode_Dxxx(uint16_t opcode) {
+template<QuirkProfile P>
+void Cpu::op_DXYN(Cpu &cpu, const Instruction &inst) {
     // DXYN - Draw a sprite at (VX, VY) with N bytes of sprite data from VI
     // Set VF to 1 if any set pixels are unset
     // Each byte has 8 bits indicating the value of the pixel
+    if (Quirks<P>::display_wait && cpu.frame_countdown != cpu.cycles_per_frame) {
+        // the COSMAC VIP draws at the start of a frame: retry until the next one begins
+        cpu.pc -= 2;
+        return;
+    }
 
-    uint8_t regx = getX(opcode);
-    uint8_t regy = getY(opcode);
+    uint8_t *v = cpu.data_registers;
+    if (inst.n == 0) {
+        // DXY0 (SUPER-CHIP) - Draw a 16x16 sprite, two bytes per row
+        uint8_t sprite[32];
+        for (int y = 0; y < 32; ++y) {
+            sprite[y] = cpu.memory.read(cpu.instruction_register + y);
+        }
+        v[0xF] = cpu.graphics.drawLarge<Quirks<P>::clip>(v[inst.x], v[inst.y], sprite);
+        CHIP8_PROFILE_EVENT(cpu, draw(sprite, 32, v[0xF] != 0));
+        return;
+    }
 
-    uint8_t x0 = data_registers[regx];
-    uint8_t y0 = data_registers[regy];
+    uint8_t sprite[15];
+    for (int y = 0; y < inst.n; ++y) {
+        sprite[y] = cpu.memory.read(cpu.instruction_register + y);
+    }
 
-    uint8_t n = (opcode & 0x000Fu);
+    v[0xF] = cpu.graphics.draw<Quirks<P>::clip>(v[inst.x], v[inst.y], sprite, inst.n);
+    CHIP8_PROFILE_EVENT(cpu, draw(sprite, inst.n, v[0xF] != 0));
+}
 
-    data_registers[0xf] = 0;
-    for (int y = 0; y < n; ++y) {
-        uint8_t cur = memory[instruction_register + y];
-        for (int x = 0; x < 8; ++x) {
-            uint8_t val = ((cur) & (0x80 >> x)) ? 1 : 0;
+void Cpu::op_EX9E(Cpu &cpu, const Instruction &inst) {
+    // EX9E - Skip the next instruction if the key in VX is pressed
+    if (cpu.input.keys[cpu.data_registers[inst.x]]) {
+        cpu.pc += 2;
+    }
+}
 
-            uint8_t oldVal = graphics.get(x0 + x, y0 + y);
+void Cpu::op_EXA1(Cpu &cpu, const Instruction &inst) {
+    // EXA1 - Skip the next instruction if the key in VX is not pressed
+    if (!cpu.input.keys[cpu.data_registers[inst.x]]) {
+        cpu.pc += 2;
+    }
+}
 
-            if (oldVal == 0) {
-                data_registers[0xf] = 1;
-            }
+void Cpu::op_FX07(Cpu &cpu, const Instruction &inst) {
+    // FX07 - Store the current value of the delay timer in VX
+    cpu.data_registers[inst.x] = cpu.delay_timer;
+}
 
-            graphics.set(x0 + x, y0 + y, val);
-        }
-    }
+void Cpu::op_FX0A(Cpu &cpu, const Instruction &inst) {
+    // FX0A - Wait for a keypress and store it in VX
+    cpu.input.clearTriggered();
+    cpu.waiting_for_key = 1;
+    cpu.waiting_for_key_reg = inst.x;
+    cpu.state = State::WaitingForKey;
 }
 
-inline void Cpu::opcode_Exxx(uint16_t opcode) {
-    uint8_t regx = getX(opcode);
+void Cpu::op_FX15(Cpu &cpu, const Instruction &inst) {
+    // FX15 - Set delay timer to VX
+    cpu.delay_timer = cpu.data_registers[inst.x];
+}
 
-    switch (opcode & (unsigned) 0x00FF) {
-        case 0x9E:
-            // EX9E - Skip the next instruction if the key in VX is pressed
-            if (input.keys[data_registers[regx]]) {
-                this->pc += 2;
-            }
-            break;
-        case 0xA1:
-            // EXA1 - Skip the next instruction if the key in VX is not pressed
-            if (!input.keys[data_registers[regx]]) {
-                this->pc += 2;
-            }
-            break;
+void Cpu::op_FX18(Cpu &cpu, const Instruction &inst) {
+    // FX18 - Set sound timer to VX
+    cpu.sound_timer = cpu.data_registers[inst.x];
+    if (cpu.sound_listener != nullptr) {
+        cpu.sound_listener->onSound(cpu.cycles, cpu.soundEnd());
     }
 }
 
-void Cpu::opcode_Fxxx(uint16_t opcode) {
-    uint8_t regx = getX(opcode);
+void Cpu::op_FX1E(Cpu &cpu, const Instruction &inst) {
+    // FX1E - Add VX to I.
+    cpu.instruction_register += cpu.data_registers[inst.x];
+}
 
-    switch (opcode & (unsigned) 0x00FF) {
-        case 0x07:
-            // FX07 - Store the current value of the delay timer in VX
-            data_registers[regx] = delay_timer;
-            break;
-        case 0x0A:
-            // FX0A - Wait for a keypress and store it in VX
-            input.clearTriggered();
-            waiting_for_key = true;
-            waiting_for_key_reg = regx;
-            break;
-        case 0x15:
-            // FX15 - Set delay timer to VX
-            // TODO:
-            break;
-        case 0x18:
-            // FX18 - Set sound timer to VX
-            // TODO:
-            break;
-        case 0x1E:
-            // FX15 - Add VX to I.
-            instruction_register += data_registers[regx];
-            break;
-        case 0x29:
-            // FX29 - Sets I to location of character sprite in VX
-            instruction_register = regx * 0x5;
-            break;
-        case 0x33:
-            // FX33 - Stores BCD representation of VX at I
-            memory[instruction_register] = data_registers[regx] / 100;
-            memory[instruction_register + 1] = (data_registers[regx] / 10) % 10;
-            memory[instruction_register + 2] = data_registers[regx] % 10;
-            break;
-        case 0x55:
-            // FX55 - Stores V0 to Vx in memory starting at I
-            for (uint8_t i = 0; i < regx + 1; ++i) {
-                memory[instruction_register + i] = data_registers[i];
-            }
-            break;
-        case 0x65:
-            // FX65 - Fills V0 to VX from memory starting at I
-            for (uint8_t i = 0; i < regx + 1; ++i) {
-                data_registers[i] = memory[instruction_register + i];
-            }
-            break;
+void Cpu::op_FX29(Cpu &cpu, const Instruction &inst) {
+    // FX29 - Sets I to location of character sprite in VX; only the low nibble selects the digit
+    cpu.instruction_register = (cpu.data_registers[inst.x] & 0xFu) * 0x5u;
+}
+
+void Cpu::op_FX33(Cpu &cpu, const Instruction &inst) {
+    // FX33 - Stores BCD representation of VX at I
+    uint8_t val = cpu.data_registers[inst.x];
+    cpu.memory[cpu.instruction_register] = val / 100;
+    cpu.memory[cpu.instruction_register + 1] = (val / 10) % 10;
+    cpu.memory[cpu.instruction_register + 2] = val % 10;
+}
+
+template<QuirkProfile P>
+void Cpu::op_FX55(Cpu &cpu, const Instruction &inst) {
+    // FX55 - Stores V0 to Vx in memory starting at I; the COSMAC VIP leaves I past the last one
+    for (uint8_t i = 0; i < inst.x + 1; ++i) {
+        cpu.memory[cpu.instruction_register + i] = cpu.data_registers[i];
+    }
+    if (Quirks<P>::memory_increments_i) {
+        cpu.instruction_register += inst.x + 1;
     }
 }
+
+template<QuirkProfile P>
+void Cpu::op_FX65(Cpu &cpu, const Instruction &inst) {
+    // FX65 - Fills V0 to VX from memory starting at I; the COSMAC VIP leaves I past the last one
+    for (uint8_t i = 0; i < inst.x + 1; ++i) {
+        cpu.data_registers[i] = cpu.memory.read(cpu.instruction_register + i);
+    }
+    if (Quirks<P>::memory_increments_i) {
+        cpu.instruction_register += inst.x + 1;
+    }
+}
+
+void Cpu::op_00CN(Cpu &cpu, const Instruction &inst) {
+    // 00CN - Scroll the screen down by N rows
+    cpu.graphics.scrollDown(inst.n);
+}
+
+void Cpu::op_00FB(Cpu &cpu, const Instruction &inst) {
+    // 00FB - Scroll the screen right by 4 pixels
+    cpu.graphics.scrollRight();
+}
+
+void Cpu::op_00FC(Cpu &cpu, const Instruction &inst) {
+    // 00FC - Scroll the screen left by 4 pixels
+    cpu.graphics.scrollLeft();
+}
+
+void Cpu::op_00FE(Cpu &cpu, const Instruction &inst) {
+    // 00FE - Switch to the 64x32 mode and clear the screen
+    cpu.graphics.setHires(false);
+    cpu.graphics.clear();
+}
+
+void Cpu::op_00FF(Cpu &cpu, const Instruction &inst) {
+    // 00FF - Switch to the 128x64 mode and clear the screen
+    cpu.graphics.setHires(true);
+    cpu.graphics.clear();
+}
@@ -1,66 +1,367 @@
 #pragma once
 
 #include <cinttypes>
-#include <stack>
 #include "Memory.h"
 #include "Graphics.h"
 #include "Input.h"
-#include <random>
+#include "Instruction.h"
+#include "Jit.h"
+#include "Profiler.h"
+#include "Quirks.h"
+#include "Trace.h"
+#include "Translation.h"
+#include <memory>
 #include <set>
+#include <type_traits>
 
-enum State {
+enum class State : uint8_t {
+    /**
+     * The instruction was executed
+     */
+    Running,
+
+    /**
+     * Execution is paused by FX0A until a key is pressed
+     */
+    WaitingForKey,
 
+    /**
+     * pc left program memory; nothing was executed
+     */
+    PcOutOfBounds,
+
+    /**
+     * 2NNN was executed with a full call stack; the instruction was not executed
+     */
+    StackOverflow,
+
+    /**
+     * 00EE was executed with an empty call stack; the instruction was not executed
+     */
+    StackUnderflow,
 };
 
-class Cpu {
+/**
+ * Returns true if state indicates that the Cpu cannot make progress
+ */
+inline bool isFault(State state) {
+    return state >= State::PcOutOfBounds;
+}
+
+/**
+ * Receives a notification whenever FX18 sets the sound timer
+ */
+class SoundListener {
 public:
-    Cpu(Memory &memory, Graphics &graphics, Input &input, int starting_addr);
-    void step();
+    virtual ~SoundListener() = default;
+
+    /**
+     * The sound timer was set by the instruction at cycle; the buzzer sounds from then until cycle end,
+     * which equals cycle if the timer was set to 0
+     */
+    virtual void onSound(uint64_t cycle, uint64_t end) = 0;
+};
+
+/**
+ * Everything that determines how a Cpu continues executing, as plain data that can be copied with memcpy
+ */
+struct CpuState {
+    /**
+     * The maximum depth of the call stack
+     */
+    static constexpr size_t STACK_SIZE = 16;
 
     /**
      * The program counter register
      */
     uint16_t pc;
-
-    uint8_t data_registers[16]{};
     uint16_t instruction_register;
+    uint8_t data_registers[16];
+
+    uint16_t stack[STACK_SIZE];
+    uint8_t stack_pointer;
+
+    uint8_t delay_timer;
+    uint8_t sound_timer;
+
+    uint8_t waiting_for_key;
+    uint8_t waiting_for_key_reg;
+
+    uint32_t cycles_per_frame;
+
+    /**
+     * Cycles left until the next timer tick, in [1, cycles_per_frame]
+     */
+    uint32_t frame_countdown;
+
+    /**
+     * The number of instructions executed so far, including steps spent waiting for a key
+     */
+    uint64_t cycles;
+
+    /**
+     * xorshift64* state of the random number generator used by CXNN; never 0
+     */
+    uint64_t rng_state;
+};
+
+static_assert(std::is_trivially_copyable<CpuState>::value, "CpuState must be copyable with memcpy");
+
+class Cpu : public MemoryListener, private CpuState {
+public:
+    Cpu(Memory &memory, Graphics &graphics, Input &input, int starting_addr);
+    ~Cpu() override;
+
+    Cpu(const Cpu &) = delete;
+    Cpu &operator=(const Cpu &) = delete;
+
+    /**
+     * Executes a single instruction. A faulting instruction leaves the Cpu unchanged,
+     * so stepping again reports the same fault.
+     */
+    State step();
+
+    /**
+     * Executes the given number of instructions, stopping early at the first fault.
+     * Straight-line code runs as blocks of an attached Translation or, when built with CHIP8_JIT,
+     * as compiled blocks; step() is the fallback.
+     */
+    State run(uint64_t instructions);
+
+    /**
+     * Decodes the instructions in [start, end) ahead of time, e.g. a basic block found by Analysis,
+     * and with CHIP8_JIT also compiles the block starting at start
+     */
+    void prefetch(uint16_t start, uint16_t end);
+
+    /**
+     * Executes an already decoded instruction as if it had been fetched from pc.
+     * Does not consult the decode cache.
+     */
+    State execute(const Instruction &inst);
+
+    /**
+     * Reseeds the random number generator used by CXNN
+     */
+    void seed(uint32_t seed);
+
+    /**
+     * The complete cpu state
+     */
+    const CpuState &snapshot() const;
+
+    /**
+     * Replaces the complete cpu state. Predecoded instructions and compiled blocks only depend on
+     * memory, which is restored separately through Memory::restore().
+     * Returns false, leaving the Cpu untouched, if the state is inconsistent.
+     */
+    bool restore(const CpuState &state);
+
+    /**
+     * Returns true if state can be restored
+     */
+    static bool isValid(const CpuState &state);
+
+    /**
+     * Sets the clock speed as the number of instructions executed per 60 Hz frame of emulated time.
+     * The delay and sound timers count down once every cycles_per_frame cycles.
+     */
+    void setCyclesPerFrame(uint32_t cycles_per_frame);
+    uint32_t cyclesPerFrame() const;
+
+    uint8_t delayTimer() const;
+    uint8_t soundTimer() const;
+
+    /**
+     * The cycle at which the sound timer reaches 0 if nothing sets it again, or the current cycle if it is 0
+     */
+    uint64_t soundEnd() const;
+
+    /**
+     * Attaches a listener told about every FX18, or detaches it when passed nullptr
+     */
+    void setSoundListener(SoundListener *listener);
+
+    /**
+     * Attaches a ring that receives trace records, or detaches it when passed nullptr.
+     * Records are only produced when built with CHIP8_TRACE_LEVEL above CHIP8_TRACE_NONE.
+     */
+    void setTraceBuffer(TraceBuffer *buffer);
+
+    /**
+     * Attaches a profiler that counts every instruction executed, or detaches it when passed nullptr.
+     * Counts are only taken when built with CHIP8_PROFILE. While a profiler is attached, run() executes
+     * every instruction through step(), without compiled blocks or skipping idle loops.
+     */
+    void setProfiler(Profiler *profiler);
+
+    /**
+     * Attaches blocks translated ahead of time, or detaches them when passed nullptr. Only the blocks
+     * matching the current memory are used; load the ROM first. Like compiled blocks, translated ones
+     * are not used while tracing or profiling.
+     * Returns false, detaching any translation, if it was made for another quirk profile.
+     */
+    bool setTranslation(Translation *translation);
+
+    /**
+     * Switches to the handlers instantiated for a quirk profile, Modern until set. Decoded instructions
+     * and compiled blocks are discarded, and an attached translation made for another profile is detached.
+     * The profile is part of the configuration, like the attached listeners, not of the CpuState.
+     */
+    void setQuirks(QuirkProfile profile);
+    QuirkProfile quirks() const;
+
+    /**
+     * Invalidates any predecoded instruction, compiled or translated block that overlaps addr
+     */
+    void onWrite(uint16_t addr) override;
+
+    /**
+     * Discards all predecoded instructions and compiled blocks
+     */
+    void onRestore() override;
+
+    using CpuState::pc;
+    using CpuState::data_registers;
+    using CpuState::instruction_register;
+    using CpuState::cycles;
+    using CpuState::STACK_SIZE;
+
+    /**
+     * The default clock speed: 10 instructions per frame, or 600 Hz
+     */
+    static constexpr uint32_t DEFAULT_CYCLES_PER_FRAME = 10;
 private:
+    friend class BatchCpu;
+
     Memory& memory;
     Graphics& graphics;
     Input& input;
-    std::stack<uint16_t> stack;
 
-    void opcode_0xxx(uint16_t opcode);
-    void opcode_1xxx(uint16_t opcode);
-    void opcode_2xxx(uint16_t opcode);
-    void opcode_3xxx(uint16_t opcode);
-    void opcode_4xxx(uint16_t opcode);
-    void opcode_5xxx(uint16_t opcode);
-    void opcode_6xxx(uint16_t opcode);
-    void opcode_7xxx(uint16_t opcode);
-    void opcode_8xxx(uint16_t opcode);
-    void opcode_9xxx(uint16_t opcode);
-    void opcode_Axxx(uint16_t opcode);
-    void opcode_Bxxx(uint16_t opcode);
-    void opcode_Cxxx(uint16_t opcode);
-    void opcode_Dxxx(uint16_t opcode);
-    void opcode_Exxx(uint16_t opcode);
-    void opcode_Fxxx(uint16_t opcode);
+    using Handler = void (*)(Cpu &cpu, const Instruction &inst);
 
+    /**
+     * A predecoded instruction. A null handler marks a slot that has to be (re)decoded.
+     */
+    struct DecodedInstruction {
+        Handler handler;
+        Instruction instruction;
+    };
+
+    static constexpr uint16_t CACHE_START = 0x200;
+    static constexpr uint16_t CACHE_SIZE = 4096 - CACHE_START;
 
     /**
-     * Indicates if pc should be updated at the end of the cycle.
-     * Should be set to false if a jump has occurred.
+     * Predecoded instructions for every address in 0x200-0xFFF, filled lazily on first execution.
+     * Allocated by the first fetch, so a Cpu that only ever uses execute() stays small.
      */
-    bool skip_update_pc;
+    std::unique_ptr<DecodedInstruction[]> decode_cache;
 
-    std::mt19937 rng;
-    std::uniform_int_distribution<std::mt19937::result_type> rng_dist; // distribution in range [1, 6]
+    /**
+     * Handlers indexed by Op, instantiated for each quirk profile
+     */
+    template<QuirkProfile P>
+    static const Handler handlers[(size_t) Op::Count];
 
-    bool waiting_for_key;
-    uint8_t waiting_for_key_reg;
+    /**
+     * The handlers of the current quirk profile
+     */
+    const Handler *handler_table;
+    QuirkProfile quirk_profile;
 
-    uint8_t delay_timer;
-    uint8_t sound_timer;
+    /**
+     * Block compiler used by run(), created on first use
+     */
+    std::unique_ptr<Jit> jit;
+
+    const DecodedInstruction &fetch(uint16_t addr);
+    State dispatch(Handler handler, const Instruction &inst);
+
+    /**
+     * Accounts for count executed cycles, ticking the timers at every frame boundary crossed
+     */
+    void elapse(uint64_t count);
+
+    /**
+     * Fast-forwards through a loop starting at pc that cannot change anything but the timers
+     * within the next budget instructions: a jump to itself, waiting for a key, spinning on a key,
+     * polling the delay timer or a DXYN waiting for the display. Leaves exactly the state stepping
+     * would, and returns the number of instructions skipped, 0 if pc does not start such a loop.
+     */
+    uint64_t skipIdle(uint64_t budget);
+
+    TraceBuffer *trace_buffer;
+
+    /**
+     * Pushes a record of the current state to the trace buffer, if one is attached.
+     * Use through the CHIP8_TRACE_* macros, so trace points compile to nothing when disabled.
+     */
+    void trace(TraceKind kind, uint16_t addr, uint8_t detail);
+
+    /**
+     * Use through CHIP8_PROFILE_EVENT, so profile points compile to nothing when disabled
+     */
+    Profiler *profiler;
 
+    SoundListener *sound_listener;
+
+    Translation *translation;
+
+    static void op_unknown(Cpu &cpu, const Instruction &inst);
+    static void op_0NNN(Cpu &cpu, const Instruction &inst);
+    static void op_00E0(Cpu &cpu, const Instruction &inst);
+    static void op_00EE(Cpu &cpu, const Instruction &inst);
+    static void op_1NNN(Cpu &cpu, const Instruction &inst);
+    static void op_2NNN(Cpu &cpu, const Instruction &inst);
+    static void op_3XNN(Cpu &cpu, const Instruction &inst);
+    static void op_4XNN(Cpu &cpu, const Instruction &inst);
+    static void op_5XY0(Cpu &cpu, const Instruction &inst);
+    static void op_6XNN(Cpu &cpu, const Instruction &inst);
+    static void op_7XNN(Cpu &cpu, const Instruction &inst);
+    static void op_8XY0(Cpu &cpu, const Instruction &inst);
+    static void op_8XY1(Cpu &cpu, const Instruction &inst);
+    static void op_8XY2(Cpu &cpu, const Instruction &inst);
+    static void op_8XY3(Cpu &cpu, const Instruction &inst);
+    static void op_8XY4(Cpu &cpu, const Instruction &inst);
+    static void op_8XY5(Cpu &cpu, const Instruction &inst);
+    template<QuirkProfile P>
+    static void op_8XY6(Cpu &cpu, const Instruction &inst);
+    static void op_8XY7(Cpu &cpu, const Instruction &inst);
+    template<QuirkProfile P>
+    static void op_8XYE(Cpu &cpu, const Instruction &inst);
+    static void op_9XY0(Cpu &cpu, const Instruction &inst);
+    static void op_ANNN(Cpu &cpu, const Instruction &inst);
+    template<QuirkProfile P>
+    static void op_BNNN(Cpu &cpu, const Instruction &inst);
+    static void op_CXNN(Cpu &cpu, const Instruction &inst);
+    template<QuirkProfile P>
+    static void op_DXYN(Cpu &cpu, const Instruction &inst);
+    static void op_EX9E(Cpu &cpu, const Instruction &inst);
+    static void op_EXA1(Cpu &cpu, const Instruction &inst);
+    static void op_FX07(Cpu &cpu, const Instruction &inst);
+    static void op_FX0A(Cpu &cpu, const Instruction &inst);
+    static void op_FX15(Cpu &cpu, const Instruction &inst);
+    static void op_FX18(Cpu &cpu, const Instruction &inst);
+    static void op_FX1E(Cpu &cpu, const Instruction &inst);
+    static void op_FX29(Cpu &cpu, const Instruction &inst);
+    static void op_FX33(Cpu &cpu, const Instruction &inst);
+    template<QuirkProfile P>
+    static void op_FX55(Cpu &cpu, const Instruction &inst);
+    template<QuirkProfile P>
+    static void op_FX65(Cpu &cpu, const Instruction &inst);
+    static void op_00CN(Cpu &cpu, const Instruction &inst);
+    static void op_00FB(Cpu &cpu, const Instruction &inst);
+    static void op_00FC(Cpu &cpu, const Instruction &inst);
+    static void op_00FE(Cpu &cpu, const Instruction &inst);
+    static void op_00FF(Cpu &cpu, const Instruction &inst);
+
+    /**
+     * Returns the next random byte
+     */
+    uint8_t nextRandom();
+
+    /**
+     * The result of the instruction currently being executed
+     */
+    State state;
 };
@@ -0,0 +1,217 @@
+#include <algorithm>
+#include <cstring>
+#include "FrameStream.h"
+
+static const char FRAME_STREAM_MAGIC[4] = {'C', '8', 'F', 'S'};
+static const uint16_t FRAME_STREAM_VERSION = 2;
+
+// the words of a frame in either mode, one per row or two per high resolution row
+static const size_t FRAME_WORDS = Graphics::HEIGHT;
+static const size_t HIRES_FRAME_WORDS = Graphics::HIRES_HEIGHT * 2;
+
+// frames are buffered and written in chunks of about this size
+static const size_t FLUSH_SIZE = 64 * 1024;
+
+// the largest record: a full varint and the mode, then in the worst case every other byte changed
+static const size_t MAX_RECORD_SIZE = 10 + 1 + HIRES_FRAME_WORDS * 8 / 2 * 3 + 4;
+
+static uint8_t *putVarint(uint8_t *out, uint64_t value) {
+    while (value >= 0x80) {
+        *out++ = (uint8_t) (value | 0x80u);
+        value >>= 7u;
+    }
+    *out++ = (uint8_t) value;
+    return out;
+}
+
+static void put16(uint8_t *out, uint16_t value) {
+    out[0] = (uint8_t) value;
+    out[1] = (uint8_t) (value >> 8u);
+}
+
+static uint8_t *putRun(uint8_t *out, uint64_t zeros, const uint8_t *literals, size_t count) {
+    out = putVarint(out, zeros);
+    out = putVarint(out, count);
+    std::memcpy(out, literals, count);
+    return out + count;
+}
+
+FrameRecorder::FrameRecorder()
+        : file(nullptr), previous{}, previous_hires{}, previous_mode(false), last_cycle(0), frame_count(0) {
+}
+
+bool FrameRecorder::open(FILE *file, uint32_t cycles_per_second) {
+    this->file = file;
+    std::fill(this->previous, this->previous + Graphics::HEIGHT, 0);
+    std::fill(this->previous_hires[0], this->previous_hires[0] + HIRES_FRAME_WORDS, 0);
+    this->previous_mode = false;
+    this->last_cycle = 0;
+    this->frame_count = 0;
+    this->pending.clear();
+
+    uint8_t header[16];
+    std::memcpy(header, FRAME_STREAM_MAGIC, 4);
+    put16(header + 4, FRAME_STREAM_VERSION);
+    put16(header + 6, Graphics::WIDTH);
+    put16(header + 8, Graphics::HEIGHT);
+    put16(header + 10, 0);
+    put16(header + 12, (uint16_t) cycles_per_second);
+    put16(header + 14, (uint16_t) (cycles_per_second >> 16u));
+    return fwrite(header, 1, sizeof(header), file) == sizeof(header);
+}
+
+bool FrameRecorder::capture(const Graphics &graphics, uint64_t cycle) {
+    bool hires = graphics.isHires();
+    const uint64_t *words = hires ? graphics.hires_rows[0] : graphics.rows;
+    uint64_t *previous = hires ? this->previous_hires[0] : this->previous;
+    size_t count = hires ? HIRES_FRAME_WORDS : FRAME_WORDS;
+
+    uint64_t delta[HIRES_FRAME_WORDS];
+    uint64_t changed = 0;
+    for (size_t i = 0; i < count; ++i) {
+        delta[i] = words[i] ^ previous[i];
+        changed |= delta[i];
+    }
+    // the first frame is always written, so a stream is never empty
+    if (changed == 0 && hires == this->previous_mode && this->frame_count > 0) {
+        return true;
+    }
+    std::copy(words, words + count, previous);
+    this->previous_mode = hires;
+
+    // records are encoded on the stack and appended in one go
+    uint8_t record[MAX_RECORD_SIZE];
+    uint8_t *out = putVarint(record, cycle - this->last_cycle);
+    *out++ = hires ? 1 : 0;
+    this->last_cycle = cycle;
+
+    // alternate runs of unchanged bytes and runs of changed bytes; most rows do not change at all,
+    // so only the bytes of changed rows are looked at one by one
+    uint64_t zeros = 0;
+    uint8_t literals[HIRES_FRAME_WORDS * 8];
+    size_t literal_count = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (delta[i] == 0 && literal_count == 0) {
+            zeros += 8;
+            continue;
+        }
+        for (unsigned b = 0; b < 8; ++b) {
+            auto byte = (uint8_t) (delta[i] >> (56u - 8u * b));
+            if (byte != 0) {
+                literals[literal_count++] = byte;
+                continue;
+            }
+            if (literal_count > 0) {
+                out = putRun(out, zeros, literals, literal_count);
+                zeros = 0;
+                literal_count = 0;
+            }
+            zeros++;
+        }
+    }
+    out = putRun(out, zeros, literals, literal_count);
+    this->pending.insert(this->pending.end(), record, out);
+
+    this->frame_count++;
+    return this->pending.size() < FLUSH_SIZE || this->flush();
+}
+
+bool FrameRecorder::flush() {
+    if (this->pending.empty()) {
+        return true;
+    }
+    bool written = fwrite(this->pending.data(), 1, this->pending.size(), this->file) == this->pending.size();
+    this->pending.clear();
+    return written;
+}
+
+uint64_t FrameRecorder::frames() const {
+    return this->frame_count;
+}
+
+FrameReader::FrameReader()
+        : file(nullptr), version(0), cycles_per_second(0), previous{}, previous_hires{}, last_cycle(0) {
+}
+
+bool FrameReader::open(FILE *file) {
+    this->file = file;
+    std::fill(this->previous, this->previous + Graphics::HEIGHT, 0);
+    std::fill(this->previous_hires[0], this->previous_hires[0] + HIRES_FRAME_WORDS, 0);
+    this->last_cycle = 0;
+
+    uint8_t header[16];
+    if (fread(header, 1, sizeof(header), file) != sizeof(header) || memcmp(header, FRAME_STREAM_MAGIC, 4) != 0) {
+        return false;
+    }
+    auto get16 = [&header](int offset) {
+        return (uint16_t) (header[offset] | (header[offset + 1] << 8u));
+    };
+    this->version = get16(4);
+    this->cycles_per_second = get16(12) | ((uint32_t) get16(14) << 16u);
+    return this->version >= 1 && this->version <= FRAME_STREAM_VERSION && get16(6) == Graphics::WIDTH
+           && get16(8) == Graphics::HEIGHT;
+}
+
+uint32_t FrameReader::cyclesPerSecond() const {
+    return this->cycles_per_second;
+}
+
+bool FrameReader::readVarint(uint64_t &value) {
+    value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        int c = fgetc(this->file);
+        if (c == EOF) {
+            return false;
+        }
+        value |= (uint64_t) (c & 0x7F) << shift;
+        if (!(c & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool FrameReader::next(uint64_t &cycle, Graphics::Screen &screen) {
+    uint64_t elapsed;
+    if (!this->readVarint(elapsed)) {
+        return false;
+    }
+    int mode = this->version >= 2 ? fgetc(this->file) : 0;
+    if (mode != 0 && mode != 1) {
+        return false;
+    }
+    uint64_t *previous = mode ? this->previous_hires[0] : this->previous;
+    size_t count = mode ? HIRES_FRAME_WORDS : FRAME_WORDS;
+    size_t frame_bytes = count * 8;
+
+    uint8_t bytes[HIRES_FRAME_WORDS * 8]{};
+    size_t i = 0;
+    while (i < frame_bytes) {
+        // the recorder never writes empty runs, and one would never advance
+        uint64_t zeros, literals;
+        if (!this->readVarint(zeros) || !this->readVarint(literals) || zeros + literals == 0
+            || zeros + literals > frame_bytes - i) {
+            return false;
+        }
+        i += zeros;
+        if (fread(bytes + i, 1, literals, this->file) != literals) {
+            return false;
+        }
+        i += literals;
+    }
+
+    for (size_t w = 0; w < count; ++w) {
+        uint64_t delta = 0;
+        for (size_t b = 0; b < 8; ++b) {
+            delta = (delta << 8u) | bytes[w * 8 + b];
+        }
+        previous[w] ^= delta;
+    }
+    screen.hires = mode == 1;
+    std::copy(this->previous, this->previous + Graphics::HEIGHT, screen.rows);
+    std::copy(this->previous_hires[0], this->previous_hires[0] + HIRES_FRAME_WORDS, screen.hires_rows[0]);
+
+    this->last_cycle += elapsed;
+    cycle = this->last_cycle;
+    return true;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include "Graphics.h"
+
+/*
+ * Frame streams start with a 16 byte header:
+ *   "C8FS" magic, uint16 version, uint16 width, uint16 height, uint16 reserved, uint32 cycles per second
+ * followed by one record per frame:
+ *   varint cycles since the previous frame (since cycle 0 for the first frame),
+ *   a byte holding the mode, 0 for the WIDTH x HEIGHT screen and 1 for the HIRES_WIDTH x HIRES_HEIGHT one,
+ *   then the frame XORed with the previous frame of that mode (all pixels clear before the first) as
+ *   pairs of varint zero bytes and varint literal bytes followed by those literals, until all
+ *   width * height / 8 bytes of the mode are covered. Bytes are taken row by row, leftmost pixel in the MSB.
+ * Multi-byte header fields are little-endian. Varints are LEB128. Version 1 streams have no mode
+ * byte and only hold WIDTH x HEIGHT frames.
+ */
+
+/**
+ * Writes frames to a frame stream. Frames identical to the previous one are dropped, since the
+ * timestamp of the next frame already says how long it stayed on screen, so a recorder can simply
+ * be fed every presented frame.
+ */
+class FrameRecorder {
+public:
+    FrameRecorder();
+
+    FrameRecorder(const FrameRecorder &) = delete;
+    FrameRecorder &operator=(const FrameRecorder &) = delete;
+
+    /**
+     * Starts a stream in file. The file stays owned by the caller.
+     * cycles_per_second converts cycle timestamps to time, e.g. 60 * Cpu::cyclesPerFrame().
+     */
+    bool open(FILE *file, uint32_t cycles_per_second);
+
+    /**
+     * Appends the frame shown at the given cpu cycle, in whichever mode is shown, unless it matches
+     * the previous frame. Cycles must not decrease.
+     */
+    bool capture(const Graphics &graphics, uint64_t cycle);
+
+    /**
+     * Writes any buffered frames to the file
+     */
+    bool flush();
+
+    uint64_t frames() const;
+
+private:
+    FILE *file;
+    uint64_t previous[Graphics::HEIGHT];
+    uint64_t previous_hires[Graphics::HIRES_HEIGHT][2];
+    bool previous_mode;
+    uint64_t last_cycle;
+    uint64_t frame_count;
+    std::vector<uint8_t> pending;
+};
+
+/**
+ * Reads the frames of a stream written by FrameRecorder
+ */
+class FrameReader {
+public:
+    FrameReader();
+
+    /**
+     * Reads the header. Returns false if file does not start a frame stream of this or an earlier version.
+     */
+    bool open(FILE *file);
+
+    uint32_t cyclesPerSecond() const;
+
+    /**
+     * Decodes the next frame into screen. Both of its buffers are filled, the one of the mode not shown
+     * with the last frame in that mode. Returns false at the end of the stream or on corrupt data.
+     */
+    bool next(uint64_t &cycle, Graphics::Screen &screen);
+
+private:
+    FILE *file;
+    uint16_t version;
+    uint32_t cycles_per_second;
+    uint64_t previous[Graphics::HEIGHT];
+    uint64_t previous_hires[Graphics::HIRES_HEIGHT][2];
+    uint64_t last_cycle;
+
+    bool readVarint(uint64_t &value);
+};
@@ -1,8 +1,12 @@
 #include <algorithm>
 #include "Graphics.h"
 
-const uint32_t UNSET_VAL = 0xFF'00'00'00;
-const uint32_t SET_VAL = 0xFF'FF'FF'FF;
+constexpr int Graphics::WIDTH;
+constexpr int Graphics::HEIGHT;
+constexpr int Graphics::HIRES_WIDTH;
+constexpr int Graphics::HIRES_HEIGHT;
+constexpr uint32_t Graphics::UNSET_VAL;
+constexpr uint32_t Graphics::SET_VAL;
 
 static constexpr uint8_t font_data[80] = {
         0xF0, 0x90, 0x90, 0x90, 0xF0,
@@ -26,39 +30,327 @@ static constexpr uint8_t font_data[80] = {
 
 Graphics::Graphics(Memory &memory) : memory(memory) {
     std::copy(font_data, font_data + 80, memory.memory);
-    this->dirty = false;
+    this->dirty_rows = 0;
+    this->hires = false;
+    this->clean_hires = false;
+    this->clean_valid = false;
+    std::fill(this->hires_rows[0], this->hires_rows[0] + 2 * HIRES_HEIGHT, 0);
     this->clear();
 }
 
+/**
+ * A mask with a bit for each of height rows
+ */
+static inline uint64_t allRows(int height) {
+    return height >= 64 ? ~0ull : (1ull << (unsigned) height) - 1;
+}
 
 bool Graphics::isDirty() const {
-    return this->dirty;
+    return this->dirty_rows != 0;
 }
 
 void Graphics::setDirty() {
-    this->dirty = true;
+    this->dirty_rows = allRows(this->height());
 }
 
 void Graphics::clearDirty() {
-    this->dirty = false;
+    // only touched rows can differ from the copy, unless the copy is of the other mode
+    uint64_t rows = this->clean_valid && this->clean_hires == this->hires ? this->dirty_rows : allRows(this->height());
+    int first, count;
+    while (nextSpan(rows, first, count)) {
+        if (this->hires) {
+            std::copy(this->hires_rows[0] + 2 * first, this->hires_rows[0] + 2 * (first + count),
+                      this->clean_hires_rows[0] + 2 * first);
+        } else {
+            std::copy(this->rows + first, this->rows + first + count, this->clean_rows + first);
+        }
+    }
+    this->clean_hires = this->hires;
+    this->clean_valid = true;
+    this->dirty_rows = 0;
+}
+
+uint64_t Graphics::dirtyRows() const {
+    return this->dirty_rows;
+}
+
+uint64_t Graphics::changedRows() const {
+    if (!this->clean_valid || this->clean_hires != this->hires) {
+        return allRows(this->height());
+    }
+
+    uint64_t changed = 0;
+    for (int y = 0; y < this->height(); ++y) {
+        if (!(this->dirty_rows & (1ull << (unsigned) y))) {
+            continue;
+        }
+        bool differs = this->hires ? this->hires_rows[y][0] != this->clean_hires_rows[y][0]
+                                     || this->hires_rows[y][1] != this->clean_hires_rows[y][1]
+                                   : this->rows[y] != this->clean_rows[y];
+        changed |= differs ? 1ull << (unsigned) y : 0;
+    }
+    return changed;
+}
+
+bool Graphics::nextSpan(uint64_t &rows, int &first, int &count) {
+    if (rows == 0) {
+        return false;
+    }
+    first = 0;
+    while (!(rows & (1ull << (unsigned) first))) {
+        first++;
+    }
+    count = 0;
+    while (first + count < 64 && (rows & (1ull << (unsigned) (first + count)))) {
+        rows &= ~(1ull << (unsigned) (first + count));
+        count++;
+    }
+    return true;
+}
+
+inline void Graphics::markRows(int first, int count) {
+    int height = this->height();
+    count = std::min(count, height);
+    uint64_t span = allRows(count);
+    uint64_t mask = span << (unsigned) first;
+    if (first + count > height) {
+        mask |= span >> (unsigned) (height - first);
+    }
+    this->dirty_rows |= mask & allRows(height);
+}
+
+bool Graphics::isHires() const {
+    return this->hires;
+}
+
+void Graphics::setHires(bool hires) {
+    this->hires = hires;
+    setDirty();
+}
+
+int Graphics::width() const {
+    return this->hires ? HIRES_WIDTH : WIDTH;
+}
+
+int Graphics::height() const {
+    return this->hires ? HIRES_HEIGHT : HEIGHT;
 }
 
 void Graphics::clear() {
-    for (int i = 0; i < 64 * 32; ++i) {
-        buffer[i] = UNSET_VAL;
+    if (this->hires) {
+        std::fill(this->hires_rows[0], this->hires_rows[0] + 2 * HIRES_HEIGHT, 0);
+    } else {
+        std::fill(this->rows, this->rows + HEIGHT, 0);
     }
     setDirty();
 }
 
+static inline uint64_t pixelMask(uint16_t x) {
+    return (uint64_t) 1u << (63u - x);
+}
+
+/**
+ * The word holding pixel x in the current mode, and x within it
+ */
+static inline uint64_t &pixelWord(Graphics &graphics, uint16_t &x, uint16_t y) {
+    if (graphics.isHires()) {
+        x %= Graphics::HIRES_WIDTH;
+        uint64_t &word = graphics.hires_rows[y % Graphics::HIRES_HEIGHT][x / 64];
+        x %= 64;
+        return word;
+    }
+    x %= Graphics::WIDTH;
+    return graphics.rows[y % Graphics::HEIGHT];
+}
+
 void Graphics::set(uint16_t x, uint16_t y, uint8_t val) {
-    x %= 64;
-    y %= 32;
-    uint32_t screen_val = (val != 0 ? SET_VAL : UNSET_VAL);
-    this->buffer[x + (y * 64)] = screen_val;
+    uint64_t &word = pixelWord(*this, x, y);
+    if (val != 0) {
+        word |= pixelMask(x);
+    } else {
+        word &= ~pixelMask(x);
+    }
 
-    setDirty();
+    markRows(y % this->height(), 1);
 }
 
 uint8_t Graphics::get(uint16_t x, uint16_t y) {
-    return (this->buffer[x + (y * 64)] == UNSET_VAL) ? 0 : 1;
+    return (pixelWord(*this, x, y) & pixelMask(x)) ? 1 : 0;
+}
+
+static inline uint64_t rotateRight(uint64_t val, unsigned amount) {
+    return amount == 0 ? val : (val >> amount) | (val << (64u - amount));
+}
+
+template<bool Clip>
+uint8_t Graphics::draw(uint8_t x, uint8_t y, const uint8_t *sprite, uint8_t n) {
+    if (this->hires) {
+        y %= HIRES_HEIGHT;
+        int rows = Clip ? std::min<int>(n, HIRES_HEIGHT - y) : n;
+        uint64_t collision = 0;
+        for (int i = 0; i < rows; ++i) {
+            collision |= this->drawHiresRow<Clip>((uint64_t) sprite[i] << 56u, x, (uint8_t) (y + i));
+        }
+        markRows(y, rows);
+        return collision != 0 ? 1 : 0;
+    }
+
+    x %= WIDTH;
+    y %= HEIGHT;
+    int rows = Clip ? std::min<int>(n, HEIGHT - y) : n;
+
+    uint64_t collision = 0;
+    for (int i = 0; i < rows; ++i) {
+        // place the sprite byte at the left edge, then move it into position: rotating wraps it
+        // around the right edge, shifting cuts it off
+        uint64_t bits = (uint64_t) sprite[i] << 56u;
+        bits = Clip ? bits >> x : rotateRight(bits, x);
+        uint64_t &row = this->rows[(y + i) % HEIGHT];
+        collision |= row & bits;
+        row ^= bits;
+    }
+
+    markRows(y, rows);
+    return collision != 0 ? 1 : 0;
+}
+
+template<bool Clip>
+uint8_t Graphics::drawLarge(uint8_t x, uint8_t y, const uint8_t *sprite) {
+    y %= this->height();
+    int rows = Clip ? std::min(16, this->height() - y) : 16;
+    uint64_t collision = 0;
+    for (int i = 0; i < rows; ++i) {
+        uint64_t bits = (uint64_t) ((sprite[2 * i] << 8u) | sprite[2 * i + 1]) << 48u;
+        if (this->hires) {
+            collision |= this->drawHiresRow<Clip>(bits, x, (uint8_t) (y + i));
+        } else {
+            bits = Clip ? bits >> (x % WIDTH) : rotateRight(bits, x % WIDTH);
+            uint64_t &row = this->rows[(y + i) % HEIGHT];
+            collision |= row & bits;
+            row ^= bits;
+        }
+    }
+
+    markRows(y, rows);
+    return collision != 0 ? 1 : 0;
+}
+
+template<bool Clip>
+uint64_t Graphics::drawHiresRow(uint64_t bits, uint8_t x, uint8_t y) {
+    // rotate the 128 bit row (bits, 0) right by x: swap the halves for the whole words, then shift.
+    // Only what moves from the right half into the left one wraps around the edge.
+    x %= HIRES_WIDTH;
+    uint64_t left = x < 64 ? bits : 0, right = x < 64 ? 0 : bits;
+    unsigned shift = x % 64u;
+    if (shift != 0) {
+        uint64_t carry = left << (64u - shift);
+        left = (left >> shift) | (Clip ? 0 : right << (64u - shift));
+        right = (right >> shift) | carry;
+    }
+
+    uint64_t *row = this->hires_rows[y % HIRES_HEIGHT];
+    uint64_t collision = (row[0] & left) | (row[1] & right);
+    row[0] ^= left;
+    row[1] ^= right;
+    return collision;
+}
+
+template uint8_t Graphics::draw<false>(uint8_t x, uint8_t y, const uint8_t *sprite, uint8_t n);
+template uint8_t Graphics::draw<true>(uint8_t x, uint8_t y, const uint8_t *sprite, uint8_t n);
+template uint8_t Graphics::drawLarge<false>(uint8_t x, uint8_t y, const uint8_t *sprite);
+template uint8_t Graphics::drawLarge<true>(uint8_t x, uint8_t y, const uint8_t *sprite);
+
+/*
+ * Scrolling moves whole words: rows are copied as a block, and sideways scrolls shift every word,
+ * carrying across the halves of a hi-res row. The row loops have no dependencies between iterations,
+ * so they vectorize.
+ */
+
+void Graphics::scrollDown(uint8_t n) {
+    if (this->hires) {
+        uint64_t *words = this->hires_rows[0];
+        size_t shift = 2u * std::min<size_t>(n, HIRES_HEIGHT);
+        std::copy_backward(words, words + 2 * HIRES_HEIGHT - shift, words + 2 * HIRES_HEIGHT);
+        std::fill(words, words + shift, 0);
+    } else {
+        size_t shift = std::min<size_t>(n, HEIGHT);
+        std::copy_backward(this->rows, this->rows + HEIGHT - shift, this->rows + HEIGHT);
+        std::fill(this->rows, this->rows + shift, 0);
+    }
+    setDirty();
+}
+
+void Graphics::scrollRight() {
+    if (this->hires) {
+        for (auto &row : this->hires_rows) {
+            row[1] = (row[1] >> 4u) | (row[0] << 60u);
+            row[0] >>= 4u;
+        }
+    } else {
+        for (auto &row : this->rows) {
+            row >>= 4u;
+        }
+    }
+    setDirty();
+}
+
+void Graphics::scrollLeft() {
+    if (this->hires) {
+        for (auto &row : this->hires_rows) {
+            row[0] = (row[0] << 4u) | (row[1] >> 60u);
+            row[1] <<= 4u;
+        }
+    } else {
+        for (auto &row : this->rows) {
+            row <<= 4u;
+        }
+    }
+    setDirty();
+}
+
+/**
+ * Expands one word of pixels into 64 ARGB values
+ */
+static inline void expandWord(uint64_t word, uint32_t *out) {
+    // branchless select, so the loop vectorizes
+    for (int x = 0; x < 64; ++x) {
+        uint32_t set = (uint32_t) 0 - (uint32_t) ((word >> (63u - x)) & 1u);
+        out[x] = Graphics::UNSET_VAL ^ (set & (Graphics::SET_VAL ^ Graphics::UNSET_VAL));
+    }
+}
+
+void Graphics::toARGB(uint32_t *out) const {
+    this->toARGB(out, 0, this->height());
+}
+
+void Graphics::toARGB(uint32_t *out, int first, int count) const {
+    if (this->hires) {
+        for (int y = first; y < first + count; ++y) {
+            expandWord(this->hires_rows[y][0], out + y * HIRES_WIDTH);
+            expandWord(this->hires_rows[y][1], out + y * HIRES_WIDTH + 64);
+        }
+        return;
+    }
+    for (int y = first; y < first + count; ++y) {
+        expandWord(this->rows[y], out + y * WIDTH);
+    }
+}
+
+void Graphics::copyTo(Screen &screen) const {
+    screen.hires = this->hires;
+    if (this->hires) {
+        std::copy(this->hires_rows[0], this->hires_rows[0] + 2 * HIRES_HEIGHT, screen.hires_rows[0]);
+    } else {
+        std::copy(this->rows, this->rows + HEIGHT, screen.rows);
+    }
+}
+
+void Graphics::copyFrom(const Screen &screen) {
+    this->hires = screen.hires;
+    if (this->hires) {
+        std::copy(screen.hires_rows[0], screen.hires_rows[0] + 2 * HIRES_HEIGHT, this->hires_rows[0]);
+    } else {
+        std::copy(screen.rows, screen.rows + HEIGHT, this->rows);
+    }
+    setDirty();
 }
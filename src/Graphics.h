@@ -5,35 +5,169 @@
 
 class Graphics {
 public:
+    static constexpr int WIDTH = 64;
+    static constexpr int HEIGHT = 32;
+
+    /**
+     * Size of the SUPER-CHIP high resolution mode
+     */
+    static constexpr int HIRES_WIDTH = 128;
+    static constexpr int HIRES_HEIGHT = 64;
+
+    /**
+     * ARGB colors of unset and set pixels
+     */
+    static constexpr uint32_t UNSET_VAL = 0xFF'00'00'00;
+    static constexpr uint32_t SET_VAL = 0xFF'FF'FF'FF;
+
+    /**
+     * A plain copy of the screen, for handing it to another thread
+     */
+    struct Screen {
+        bool hires;
+        uint64_t rows[HEIGHT];
+        uint64_t hires_rows[HIRES_HEIGHT][2];
+    };
+
     Graphics(Memory& memory);
 
     Memory& memory;
 
     /**
-     * Returns true if the buffer should be re-rendered
+     * Returns true if any row was touched since the last clearDirty(), so the buffer should be re-rendered
      */
     bool isDirty() const;
 
     /**
-     * Sets the dirty flag to true
+     * Marks every row as touched
      */
     void setDirty();
 
     /**
-     * Sets the dirty flag to false
+     * Marks the current screen as rendered: remembers it, so changedRows() can tell what a later frame
+     * actually changed, and clears the touched rows
      */
     void clearDirty();
 
+    /**
+     * The rows touched since the last clearDirty(), one bit per row of the current mode, bit y for row y
+     */
+    uint64_t dirtyRows() const;
+
+    /**
+     * The rows that differ from the screen at the last clearDirty(), in the same layout as dirtyRows().
+     * Touched rows that ended up as they were, like a sprite drawn and erased again, are left out.
+     * Every row differs after a mode switch, or before the first clearDirty().
+     */
+    uint64_t changedRows() const;
+
+    /**
+     * Takes the lowest run of adjacent rows out of rows, a mask like changedRows(), and returns its
+     * first row and number of rows. Returns false once rows is empty.
+     */
+    static bool nextSpan(uint64_t &rows, int &first, int &count);
+
+    /**
+     * Returns true in the SUPER-CHIP 128x64 mode, false in the 64x32 mode
+     */
+    bool isHires() const;
+
+    /**
+     * Switches between the 64x32 and 128x64 modes. Each mode keeps its own screen, so this
+     * does not clear anything.
+     */
+    void setHires(bool hires);
+
+    /**
+     * The size of the screen in the current mode
+     */
+    int width() const;
+    int height() const;
+
     /**
      * Clears the entire screen
      */
     void clear();
 
+    /**
+     * Pixel access in the current mode; coordinates wrap around the edges
+     */
     void set(uint16_t x, uint16_t y, uint8_t val);
     uint8_t get(uint16_t x, uint16_t y);
 
-    uint32_t buffer[64 * 32];
+    /**
+     * XORs an 8 pixel wide sprite of n rows onto the screen at (x, y). The position wraps around the
+     * edges; the pixels past them wrap too, or with Clip are cut off.
+     * Returns 1 if any set pixel was unset, 0 otherwise.
+     */
+    template<bool Clip = false>
+    uint8_t draw(uint8_t x, uint8_t y, const uint8_t *sprite, uint8_t n);
+
+    /**
+     * XORs a 16x16 sprite of 32 bytes, two per row, onto the screen at (x, y), like draw()
+     */
+    template<bool Clip = false>
+    uint8_t drawLarge(uint8_t x, uint8_t y, const uint8_t *sprite);
+
+    /**
+     * Scrolls the screen down by n rows, or right or left by 4 pixels, filling in unset pixels
+     */
+    void scrollDown(uint8_t n);
+    void scrollRight();
+    void scrollLeft();
+
+    /**
+     * Expands the screen into width() * height() ARGB pixels, row by row.
+     * Only needed when a frame is actually presented.
+     */
+    void toARGB(uint32_t *out) const;
+
+    /**
+     * Expands count rows starting at first, leaving the rest of out untouched
+     */
+    void toARGB(uint32_t *out, int first, int count) const;
+
+    /**
+     * Copies the mode and the screen of that mode; the other mode's rows are left as they were
+     */
+    void copyTo(Screen &screen) const;
+
+    /**
+     * Replaces the mode and its screen with a copy made by copyTo(), marking every row as touched
+     */
+    void copyFrom(const Screen &screen);
+
+    /**
+     * One word per row; the most significant bit is the leftmost pixel
+     */
+    uint64_t rows[HEIGHT];
+
+    /**
+     * The 128x64 screen, two words per row, the left half first
+     */
+    uint64_t hires_rows[HIRES_HEIGHT][2];
 
 private:
-    bool dirty;
+    uint64_t dirty_rows;
+    bool hires;
+
+    /**
+     * The screen at the last clearDirty()
+     */
+    uint64_t clean_rows[HEIGHT];
+    uint64_t clean_hires_rows[HIRES_HEIGHT][2];
+    bool clean_hires;
+    bool clean_valid;
+
+    /**
+     * Marks count rows starting at first, which is below height(), as touched, wrapping around the bottom edge
+     */
+    void markRows(int first, int count);
+
+    /**
+     * XORs bits, a row of pixels starting at the most significant bit, onto the 128x64 screen at
+     * (x, y), wrapping around the edges or with Clip cut off at the right one. Returns the pixels that were unset.
+     */
+    template<bool Clip>
+    uint64_t drawHiresRow(uint64_t bits, uint8_t x, uint8_t y);
 };
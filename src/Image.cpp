@@ -0,0 +1,269 @@
+#include <algorithm>
+#include <cstring>
+#include "Image.h"
+
+IndexedImage renderRows(const uint64_t *rows, int width, int height, int scale) {
+    IndexedImage image{width * scale, height * scale, {0x000000, 0xFFFFFF}, {}};
+    image.pixels.resize((size_t) image.width * image.height);
+
+    for (int y = 0; y < image.height; ++y) {
+        uint64_t row = rows[y / scale];
+        uint8_t *line = image.pixels.data() + (size_t) y * image.width;
+        for (int x = 0; x < image.width; ++x) {
+            line[x] = (uint8_t) ((row >> (63u - x / scale)) & 1u);
+        }
+    }
+    return image;
+}
+
+IndexedImage renderRows(const uint64_t (*rows)[2], int width, int height, int scale) {
+    IndexedImage image{width * scale, height * scale, {0x000000, 0xFFFFFF}, {}};
+    image.pixels.resize((size_t) image.width * image.height);
+
+    for (int y = 0; y < image.height; ++y) {
+        const uint64_t *row = rows[y / scale];
+        uint8_t *line = image.pixels.data() + (size_t) y * image.width;
+        for (int x = 0; x < image.width; ++x) {
+            int pixel = x / scale;
+            line[x] = (uint8_t) ((row[pixel / 64] >> (63u - pixel % 64)) & 1u);
+        }
+    }
+    return image;
+}
+
+namespace {
+struct CrcTable {
+    uint32_t entries[256];
+
+    CrcTable() : entries() {
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1u) ? 0xEDB88320u ^ (c >> 1u) : c >> 1u;
+            }
+            this->entries[n] = c;
+        }
+    }
+};
+}
+
+uint32_t crc32(const uint8_t *data, size_t size, uint32_t crc) {
+    static const CrcTable table;
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table.entries[(crc ^ data[i]) & 0xFFu] ^ (crc >> 8u);
+    }
+    return ~crc;
+}
+
+uint32_t adler32(const uint8_t *data, size_t size) {
+    uint32_t a = 1, b = 0;
+    for (size_t i = 0; i < size; ++i) {
+        a = (a + data[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    return (b << 16u) | a;
+}
+
+static void putBe32(std::vector<uint8_t> &out, uint32_t value) {
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        out.push_back((uint8_t) (value >> (unsigned) shift));
+    }
+}
+
+static bool writeChunk(FILE *file, const char *type, const std::vector<uint8_t> &data) {
+    std::vector<uint8_t> chunk;
+    putBe32(chunk, (uint32_t) data.size());
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), data.begin(), data.end());
+    putBe32(chunk, crc32(chunk.data() + 4, chunk.size() - 4));
+    return fwrite(chunk.data(), 1, chunk.size(), file) == chunk.size();
+}
+
+bool writePng(FILE *file, const IndexedImage &image) {
+    static const uint8_t signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+    std::vector<uint8_t> header;
+    putBe32(header, (uint32_t) image.width);
+    putBe32(header, (uint32_t) image.height);
+    // 8 bits per pixel, palette colors, deflate, adaptive filtering, no interlacing
+    header.insert(header.end(), {8, 3, 0, 0, 0});
+
+    std::vector<uint8_t> palette;
+    for (uint32_t color : image.palette) {
+        palette.insert(palette.end(), {(uint8_t) (color >> 16u), (uint8_t) (color >> 8u), (uint8_t) color});
+    }
+
+    // every scanline starts with filter type 0, no filtering
+    std::vector<uint8_t> raw;
+    raw.reserve((size_t) (image.width + 1) * image.height);
+    for (int y = 0; y < image.height; ++y) {
+        raw.push_back(0);
+        const uint8_t *line = image.pixels.data() + (size_t) y * image.width;
+        raw.insert(raw.end(), line, line + image.width);
+    }
+
+    // zlib stream of stored deflate blocks
+    std::vector<uint8_t> data = {0x78, 0x01};
+    size_t offset = 0;
+    do {
+        size_t length = std::min<size_t>(raw.size() - offset, 0xFFFF);
+        bool last = offset + length == raw.size();
+        data.insert(data.end(), {(uint8_t) (last ? 1 : 0), (uint8_t) length, (uint8_t) (length >> 8u),
+                                 (uint8_t) ~length, (uint8_t) (~length >> 8u)});
+        data.insert(data.end(), raw.begin() + offset, raw.begin() + offset + length);
+        offset += length;
+    } while (offset < raw.size());
+    putBe32(data, adler32(raw.data(), raw.size()));
+
+    return fwrite(signature, 1, sizeof(signature), file) == sizeof(signature)
+           && writeChunk(file, "IHDR", header)
+           && writeChunk(file, "PLTE", palette)
+           && writeChunk(file, "IDAT", data)
+           && writeChunk(file, "IEND", {});
+}
+
+/**
+ * Packs variable-width LZW codes least significant bit first into 255 byte GIF sub-blocks
+ */
+class GifBitWriter {
+public:
+    explicit GifBitWriter(std::vector<uint8_t> &out) : out(out), bits(0), count(0) {}
+
+    void write(uint32_t code, unsigned size) {
+        this->bits |= code << this->count;
+        this->count += size;
+        while (this->count >= 8) {
+            this->block.push_back((uint8_t) this->bits);
+            this->bits >>= 8u;
+            this->count -= 8;
+            if (this->block.size() == 255) {
+                this->flushBlock();
+            }
+        }
+    }
+
+    void finish() {
+        if (this->count > 0) {
+            this->block.push_back((uint8_t) this->bits);
+        }
+        this->flushBlock();
+        this->out.push_back(0);
+    }
+
+private:
+    std::vector<uint8_t> &out;
+    std::vector<uint8_t> block;
+    uint32_t bits;
+    unsigned count;
+
+    void flushBlock() {
+        if (!this->block.empty()) {
+            this->out.push_back((uint8_t) this->block.size());
+            this->out.insert(this->out.end(), this->block.begin(), this->block.end());
+            this->block.clear();
+        }
+    }
+};
+
+GifWriter::GifWriter() : file(nullptr), width(0), height(0), color_bits(1) {
+}
+
+static void putLe16(std::vector<uint8_t> &out, uint16_t value) {
+    out.push_back((uint8_t) value);
+    out.push_back((uint8_t) (value >> 8u));
+}
+
+bool GifWriter::open(FILE *file, int width, int height, const std::vector<uint32_t> &palette) {
+    this->file = file;
+    this->width = width;
+    this->height = height;
+    this->color_bits = 1;
+    while ((1u << this->color_bits) < palette.size() && this->color_bits < 8) {
+        this->color_bits++;
+    }
+
+    std::vector<uint8_t> out = {'G', 'I', 'F', '8', '9', 'a'};
+    putLe16(out, (uint16_t) width);
+    putLe16(out, (uint16_t) height);
+    // global color table of 2^color_bits entries
+    out.push_back((uint8_t) (0x80u | ((this->color_bits - 1) << 4u) | (this->color_bits - 1)));
+    out.push_back(0);
+    out.push_back(0);
+    for (unsigned i = 0; i < (1u << this->color_bits); ++i) {
+        uint32_t color = i < palette.size() ? palette[i] : 0;
+        out.insert(out.end(), {(uint8_t) (color >> 16u), (uint8_t) (color >> 8u), (uint8_t) color});
+    }
+
+    // loop forever
+    const char netscape[] = "NETSCAPE2.0";
+    out.insert(out.end(), {0x21, 0xFF, 0x0B});
+    out.insert(out.end(), netscape, netscape + 11);
+    out.insert(out.end(), {0x03, 0x01, 0x00, 0x00, 0x00});
+
+    return fwrite(out.data(), 1, out.size(), file) == out.size();
+}
+
+bool GifWriter::addFrame(const IndexedImage &image, uint16_t delay) {
+    std::vector<uint8_t> out = {0x21, 0xF9, 0x04, 0x00};
+    putLe16(out, delay);
+    out.insert(out.end(), {0x00, 0x00, 0x2C, 0x00, 0x00, 0x00, 0x00});
+    putLe16(out, (uint16_t) this->width);
+    putLe16(out, (uint16_t) this->height);
+    out.push_back(0);
+
+    const unsigned min_code_size = std::max(2u, this->color_bits);
+    const uint32_t clear_code = 1u << min_code_size;
+    out.push_back((uint8_t) min_code_size);
+
+    // children[code * symbols + pixel] is the code extending code by pixel, or 0
+    const uint32_t symbols = 1u << min_code_size;
+    std::vector<uint16_t> children(4096 * symbols, 0);
+    unsigned code_size = min_code_size + 1;
+    uint32_t max_code = clear_code + 1;
+
+    GifBitWriter bits(out);
+    bits.write(clear_code, code_size);
+
+    int32_t current = -1;
+    for (uint8_t pixel : image.pixels) {
+        if (current < 0) {
+            current = pixel;
+            continue;
+        }
+
+        uint16_t &child = children[current * symbols + pixel];
+        if (child != 0) {
+            current = child;
+            continue;
+        }
+
+        bits.write((uint32_t) current, code_size);
+        child = (uint16_t) ++max_code;
+        if (max_code >= (1u << code_size)) {
+            code_size++;
+        }
+        if (max_code == 4095) {
+            // the table is full; start over
+            bits.write(clear_code, code_size);
+            std::fill(children.begin(), children.end(), 0);
+            code_size = min_code_size + 1;
+            max_code = clear_code + 1;
+        }
+        current = pixel;
+    }
+
+    if (current >= 0) {
+        bits.write((uint32_t) current, code_size);
+    }
+    bits.write(clear_code, code_size);
+    bits.write(clear_code + 1, min_code_size + 1);
+    bits.finish();
+
+    return fwrite(out.data(), 1, out.size(), this->file) == out.size();
+}
+
+bool GifWriter::close() {
+    return fputc(0x3B, this->file) != EOF;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+/**
+ * A palette image: one palette index per pixel, row by row
+ */
+struct IndexedImage {
+    int width;
+    int height;
+
+    /**
+     * RGB colors, 0xRRGGBB; at most 256
+     */
+    std::vector<uint32_t> palette;
+    std::vector<uint8_t> pixels;
+};
+
+/**
+ * Renders a Graphics-style framebuffer, one word per row with the leftmost pixel in the MSB,
+ * into a two color image scaled up by scale. Index 0 is unset, 1 is set.
+ */
+IndexedImage renderRows(const uint64_t *rows, int width, int height, int scale);
+
+/**
+ * The same for a framebuffer of two words per row, the left half first, such as the SUPER-CHIP screen
+ */
+IndexedImage renderRows(const uint64_t (*rows)[2], int width, int height, int scale);
+
+uint32_t crc32(const uint8_t *data, size_t size, uint32_t crc = 0);
+uint32_t adler32(const uint8_t *data, size_t size);
+
+/**
+ * Writes image as a PNG file. The image data is stored in uncompressed deflate blocks,
+ * which every decoder reads and which is fast to produce.
+ */
+bool writePng(FILE *file, const IndexedImage &image);
+
+/**
+ * Writes an animated, endlessly looping GIF frame by frame. All frames share the size and
+ * palette given to open().
+ */
+class GifWriter {
+public:
+    GifWriter();
+
+    GifWriter(const GifWriter &) = delete;
+    GifWriter &operator=(const GifWriter &) = delete;
+
+    bool open(FILE *file, int width, int height, const std::vector<uint32_t> &palette);
+
+    /**
+     * Appends a frame shown for delay hundredths of a second
+     */
+    bool addFrame(const IndexedImage &image, uint16_t delay);
+
+    /**
+     * Writes the trailer. The file stays owned by the caller.
+     */
+    bool close();
+
+private:
+    FILE *file;
+    int width;
+    int height;
+    unsigned color_bits;
+};
@@ -7,7 +7,7 @@ class Input {
 public:
     Input() = default;
 
-    bool keys[16];
+    bool keys[16] = {};
 
     void onKeyDown(uint8_t key);
 
@@ -20,8 +20,8 @@ public:
     void clearTriggered();
 
 private:
-    bool isTriggered;
-    uint8_t triggerKey;
+    bool isTriggered = false;
+    uint8_t triggerKey = 0;
 };
 
 #endif //INPUT_H
@@ -0,0 +1,167 @@
+#include <cstdio>
+#include <cstring>
+#include "InputLog.h"
+
+static const char INPUT_LOG_MAGIC[4] = {'C', '8', 'I', 'L'};
+static const uint16_t INPUT_LOG_VERSION = 2;
+static const size_t HEADER_SIZE = 48;
+static const size_t EVENT_SIZE = 10;
+
+static void put(uint8_t *out, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; ++i) {
+        out[i] = (uint8_t) (value >> (8u * i));
+    }
+}
+
+static uint64_t get(const uint8_t *in, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+        value |= (uint64_t) in[i] << (8u * i);
+    }
+    return value;
+}
+
+InputLog::InputLog() : rng_seed(0), cycles_per_frame(Cpu::DEFAULT_CYCLES_PER_FRAME), profile(QuirkProfile::Modern),
+                       rom_hash(0), end_cycle(0), final_hash(0) {
+}
+
+void InputLog::start(Machine &machine, uint64_t rom_hash, uint32_t seed) {
+    machine.cpu.seed(seed);
+    this->rng_seed = seed;
+    this->cycles_per_frame = machine.cpu.cyclesPerFrame();
+    this->profile = machine.cpu.quirks();
+    this->rom_hash = rom_hash;
+    this->end_cycle = 0;
+    this->final_hash = 0;
+    this->input_events.clear();
+}
+
+void InputLog::record(const Machine &machine, uint8_t key, bool down) {
+    this->input_events.push_back(InputEvent{machine.cpu.cycles, key, down});
+}
+
+void InputLog::finish(const Machine &machine) {
+    this->end_cycle = machine.cpu.cycles;
+    this->final_hash = machine.stateHash();
+}
+
+bool InputLog::save(const char *path) const {
+    std::vector<uint8_t> data(HEADER_SIZE + EVENT_SIZE * this->input_events.size());
+    uint8_t *out = data.data();
+    std::memcpy(out, INPUT_LOG_MAGIC, 4);
+    put(out + 4, INPUT_LOG_VERSION, 2);
+    put(out + 6, (uint8_t) this->profile, 1);
+    put(out + 7, 0, 1);
+    put(out + 8, this->rng_seed, 4);
+    put(out + 12, this->cycles_per_frame, 4);
+    put(out + 16, this->rom_hash, 8);
+    put(out + 24, this->end_cycle, 8);
+    put(out + 32, this->final_hash, 8);
+    put(out + 40, this->input_events.size(), 8);
+
+    out += HEADER_SIZE;
+    for (auto &event : this->input_events) {
+        put(out, event.cycle, 8);
+        out[8] = event.key;
+        out[9] = event.down ? 1 : 0;
+        out += EVENT_SIZE;
+    }
+
+    FILE *file = fopen(path, "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    bool written = fwrite(data.data(), 1, data.size(), file) == data.size();
+    return fclose(file) == 0 && written;
+}
+
+bool InputLog::load(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (file == nullptr) {
+        return false;
+    }
+
+    uint8_t header[HEADER_SIZE];
+    if (fread(header, 1, HEADER_SIZE, file) != HEADER_SIZE || memcmp(header, INPUT_LOG_MAGIC, 4) != 0
+        || get(header + 4, 2) != INPUT_LOG_VERSION || header[6] >= (uint8_t) QuirkProfile::Count
+        || get(header + 12, 4) == 0) {
+        fclose(file);
+        return false;
+    }
+
+    std::vector<InputEvent> events;
+    uint64_t count = get(header + 40, 8);
+    uint8_t record[EVENT_SIZE];
+    for (uint64_t i = 0; i < count; ++i) {
+        if (fread(record, 1, EVENT_SIZE, file) != EVENT_SIZE || record[8] >= 16 || record[9] > 1
+            || (!events.empty() && get(record, 8) < events.back().cycle)) {
+            fclose(file);
+            return false;
+        }
+        events.push_back(InputEvent{get(record, 8), record[8], record[9] == 1});
+    }
+    fclose(file);
+
+    this->rng_seed = (uint32_t) get(header + 8, 4);
+    this->cycles_per_frame = (uint32_t) get(header + 12, 4);
+    this->profile = (QuirkProfile) header[6];
+    this->rom_hash = get(header + 16, 8);
+    this->end_cycle = get(header + 24, 8);
+    this->final_hash = get(header + 32, 8);
+    this->input_events.swap(events);
+    return true;
+}
+
+uint32_t InputLog::seed() const {
+    return this->rng_seed;
+}
+
+uint32_t InputLog::cyclesPerFrame() const {
+    return this->cycles_per_frame;
+}
+
+QuirkProfile InputLog::quirks() const {
+    return this->profile;
+}
+
+uint64_t InputLog::romHash() const {
+    return this->rom_hash;
+}
+
+uint64_t InputLog::endCycle() const {
+    return this->end_cycle;
+}
+
+uint64_t InputLog::finalHash() const {
+    return this->final_hash;
+}
+
+const std::vector<InputEvent> &InputLog::events() const {
+    return this->input_events;
+}
+
+State replay(const InputLog &log, Machine &machine) {
+    Cpu &cpu = machine.cpu;
+    cpu.seed(log.seed());
+    cpu.setCyclesPerFrame(log.cyclesPerFrame());
+    cpu.setQuirks(log.quirks());
+
+    State state = State::Running;
+    for (auto &event : log.events()) {
+        if (event.cycle > cpu.cycles) {
+            state = cpu.run(event.cycle - cpu.cycles);
+            if (isFault(state)) {
+                return state;
+            }
+        }
+        if (event.down) {
+            machine.input.onKeyDown(event.key);
+        } else {
+            machine.input.onKeyUp(event.key);
+        }
+    }
+    if (log.endCycle() > cpu.cycles) {
+        state = cpu.run(log.endCycle() - cpu.cycles);
+    }
+    return state;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Machine.h"
+
+/*
+ * Input logs start with a 48 byte header:
+ *   "C8IL" magic, uint16 version, uint8 quirk profile, uint8 reserved, uint32 seed, uint32 cycles per frame,
+ *   uint64 rom hash, uint64 end cycle, uint64 final state hash, uint64 event count
+ * followed by one 10 byte record per event: uint64 cycle, uint8 key, uint8 1 if pressed, 0 if released.
+ * All fields are little-endian.
+ */
+
+/**
+ * A key press or release, applied before the instruction at the given cycle
+ */
+struct InputEvent {
+    uint64_t cycle;
+    uint8_t key;
+    bool down;
+};
+
+/**
+ * Everything needed to reproduce a session besides the ROM: the seed of the random number
+ * generator, the clock speed, the quirk profile and every key event with the cycle it arrived on.
+ * Since the emulator is otherwise deterministic, replaying a log reproduces the session exactly.
+ */
+class InputLog {
+public:
+    InputLog();
+
+    /**
+     * Starts a new log for a session of machine, which must have its ROM loaded and not have run yet.
+     * Reseeds the machine's cpu with seed, so the session is reproducible.
+     */
+    void start(Machine &machine, uint64_t rom_hash, uint32_t seed);
+
+    /**
+     * Appends a key event at the machine's current cycle. Call it right before forwarding the event to Input.
+     */
+    void record(const Machine &machine, uint8_t key, bool down);
+
+    /**
+     * Notes the cycle and state the session ended with, to be checked by replay()
+     */
+    void finish(const Machine &machine);
+
+    bool save(const char *path) const;
+
+    /**
+     * Returns false, leaving the log untouched, if the file could not be read or is not an input log
+     */
+    bool load(const char *path);
+
+    uint32_t seed() const;
+    uint32_t cyclesPerFrame() const;
+    QuirkProfile quirks() const;
+    uint64_t romHash() const;
+    uint64_t endCycle() const;
+    uint64_t finalHash() const;
+    const std::vector<InputEvent> &events() const;
+
+private:
+    uint32_t rng_seed;
+    uint32_t cycles_per_frame;
+    QuirkProfile profile;
+    uint64_t rom_hash;
+    uint64_t end_cycle;
+    uint64_t final_hash;
+    std::vector<InputEvent> input_events;
+};
+
+/**
+ * Replays log on machine, which must have the log's ROM loaded and not have run yet, as fast as possible.
+ * Stops at the log's end cycle or at the first fault. Compare Machine::stateHash() with
+ * InputLog::finalHash() afterwards to check the replay matched the recording.
+ */
+State replay(const InputLog &log, Machine &machine);
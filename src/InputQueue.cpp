@@ -0,0 +1,23 @@
+#include <algorithm>
+#include "InputQueue.h"
+
+constexpr size_t InputQueue::CAPACITY;
+
+InputQueue::InputQueue() : events(), head(0), tail(0), dropped_events(0) {}
+
+size_t InputQueue::drain(KeyEvent *out, size_t max) {
+    size_t tail = this->tail.load(std::memory_order_relaxed);
+    size_t available = this->head.load(std::memory_order_acquire) - tail;
+    size_t count = std::min(available, max);
+
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = this->events[(tail + i) & (CAPACITY - 1)];
+    }
+
+    this->tail.store(tail + count, std::memory_order_release);
+    return count;
+}
+
+uint64_t InputQueue::dropped() const {
+    return this->dropped_events.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * A key press or release on the host, stamped with the host time it happened at
+ */
+struct KeyEvent {
+    std::chrono::steady_clock::time_point time;
+    uint8_t key;
+    bool down;
+};
+
+/**
+ * Lock-free single-producer single-consumer ring of key events.
+ *
+ * The window thread pushes events as it polls them and never blocks; the emulation thread drains
+ * every queued event once per frame and applies each at the cycle matching its time, see
+ * Scheduler::setInputQueue().
+ */
+class InputQueue {
+public:
+    static constexpr size_t CAPACITY = 256;
+
+    InputQueue();
+
+    InputQueue(const InputQueue &) = delete;
+    InputQueue &operator=(const InputQueue &) = delete;
+
+    /**
+     * Appends an event; called by the producer only. Returns false, dropping the event, if the ring is full.
+     */
+    bool push(const KeyEvent &event) {
+        size_t head = this->head.load(std::memory_order_relaxed);
+        if (head - this->tail.load(std::memory_order_acquire) == CAPACITY) {
+            this->dropped_events.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        this->events[head & (CAPACITY - 1)] = event;
+        this->head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Moves up to max events into out, oldest first; called by the consumer only.
+     * Returns the number of events moved.
+     */
+    size_t drain(KeyEvent *out, size_t max);
+
+    /**
+     * The number of events dropped because the ring was full
+     */
+    uint64_t dropped() const;
+
+private:
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "the capacity must be a power of two");
+
+    KeyEvent events[CAPACITY];
+    std::atomic<size_t> head;
+    std::atomic<size_t> tail;
+    std::atomic<uint64_t> dropped_events;
+};
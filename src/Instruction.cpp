@@ -0,0 +1,269 @@
+#include <cstdio>
+#include "Instruction.h"
+
+static inline uint8_t getN(uint16_t opcode) {
+    return opcode & 0x000Fu;
+}
+
+static inline uint8_t getNN(uint16_t opcode) {
+    return opcode & 0x00FFu;
+}
+
+static inline uint16_t getNNN(uint16_t opcode) {
+    return opcode & 0x0FFFu;
+}
+
+static inline uint8_t getX(uint16_t opcode) {
+    return (opcode & 0x0F00u) >> 8u;
+}
+
+static inline uint8_t getY(uint16_t opcode) {
+    return (opcode & 0x00F0u) >> 4u;
+}
+
+static Op decodeOp(uint16_t opcode) {
+    switch ((opcode & 0xF000u) >> 12u) {
+        case 0x0:
+            if (opcode == 0x00E0) return Op::CLS;
+            if (opcode == 0x00EE) return Op::RET;
+            if ((opcode & 0xFFF0u) == 0x00C0) return Op::SCD;
+            if (opcode == 0x00FB) return Op::SCR;
+            if (opcode == 0x00FC) return Op::SCL;
+            if (opcode == 0x00FE) return Op::LOW;
+            if (opcode == 0x00FF) return Op::HIGH;
+            return Op::SYS;
+        case 0x1:
+            return Op::JP;
+        case 0x2:
+            return Op::CALL;
+        case 0x3:
+            return Op::SE_VX_NN;
+        case 0x4:
+            return Op::SNE_VX_NN;
+        case 0x5:
+            return getN(opcode) == 0 ? Op::SE_VX_VY : Op::Unknown;
+        case 0x6:
+            return Op::LD_VX_NN;
+        case 0x7:
+            return Op::ADD_VX_NN;
+        case 0x8:
+            switch (getN(opcode)) {
+                case 0x0:
+                    return Op::LD_VX_VY;
+                case 0x1:
+                    return Op::OR;
+                case 0x2:
+                    return Op::AND;
+                case 0x3:
+                    return Op::XOR;
+                case 0x4:
+                    return Op::ADD_VX_VY;
+                case 0x5:
+                    return Op::SUB;
+                case 0x6:
+                    return Op::SHR;
+                case 0x7:
+                    return Op::SUBN;
+                case 0xE:
+                    return Op::SHL;
+                default:
+                    return Op::Unknown;
+            }
+        case 0x9:
+            return getN(opcode) == 0 ? Op::SNE_VX_VY : Op::Unknown;
+        case 0xA:
+            return Op::LD_I;
+        case 0xB:
+            return Op::JP_V0;
+        case 0xC:
+            return Op::RND;
+        case 0xD:
+            return Op::DRW;
+        case 0xE:
+            switch (getNN(opcode)) {
+                case 0x9E:
+                    return Op::SKP;
+                case 0xA1:
+                    return Op::SKNP;
+                default:
+                    return Op::Unknown;
+            }
+        default:
+            switch (getNN(opcode)) {
+                case 0x07:
+                    return Op::LD_VX_DT;
+                case 0x0A:
+                    return Op::LD_VX_K;
+                case 0x15:
+                    return Op::LD_DT_VX;
+                case 0x18:
+                    return Op::LD_ST_VX;
+                case 0x1E:
+                    return Op::ADD_I_VX;
+                case 0x29:
+                    return Op::LD_F_VX;
+                case 0x33:
+                    return Op::LD_B_VX;
+                case 0x55:
+                    return Op::LD_I_VX;
+                case 0x65:
+                    return Op::LD_VX_I;
+                default:
+                    return Op::Unknown;
+            }
+    }
+}
+
+Instruction decode(uint16_t opcode) {
+    Instruction inst{};
+    inst.op = decodeOp(opcode);
+    inst.x = getX(opcode);
+    inst.y = getY(opcode);
+    inst.n = getN(opcode);
+    inst.nn = getNN(opcode);
+    inst.nnn = getNNN(opcode);
+    return inst;
+}
+
+const char *opcodePattern(Op op) {
+    static const char *const patterns[(size_t) Op::Count] = {
+            "????", "0NNN", "00E0", "00EE", "1NNN", "2NNN", "3XNN", "4XNN", "5XY0", "6XNN", "7XNN", "8XY0",
+            "8XY1", "8XY2", "8XY3", "8XY4", "8XY5", "8XY6", "8XY7", "8XYE", "9XY0", "ANNN", "BNNN", "CXNN",
+            "DXYN", "EX9E", "EXA1", "FX07", "FX0A", "FX15", "FX18", "FX1E", "FX29", "FX33", "FX55", "FX65",
+            "00CN", "00FB", "00FC", "00FE", "00FF",
+    };
+    return op < Op::Count ? patterns[(size_t) op] : "????";
+}
+
+void disassemble(uint16_t opcode, char *out, size_t size) {
+    Instruction inst = decode(opcode);
+    unsigned x = inst.x, y = inst.y, n = inst.n, nn = inst.nn, nnn = inst.nnn;
+    switch (inst.op) {
+        case Op::Unknown:
+            snprintf(out, size, "DW 0x%04X", opcode);
+            return;
+        case Op::SYS:
+            snprintf(out, size, "SYS 0x%03X", nnn);
+            return;
+        case Op::CLS:
+            snprintf(out, size, "CLS");
+            return;
+        case Op::RET:
+            snprintf(out, size, "RET");
+            return;
+        case Op::JP:
+            snprintf(out, size, "JP 0x%03X", nnn);
+            return;
+        case Op::CALL:
+            snprintf(out, size, "CALL 0x%03X", nnn);
+            return;
+        case Op::SE_VX_NN:
+            snprintf(out, size, "SE V%X, 0x%02X", x, nn);
+            return;
+        case Op::SNE_VX_NN:
+            snprintf(out, size, "SNE V%X, 0x%02X", x, nn);
+            return;
+        case Op::SE_VX_VY:
+            snprintf(out, size, "SE V%X, V%X", x, y);
+            return;
+        case Op::LD_VX_NN:
+            snprintf(out, size, "LD V%X, 0x%02X", x, nn);
+            return;
+        case Op::ADD_VX_NN:
+            snprintf(out, size, "ADD V%X, 0x%02X", x, nn);
+            return;
+        case Op::LD_VX_VY:
+            snprintf(out, size, "LD V%X, V%X", x, y);
+            return;
+        case Op::OR:
+            snprintf(out, size, "OR V%X, V%X", x, y);
+            return;
+        case Op::AND:
+            snprintf(out, size, "AND V%X, V%X", x, y);
+            return;
+        case Op::XOR:
+            snprintf(out, size, "XOR V%X, V%X", x, y);
+            return;
+        case Op::ADD_VX_VY:
+            snprintf(out, size, "ADD V%X, V%X", x, y);
+            return;
+        case Op::SUB:
+            snprintf(out, size, "SUB V%X, V%X", x, y);
+            return;
+        case Op::SHR:
+            snprintf(out, size, "SHR V%X, V%X", x, y);
+            return;
+        case Op::SUBN:
+            snprintf(out, size, "SUBN V%X, V%X", x, y);
+            return;
+        case Op::SHL:
+            snprintf(out, size, "SHL V%X, V%X", x, y);
+            return;
+        case Op::SNE_VX_VY:
+            snprintf(out, size, "SNE V%X, V%X", x, y);
+            return;
+        case Op::LD_I:
+            snprintf(out, size, "LD I, 0x%03X", nnn);
+            return;
+        case Op::JP_V0:
+            snprintf(out, size, "JP V0, 0x%03X", nnn);
+            return;
+        case Op::RND:
+            snprintf(out, size, "RND V%X, 0x%02X", x, nn);
+            return;
+        case Op::DRW:
+            snprintf(out, size, "DRW V%X, V%X, %u", x, y, n);
+            return;
+        case Op::SKP:
+            snprintf(out, size, "SKP V%X", x);
+            return;
+        case Op::SKNP:
+            snprintf(out, size, "SKNP V%X", x);
+            return;
+        case Op::LD_VX_DT:
+            snprintf(out, size, "LD V%X, DT", x);
+            return;
+        case Op::LD_VX_K:
+            snprintf(out, size, "LD V%X, K", x);
+            return;
+        case Op::LD_DT_VX:
+            snprintf(out, size, "LD DT, V%X", x);
+            return;
+        case Op::LD_ST_VX:
+            snprintf(out, size, "LD ST, V%X", x);
+            return;
+        case Op::ADD_I_VX:
+            snprintf(out, size, "ADD I, V%X", x);
+            return;
+        case Op::LD_F_VX:
+            snprintf(out, size, "LD F, V%X", x);
+            return;
+        case Op::LD_B_VX:
+            snprintf(out, size, "LD B, V%X", x);
+            return;
+        case Op::LD_I_VX:
+            snprintf(out, size, "LD [I], V%X", x);
+            return;
+        case Op::LD_VX_I:
+            snprintf(out, size, "LD V%X, [I]", x);
+            return;
+        case Op::SCD:
+            snprintf(out, size, "SCD %u", n);
+            return;
+        case Op::SCR:
+            snprintf(out, size, "SCR");
+            return;
+        case Op::SCL:
+            snprintf(out, size, "SCL");
+            return;
+        case Op::LOW:
+            snprintf(out, size, "LOW");
+            return;
+        case Op::HIGH:
+            snprintf(out, size, "HIGH");
+            return;
+        case Op::Count:
+            break;
+    }
+    snprintf(out, size, "DW 0x%04X", opcode);
+}
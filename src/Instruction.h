@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Every CHIP-8 instruction, fully resolved from the raw opcode.
+ * The comment next to each entry is the opcode pattern it is decoded from.
+ */
+enum class Op : uint8_t {
+    Unknown,
+    SYS,        // 0NNN
+    CLS,        // 00E0
+    RET,        // 00EE
+    JP,         // 1NNN
+    CALL,       // 2NNN
+    SE_VX_NN,   // 3XNN
+    SNE_VX_NN,  // 4XNN
+    SE_VX_VY,   // 5XY0
+    LD_VX_NN,   // 6XNN
+    ADD_VX_NN,  // 7XNN
+    LD_VX_VY,   // 8XY0
+    OR,         // 8XY1
+    AND,        // 8XY2
+    XOR,        // 8XY3
+    ADD_VX_VY,  // 8XY4
+    SUB,        // 8XY5
+    SHR,        // 8XY6
+    SUBN,       // 8XY7
+    SHL,        // 8XYE
+    SNE_VX_VY,  // 9XY0
+    LD_I,       // ANNN
+    JP_V0,      // BNNN
+    RND,        // CXNN
+    DRW,        // DXYN
+    SKP,        // EX9E
+    SKNP,       // EXA1
+    LD_VX_DT,   // FX07
+    LD_VX_K,    // FX0A
+    LD_DT_VX,   // FX15
+    LD_ST_VX,   // FX18
+    ADD_I_VX,   // FX1E
+    LD_F_VX,    // FX29
+    LD_B_VX,    // FX33
+    LD_I_VX,    // FX55
+    LD_VX_I,    // FX65
+
+    // SUPER-CHIP
+    SCD,        // 00CN
+    SCR,        // 00FB
+    SCL,        // 00FC
+    LOW,        // 00FE
+    HIGH,       // 00FF
+    Count
+};
+
+/**
+ * A decoded instruction: the resolved operation plus every operand field extracted up front,
+ * so handlers never have to mask and shift the raw opcode themselves.
+ */
+struct Instruction {
+    Op op;
+    uint8_t x;
+    uint8_t y;
+    uint8_t n;
+    uint8_t nn;
+    uint16_t nnn;
+};
+
+/**
+ * Decodes a raw big-endian opcode into an Instruction
+ */
+Instruction decode(uint16_t opcode);
+
+/**
+ * The opcode pattern op is decoded from, such as "8XY4", or "????" for Op::Unknown
+ */
+const char *opcodePattern(Op op);
+
+/**
+ * Writes opcode in the usual CHIP-8 assembly syntax, such as "ADD V1, V2" or "LD I, 0x2A0", to out,
+ * truncating at size. Opcodes that decode to Op::Unknown are written as "DW 0x1234".
+ */
+void disassemble(uint16_t opcode, char *out, size_t size);
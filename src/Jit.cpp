@@ -0,0 +1,278 @@
+#include <algorithm>
+#include <cstring>
+#include "Jit.h"
+#include "Instruction.h"
+
+#if defined(__x86_64__) && !defined(_WIN32)
+#define CHIP8_JIT_SUPPORTED 1
+#include <sys/mman.h>
+#endif
+
+/*
+ * Register assignment inside a block (System V calling convention):
+ *   rdi - pointer to V0-VF
+ *   rsi - pointer to I
+ *   edx - I, loaded on entry and stored back on exit
+ *   eax, ecx - scratch; eax holds the next pc on exit
+ *
+ * Every V register access is a [rdi + X] operand, where X always fits in a disp8.
+ */
+
+static void bytes(std::vector<uint8_t> &out, std::initializer_list<uint8_t> b) {
+    out.insert(out.end(), b);
+}
+
+static void imm32(std::vector<uint8_t> &out, uint32_t val) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back((val >> (8u * i)) & 0xFFu);
+    }
+}
+
+// mov al, [rdi + reg]
+static void loadAl(std::vector<uint8_t> &out, uint8_t reg) {
+    bytes(out, {0x8A, 0x47, reg});
+}
+
+// mov [rdi + reg], al
+static void storeAl(std::vector<uint8_t> &out, uint8_t reg) {
+    bytes(out, {0x88, 0x47, reg});
+}
+
+// mov eax, pc
+static void setNextPc(std::vector<uint8_t> &out, uint16_t pc) {
+    out.push_back(0xB8);
+    imm32(out, pc);
+}
+
+// mov eax, not_taken; mov ecx, taken; cmov<cc> eax, ecx
+static void selectNextPc(std::vector<uint8_t> &out, uint16_t addr, uint8_t cmov) {
+    setNextPc(out, addr + 2);
+    out.push_back(0xB9);
+    imm32(out, addr + 4);
+    bytes(out, {0x0F, cmov, 0xC1});
+}
+
+constexpr uint16_t Jit::MAX_BLOCK_LENGTH;
+
+static const uint8_t CMOVE = 0x44;
+static const uint8_t CMOVNE = 0x45;
+
+static uint64_t pageBits(uint16_t first, uint16_t last) {
+    uint64_t bits = 0;
+    for (unsigned page = first / Memory::PAGE_SIZE; page <= std::min<unsigned>(last, 4095) / Memory::PAGE_SIZE; ++page) {
+        bits |= 1ull << page;
+    }
+    return bits;
+}
+
+Jit::Jit(QuirkProfile quirks, size_t code_size) :
+        code_pages(0), code(nullptr), code_size(0), code_used(0), shift_vy(quirkFlags(quirks).shift_vy) {
+#ifdef CHIP8_JIT_SUPPORTED
+    void *mem = mmap(nullptr, code_size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem != MAP_FAILED) {
+        this->code = static_cast<uint8_t *>(mem);
+        this->code_size = code_size;
+    }
+#endif
+}
+
+Jit::~Jit() {
+#ifdef CHIP8_JIT_SUPPORTED
+    if (this->code != nullptr) {
+        munmap(this->code, this->code_size);
+    }
+#endif
+}
+
+const Jit::Block *Jit::lookup(uint16_t addr, const Memory &memory) {
+    if (addr >= 4096) {
+        return nullptr;
+    }
+
+    Block &block = this->blocks[addr];
+    if (!block.translated) {
+        block.translated = true;
+        if (this->code == nullptr || !this->translate(addr, memory, block)) {
+            block.fn = nullptr;
+            this->code_pages |= pageBits(addr, addr + 1);
+        } else {
+            this->code_pages |= pageBits(addr, block.end - 1);
+        }
+    }
+
+    return block.fn != nullptr ? &block : nullptr;
+}
+
+void Jit::invalidate(uint16_t addr) {
+    if (!(this->code_pages & (1ull << (addr / Memory::PAGE_SIZE)))) {
+        return;
+    }
+
+    int first = (int) addr - MAX_BLOCK_LENGTH * 2;
+    for (int start = first < 0 ? 0 : first; start <= addr && start < 4096; ++start) {
+        Block &block = this->blocks[start];
+        if (block.translated && (block.fn == nullptr || block.end > addr)) {
+            block = Block{};
+        }
+    }
+}
+
+void Jit::flush() {
+    for (auto &block : this->blocks) {
+        block = Block{};
+    }
+    this->code_pages = 0;
+    this->code_used = 0;
+}
+
+bool Jit::translate(uint16_t addr, const Memory &memory, Block &block) {
+    std::vector<uint8_t> out;
+
+    // movzx edx, word [rsi]
+    bytes(out, {0x0F, 0xB7, 0x16});
+
+    uint16_t pc = addr;
+    uint16_t length = 0;
+    bool terminates = false;
+    while (length < MAX_BLOCK_LENGTH && pc < 4095 && !terminates) {
+        uint16_t opcode = ((uint16_t) (memory.read(pc) << 8u)) | memory.read(pc + 1);
+        if (!emit(out, pc, opcode, terminates)) {
+            break;
+        }
+        pc += 2;
+        length++;
+    }
+
+    if (length == 0) {
+        return false;
+    }
+
+    if (!terminates) {
+        setNextPc(out, pc);
+    }
+
+    // mov [rsi], dx; ret
+    bytes(out, {0x66, 0x89, 0x16, 0xC3});
+
+    if (this->code_used + out.size() > this->code_size) {
+        // out of space: drop everything and start over, keeping only this block
+        this->flush();
+        block.translated = true;
+    }
+
+    uint8_t *dest = this->code + this->code_used;
+    std::memcpy(dest, out.data(), out.size());
+    this->code_used += out.size();
+
+    block.fn = reinterpret_cast<BlockFn>(dest);
+    block.end = pc;
+    block.length = length;
+    return true;
+}
+
+bool Jit::emit(std::vector<uint8_t> &out, uint16_t addr, uint16_t opcode, bool &terminates) const {
+    Instruction inst = decode(opcode);
+    uint8_t x = inst.x;
+    uint8_t y = inst.y;
+
+    // flag updates mirror the interpreter exactly, including the order VF is written in,
+    // so instructions using VF as an operand produce identical results
+    switch (inst.op) {
+        case Op::JP:
+            setNextPc(out, inst.nnn);
+            terminates = true;
+            return true;
+        case Op::SE_VX_NN:
+        case Op::SNE_VX_NN:
+            // cmp byte [rdi + x], nn
+            bytes(out, {0x80, 0x7F, x, inst.nn});
+            selectNextPc(out, addr, inst.op == Op::SE_VX_NN ? CMOVE : CMOVNE);
+            terminates = true;
+            return true;
+        case Op::SE_VX_VY:
+        case Op::SNE_VX_VY:
+            // mov cl, [rdi + x]; cmp cl, [rdi + y]
+            bytes(out, {0x8A, 0x4F, x, 0x3A, 0x4F, y});
+            selectNextPc(out, addr, inst.op == Op::SE_VX_VY ? CMOVE : CMOVNE);
+            terminates = true;
+            return true;
+        case Op::LD_VX_NN:
+            // mov byte [rdi + x], nn
+            bytes(out, {0xC6, 0x47, x, inst.nn});
+            return true;
+        case Op::ADD_VX_NN:
+            // add byte [rdi + x], nn
+            bytes(out, {0x80, 0x47, x, inst.nn});
+            return true;
+        case Op::LD_VX_VY:
+            loadAl(out, y);
+            storeAl(out, x);
+            return true;
+        case Op::OR:
+        case Op::AND:
+        case Op::XOR:
+            loadAl(out, x);
+            // or/and/xor al, [rdi + y]
+            bytes(out, {(uint8_t) (inst.op == Op::OR ? 0x0A : inst.op == Op::AND ? 0x22 : 0x32), 0x47, y});
+            storeAl(out, x);
+            return true;
+        case Op::ADD_VX_VY:
+            // VF = carry of VX + VY, then VX += VY
+            loadAl(out, x);
+            bytes(out, {0x02, 0x47, y, 0x0F, 0x92, 0xC0});
+            storeAl(out, 0xF);
+            loadAl(out, x);
+            bytes(out, {0x02, 0x47, y});
+            storeAl(out, x);
+            return true;
+        case Op::SUB:
+            // VF = VX >= VY, then VX -= VY
+            loadAl(out, x);
+            bytes(out, {0x3A, 0x47, y, 0x0F, 0x93, 0xC0});
+            storeAl(out, 0xF);
+            loadAl(out, x);
+            bytes(out, {0x2A, 0x47, y});
+            storeAl(out, x);
+            return true;
+        case Op::SUBN:
+            // VF = VY >= VX, then VX = VY - VX
+            loadAl(out, y);
+            bytes(out, {0x3A, 0x47, x, 0x0F, 0x93, 0xC0});
+            storeAl(out, 0xF);
+            loadAl(out, y);
+            bytes(out, {0x2A, 0x47, x});
+            storeAl(out, x);
+            return true;
+        case Op::SHR:
+            // VX = VY >> 1 or VX >> 1, then VF = the bit shifted out:
+            // mov cl, al; shr al, 1; mov [rdi + x], al; and cl, 1; mov [rdi + 0xF], cl
+            loadAl(out, this->shift_vy ? y : x);
+            bytes(out, {0x88, 0xC1, 0xD0, 0xE8});
+            storeAl(out, x);
+            bytes(out, {0x80, 0xE1, 0x01, 0x88, 0x4F, 0x0F});
+            return true;
+        case Op::SHL:
+            // VX = VY << 1 or VX << 1, then VF = the bit shifted out:
+            // mov cl, al; shl al, 1; mov [rdi + x], al; shr cl, 7; mov [rdi + 0xF], cl
+            loadAl(out, this->shift_vy ? y : x);
+            bytes(out, {0x88, 0xC1, 0xD0, 0xE0});
+            storeAl(out, x);
+            bytes(out, {0xC0, 0xE9, 0x07, 0x88, 0x4F, 0x0F});
+            return true;
+        case Op::LD_I:
+            // mov edx, nnn
+            out.push_back(0xBA);
+            imm32(out, inst.nnn);
+            return true;
+        case Op::ADD_I_VX:
+            // movzx eax, byte [rdi + x]; add edx, eax
+            bytes(out, {0x0F, 0xB6, 0x47, x, 0x01, 0xC2});
+            return true;
+        case Op::LD_F_VX:
+            // movzx eax, byte [rdi + x]; and eax, 0xF; lea edx, [rax + rax * 4]
+            bytes(out, {0x0F, 0xB6, 0x47, x, 0x83, 0xE0, 0x0F, 0x8D, 0x14, 0x80});
+            return true;
+        default:
+            return false;
+    }
+}
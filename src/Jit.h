@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Memory.h"
+#include "Quirks.h"
+
+/**
+ * Dynamic recompiler translating CHIP-8 basic blocks into x86-64 machine code.
+ *
+ * A block is a run of straight-line ALU, register and I instructions, ended by a jump, a skip,
+ * or the first instruction the translator does not handle (calls, returns, BNNN, drawing,
+ * timers, input, memory transfers). While a block runs, the register file is addressed through a
+ * host register and I is held in a host register; the block returns the address execution
+ * continues at, where the interpreter takes over if no block can be compiled.
+ *
+ * Only available on x86-64 System V hosts; elsewhere lookup() always returns nullptr.
+ */
+class Jit {
+public:
+    /**
+     * Compiled block entry point. Receives V0-VF and I, returns the next pc.
+     */
+    using BlockFn = uint16_t (*)(uint8_t *data_registers, uint16_t *instruction_register);
+
+    struct Block {
+        BlockFn fn;
+
+        /**
+         * One past the last byte of CHIP-8 code covered by this block
+         */
+        uint16_t end;
+
+        /**
+         * The number of CHIP-8 instructions executed by one call of fn
+         */
+        uint16_t length;
+
+        /**
+         * True once translation has been attempted, even if it produced no code
+         */
+        bool translated;
+    };
+
+    /**
+     * The maximum number of CHIP-8 instructions translated into a single block
+     */
+    static constexpr uint16_t MAX_BLOCK_LENGTH = 32;
+
+    /**
+     * Creates a compiler emitting code that behaves like the interpreter under quirks
+     */
+    explicit Jit(QuirkProfile quirks = QuirkProfile::Modern, size_t code_size = 256 * 1024);
+    ~Jit();
+
+    Jit(const Jit &) = delete;
+    Jit &operator=(const Jit &) = delete;
+
+    /**
+     * Returns the block starting at addr, translating it on first use.
+     * Returns nullptr if the instruction at addr cannot be compiled.
+     */
+    const Block *lookup(uint16_t addr, const Memory &memory);
+
+    /**
+     * Discards every block covering addr
+     */
+    void invalidate(uint16_t addr);
+
+    /**
+     * Discards every block and all generated code
+     */
+    void flush();
+
+private:
+    Block blocks[4096]{};
+
+    /**
+     * Bit p is set if any block, translated or not, may depend on memory page p.
+     * Writes to other pages, i.e. data, skip the search for affected blocks.
+     */
+    uint64_t code_pages;
+
+    uint8_t *code;
+    size_t code_size;
+    size_t code_used;
+
+    /**
+     * Whether 8XY6 and 8XYE shift VY, the only quirk of the instructions compiled
+     */
+    bool shift_vy;
+
+    bool translate(uint16_t addr, const Memory &memory, Block &block);
+    bool emit(std::vector<uint8_t> &out, uint16_t addr, uint16_t opcode, bool &terminates) const;
+};
@@ -0,0 +1,83 @@
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include "Machine.h"
+#include "Rom.h"
+#include "SaveState.h"
+
+constexpr uint16_t Machine::PROGRAM_START;
+constexpr size_t Machine::MAX_PROGRAM_SIZE;
+
+Machine::Machine() : memory(), graphics(memory), input(), cpu(memory, graphics, input, PROGRAM_START) {
+}
+
+bool Machine::loadRom(const uint8_t *data, size_t size) {
+    if (size > MAX_PROGRAM_SIZE) {
+        return false;
+    }
+
+    this->memory.load(PROGRAM_START, data, size);
+    return true;
+}
+
+void Machine::snapshot(MachineState &out) const {
+    out.cpu = this->cpu.snapshot();
+    out.quirks = this->cpu.quirks();
+    std::copy(this->memory.memory, this->memory.memory + sizeof(out.memory), out.memory);
+    std::copy(this->graphics.rows, this->graphics.rows + Graphics::HEIGHT, out.rows);
+    out.hires = this->graphics.isHires() ? 1 : 0;
+    std::copy(this->graphics.hires_rows[0], this->graphics.hires_rows[0] + 2 * Graphics::HIRES_HEIGHT, out.hires_rows[0]);
+}
+
+bool Machine::restore(const MachineState &state) {
+    if (state.quirks >= QuirkProfile::Count || !this->cpu.restore(state.cpu)) {
+        return false;
+    }
+    if (state.quirks != this->cpu.quirks()) {
+        this->cpu.setQuirks(state.quirks);
+    }
+    this->memory.restore(state.memory);
+    std::copy(state.rows, state.rows + Graphics::HEIGHT, this->graphics.rows);
+    std::copy(state.hires_rows[0], state.hires_rows[0] + 2 * Graphics::HIRES_HEIGHT, this->graphics.hires_rows[0]);
+    this->graphics.setHires(state.hires != 0);
+    return true;
+}
+
+uint64_t Machine::stateHash() const {
+    // the uncompressed save-state encoding is portable and free of padding bytes
+    std::unique_ptr<MachineState> state(new MachineState());
+    this->snapshot(*state);
+    std::vector<uint8_t> data = encodeState(*state, false);
+    return romHash(data.data(), data.size());
+}
+
+bool Machine::save(const char *path, bool compress) const {
+    std::unique_ptr<MachineState> state(new MachineState());
+    this->snapshot(*state);
+    std::vector<uint8_t> data = encodeState(*state, compress);
+
+    FILE *file = fopen(path, "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    bool written = fwrite(data.data(), 1, data.size(), file) == data.size();
+    return fclose(file) == 0 && written;
+}
+
+bool Machine::load(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (file == nullptr) {
+        return false;
+    }
+
+    std::vector<uint8_t> data;
+    uint8_t chunk[4096];
+    size_t count;
+    while ((count = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        data.insert(data.end(), chunk, chunk + count);
+    }
+    fclose(file);
+
+    std::unique_ptr<MachineState> state(new MachineState());
+    return decodeState(data.data(), data.size(), *state) && this->restore(*state);
+}
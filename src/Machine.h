@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "Memory.h"
+#include "Graphics.h"
+#include "Input.h"
+#include "Cpu.h"
+
+/**
+ * A complete snapshot of a Machine. Plain data, so snapshots can be taken and kept with memcpy.
+ */
+struct MachineState {
+    CpuState cpu;
+
+    /**
+     * The quirk profile the cpu runs under, so a state continues with the semantics it was taken with
+     */
+    QuirkProfile quirks;
+
+    uint8_t memory[4096];
+    uint64_t rows[Graphics::HEIGHT];
+    uint8_t hires;
+    uint64_t hires_rows[Graphics::HIRES_HEIGHT][2];
+};
+
+/**
+ * A complete emulator instance: memory, display, keypad and the cpu wired to them
+ */
+class Machine {
+public:
+    /**
+     * The address programs are loaded at and start executing from
+     */
+    static constexpr uint16_t PROGRAM_START = 0x200;
+
+    /**
+     * The largest program that fits between PROGRAM_START and the end of memory
+     */
+    static constexpr size_t MAX_PROGRAM_SIZE = 4096 - PROGRAM_START;
+
+    Machine();
+
+    Machine(const Machine &) = delete;
+    Machine &operator=(const Machine &) = delete;
+
+    /**
+     * Copies a program into memory at PROGRAM_START.
+     * Returns false, leaving memory untouched, if the program does not fit.
+     */
+    bool loadRom(const uint8_t *data, size_t size);
+
+    /**
+     * Copies the complete machine state into out
+     */
+    void snapshot(MachineState &out) const;
+
+    /**
+     * Replaces the complete machine state, switching the cpu to the state's quirk profile.
+     * Returns false, leaving the machine untouched, if the cpu state is inconsistent.
+     */
+    bool restore(const MachineState &state);
+
+    /**
+     * A 64-bit hash of the complete machine state; equal states hash equally on every host
+     */
+    uint64_t stateHash() const;
+
+    /**
+     * Writes a save-state file, see SaveState.h.
+     * Returns false if the file could not be written.
+     */
+    bool save(const char *path, bool compress = true) const;
+
+    /**
+     * Restores a save-state file written by save().
+     * Returns false, leaving the machine untouched, if the file could not be read or is invalid.
+     */
+    bool load(const char *path);
+
+    Memory memory;
+    Graphics graphics;
+    Input input;
+    Cpu cpu;
+};
@@ -1,11 +1,49 @@
+#include <algorithm>
 #include "Memory.h"
 
-Memory::Memory() {
+static_assert(Memory::PAGE_COUNT == 64, "dirty pages are tracked in a 64-bit mask");
+
+constexpr uint16_t Memory::PAGE_SIZE;
+constexpr uint16_t Memory::PAGE_COUNT;
+
+Memory::Memory() : dirty_pages(~0ull) {
     for (auto &i : this->memory) {
         i = 0;
     }
 };
 
 uint8_t &Memory::operator[](uint16_t addr) {
+    addr &= 0xFFFu;
+    this->dirty_pages |= 1ull << (addr / PAGE_SIZE);
+    for (auto listener : this->listeners) {
+        listener->onWrite(addr);
+    }
     return this->memory[addr];
 }
+
+void Memory::load(uint16_t addr, const uint8_t *data, size_t size) {
+    for (size_t i = 0; i < size && addr + i < sizeof(this->memory); ++i) {
+        (*this)[addr + i] = data[i];
+    }
+}
+
+void Memory::restore(const uint8_t (&data)[4096]) {
+    std::copy(data, data + sizeof(this->memory), this->memory);
+    this->dirty_pages = ~0ull;
+    for (auto listener : this->listeners) {
+        listener->onRestore();
+    }
+}
+
+void Memory::clearDirtyPages() {
+    this->dirty_pages = 0;
+}
+
+void Memory::addListener(MemoryListener *listener) {
+    this->listeners.push_back(listener);
+}
+
+void Memory::removeListener(MemoryListener *listener) {
+    this->listeners.erase(std::remove(this->listeners.begin(), this->listeners.end(), listener),
+                          this->listeners.end());
+}
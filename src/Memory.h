@@ -1,11 +1,71 @@
 #pragma once
 
 #include <cinttypes>
+#include <cstddef>
+#include <vector>
+
+/**
+ * Receives a notification whenever a byte of Memory may have been modified
+ */
+class MemoryListener {
+public:
+    virtual ~MemoryListener() = default;
+
+    virtual void onWrite(uint16_t addr) = 0;
+
+    /**
+     * Called after the whole of memory was replaced at once
+     */
+    virtual void onRestore() = 0;
+};
 
 class Memory {
 public:
+    /**
+     * Writes are tracked per page of PAGE_SIZE bytes, one bit per page
+     */
+    static constexpr uint16_t PAGE_SIZE = 64;
+    static constexpr uint16_t PAGE_COUNT = 4096 / PAGE_SIZE;
+
     Memory();
     uint8_t memory[4096]{0};
 
+    /**
+     * Returns a writable reference to the byte at addr, wrapping around at the end of memory.
+     * Listeners are notified, since the caller may write through the reference.
+     */
     uint8_t& operator[] (uint16_t addr);
+
+    /**
+     * Reads the byte at addr without notifying listeners
+     */
+    uint8_t read(uint16_t addr) const {
+        return this->memory[addr & 0xFFFu];
+    }
+
+    /**
+     * Copies size bytes of data into memory starting at addr, notifying listeners of each byte
+     */
+    void load(uint16_t addr, const uint8_t *data, size_t size);
+
+    /**
+     * Replaces all of memory with a copy of data, notifying listeners once
+     */
+    void restore(const uint8_t (&data)[4096]);
+
+    /**
+     * Bit p is set if page p may have been written since the last clearDirtyPages()
+     */
+    uint64_t dirtyPages() const {
+        return this->dirty_pages;
+    }
+
+    void clearDirtyPages();
+
+    void addListener(MemoryListener *listener);
+    void removeListener(MemoryListener *listener);
+
+private:
+    std::vector<MemoryListener *> listeners;
+    uint64_t dirty_pages;
 };
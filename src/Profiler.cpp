@@ -0,0 +1,197 @@
+#include <algorithm>
+#include <numeric>
+#include "Profiler.h"
+
+static const size_t ADDRESS_SPACE = 4096;
+
+Profiler::Profiler() : pc_executions(ADDRESS_SPACE), pc_cycles(ADDRESS_SPACE) {
+    this->reset();
+}
+
+void Profiler::reset() {
+    std::fill(this->op_executions, this->op_executions + (size_t) Op::Count, 0);
+    std::fill(this->op_cycles, this->op_cycles + (size_t) Op::Count, 0);
+    std::fill(this->pc_executions.begin(), this->pc_executions.end(), 0);
+    std::fill(this->pc_cycles.begin(), this->pc_cycles.end(), 0);
+    this->pixels = 0;
+    this->collided_draws = 0;
+    this->key_wait_cycles = 0;
+    this->frames.assign(1, Frame{0, 0, 0});
+    this->children.clear();
+    this->frame = 0;
+}
+
+void Profiler::waitForKey(uint16_t pc) {
+    pc &= 0xFFFu;
+    this->op_cycles[(size_t) Op::LD_VX_K]++;
+    this->pc_cycles[pc]++;
+    this->frames[this->frame].cycles++;
+    this->key_wait_cycles++;
+}
+
+void Profiler::draw(const uint8_t *sprite, uint8_t n, bool collided) {
+    for (int i = 0; i < n; ++i) {
+        for (uint8_t bits = sprite[i]; bits != 0; bits &= (uint8_t) (bits - 1)) {
+            this->pixels++;
+        }
+    }
+    this->collided_draws += collided ? 1 : 0;
+}
+
+void Profiler::call(uint16_t addr) {
+    uint64_t key = ((uint64_t) this->frame << 12u) | (addr & 0xFFFu);
+    auto found = this->children.find(key);
+    if (found != this->children.end()) {
+        this->frame = found->second;
+        return;
+    }
+
+    auto index = (uint32_t) this->frames.size();
+    this->frames.push_back(Frame{addr, this->frame, 0});
+    this->children.emplace(key, index);
+    this->frame = index;
+}
+
+void Profiler::ret() {
+    // returns from calls made before the profiler was attached stay at the root
+    this->frame = this->frames[this->frame].parent;
+}
+
+uint64_t Profiler::executions(Op op) const {
+    return this->op_executions[(size_t) op];
+}
+
+uint64_t Profiler::cycles(Op op) const {
+    return this->op_cycles[(size_t) op];
+}
+
+uint64_t Profiler::executionsAt(uint16_t pc) const {
+    return this->pc_executions[pc & 0xFFFu];
+}
+
+uint64_t Profiler::cyclesAt(uint16_t pc) const {
+    return this->pc_cycles[pc & 0xFFFu];
+}
+
+uint64_t Profiler::totalCycles() const {
+    return std::accumulate(this->op_cycles, this->op_cycles + (size_t) Op::Count, (uint64_t) 0);
+}
+
+uint64_t Profiler::pixelsDrawn() const {
+    return this->pixels;
+}
+
+uint64_t Profiler::collisions() const {
+    return this->collided_draws;
+}
+
+uint64_t Profiler::keyWaitCycles() const {
+    return this->key_wait_cycles;
+}
+
+/**
+ * Returns the indices of the non-zero entries of cycles, busiest first
+ */
+static std::vector<size_t> byCycles(const uint64_t *cycles, size_t count) {
+    std::vector<size_t> order;
+    for (size_t i = 0; i < count; ++i) {
+        if (cycles[i] > 0) {
+            order.push_back(i);
+        }
+    }
+    std::stable_sort(order.begin(), order.end(), [cycles](size_t a, size_t b) {
+        return cycles[a] > cycles[b];
+    });
+    return order;
+}
+
+bool Profiler::writeReport(FILE *file, size_t max_addresses) const {
+    uint64_t total = this->totalCycles();
+    auto percent = [total](uint64_t cycles) {
+        return total > 0 ? 100.0 * cycles / total : 0.0;
+    };
+
+    bool written = fprintf(file, "%llu cycles, %llu waiting for a key; %llu pixels drawn, %llu draws collided\n\n",
+                           (unsigned long long) total, (unsigned long long) this->key_wait_cycles,
+                           (unsigned long long) this->pixels, (unsigned long long) this->collided_draws) > 0;
+
+    written &= fprintf(file, "opcode     executions         cycles       %%\n") > 0;
+    for (size_t op : byCycles(this->op_cycles, (size_t) Op::Count)) {
+        written &= fprintf(file, "%-6s %14llu %14llu %6.2f%%\n", opcodePattern((Op) op),
+                           (unsigned long long) this->op_executions[op], (unsigned long long) this->op_cycles[op],
+                           percent(this->op_cycles[op])) > 0;
+    }
+
+    std::vector<size_t> addresses = byCycles(this->pc_cycles.data(), ADDRESS_SPACE);
+    if (addresses.size() > max_addresses) {
+        addresses.resize(max_addresses);
+    }
+    written &= fprintf(file, "\naddress    executions         cycles       %%\n") > 0;
+    for (size_t pc : addresses) {
+        written &= fprintf(file, "0x%03zX  %14llu %14llu %6.2f%%\n", pc, (unsigned long long) this->pc_executions[pc],
+                           (unsigned long long) this->pc_cycles[pc], percent(this->pc_cycles[pc])) > 0;
+    }
+    return written;
+}
+
+bool Profiler::writeJson(FILE *file) const {
+    bool written = fprintf(file, "{\n  \"cycles\": %llu,\n  \"key_wait_cycles\": %llu,\n  \"pixels_drawn\": %llu,\n"
+                                 "  \"collisions\": %llu,\n  \"opcodes\": [",
+                           (unsigned long long) this->totalCycles(), (unsigned long long) this->key_wait_cycles,
+                           (unsigned long long) this->pixels, (unsigned long long) this->collided_draws) > 0;
+
+    const char *separator = "\n";
+    for (size_t op : byCycles(this->op_cycles, (size_t) Op::Count)) {
+        written &= fprintf(file, "%s    {\"opcode\": \"%s\", \"executions\": %llu, \"cycles\": %llu}", separator,
+                           opcodePattern((Op) op), (unsigned long long) this->op_executions[op],
+                           (unsigned long long) this->op_cycles[op]) > 0;
+        separator = ",\n";
+    }
+
+    written &= fprintf(file, "\n  ],\n  \"addresses\": [") > 0;
+    separator = "\n";
+    for (size_t pc : byCycles(this->pc_cycles.data(), ADDRESS_SPACE)) {
+        written &= fprintf(file, "%s    {\"address\": %zu, \"executions\": %llu, \"cycles\": %llu}", separator, pc,
+                           (unsigned long long) this->pc_executions[pc], (unsigned long long) this->pc_cycles[pc]) > 0;
+        separator = ",\n";
+    }
+
+    written &= fprintf(file, "\n  ],\n  \"stacks\": [") > 0;
+    separator = "\n";
+    for (uint32_t i = 0; i < this->frames.size(); ++i) {
+        if (this->frames[i].cycles == 0) {
+            continue;
+        }
+        written &= fprintf(file, "%s    {\"stack\": \"", separator) > 0;
+        written &= this->writeChain(file, i);
+        written &= fprintf(file, "\", \"cycles\": %llu}", (unsigned long long) this->frames[i].cycles) > 0;
+        separator = ",\n";
+    }
+    written &= fprintf(file, "\n  ]\n}\n") > 0;
+    return written;
+}
+
+bool Profiler::writeCollapsed(FILE *file) const {
+    bool written = true;
+    for (uint32_t i = 0; i < this->frames.size(); ++i) {
+        if (this->frames[i].cycles == 0) {
+            continue;
+        }
+        written &= this->writeChain(file, i);
+        written &= fprintf(file, " %llu\n", (unsigned long long) this->frames[i].cycles) > 0;
+    }
+    return written;
+}
+
+bool Profiler::writeChain(FILE *file, uint32_t index) const {
+    std::vector<uint16_t> chain;
+    for (; index != 0; index = this->frames[index].parent) {
+        chain.push_back(this->frames[index].addr);
+    }
+
+    bool written = fputs("rom", file) >= 0;
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+        written &= fprintf(file, ";sub_%03X", *it) > 0;
+    }
+    return written;
+}
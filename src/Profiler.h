@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <unordered_map>
+#include <vector>
+#include "Instruction.h"
+
+/*
+ * Profile points are only compiled in when CHIP8_PROFILE is defined; otherwise they compile to nothing
+ * and an attached Profiler stays empty.
+ */
+#ifdef CHIP8_PROFILE
+#define CHIP8_PROFILE_EVENT(cpu, event) \
+    do { if ((cpu).profiler != nullptr) { (cpu).profiler->event; } } while (false)
+#define CHIP8_PROFILING(cpu) ((cpu).profiler != nullptr)
+#else
+#define CHIP8_PROFILE_EVENT(cpu, event) ((void) 0)
+#define CHIP8_PROFILING(cpu) false
+#endif
+
+/**
+ * Counts where a Cpu spends its cycles: executions and cycles of every opcode and every address,
+ * cycles of every call chain, pixels drawn, collisions and cycles spent waiting for a key.
+ *
+ * Every instruction takes one cycle, except FX0A, which also takes every cycle spent waiting.
+ * Call chains follow the 2NNN and 00EE executed since the profiler was attached or reset.
+ */
+class Profiler {
+public:
+    Profiler();
+
+    /**
+     * Clears every counter and starts a new call chain at the root
+     */
+    void reset();
+
+    /**
+     * Counts an instruction about to be executed at pc
+     */
+    void instruction(uint16_t pc, Op op) {
+        pc &= 0xFFFu;
+        this->op_executions[(size_t) op]++;
+        this->op_cycles[(size_t) op]++;
+        this->pc_executions[pc]++;
+        this->pc_cycles[pc]++;
+        this->frames[this->frame].cycles++;
+    }
+
+    /**
+     * Counts a cycle spent waiting for a key by the FX0A at pc
+     */
+    void waitForKey(uint16_t pc);
+
+    /**
+     * Counts a sprite of n rows drawn by DXYN
+     */
+    void draw(const uint8_t *sprite, uint8_t n, bool collided);
+
+    /**
+     * Enters the subroutine at addr, called by 2NNN
+     */
+    void call(uint16_t addr);
+
+    /**
+     * Returns to the caller, by 00EE
+     */
+    void ret();
+
+    uint64_t executions(Op op) const;
+    uint64_t cycles(Op op) const;
+    uint64_t executionsAt(uint16_t pc) const;
+    uint64_t cyclesAt(uint16_t pc) const;
+
+    /**
+     * The number of cycles counted so far
+     */
+    uint64_t totalCycles() const;
+
+    uint64_t pixelsDrawn() const;
+    uint64_t collisions() const;
+    uint64_t keyWaitCycles() const;
+
+    /**
+     * Writes a human readable report: the totals, then opcodes and the max_addresses busiest
+     * addresses, both sorted by cycles
+     */
+    bool writeReport(FILE *file, size_t max_addresses = 32) const;
+
+    /**
+     * Writes every counter as JSON
+     */
+    bool writeJson(FILE *file) const;
+
+    /**
+     * Writes the cycles of every call chain as collapsed stacks, one "rom;sub_2A0;sub_31C cycles" line
+     * each, as read by flamegraph.pl, speedscope and similar tools
+     */
+    bool writeCollapsed(FILE *file) const;
+
+private:
+    /**
+     * A call chain: the subroutine at addr entered from the chain parent
+     */
+    struct Frame {
+        uint16_t addr;
+        uint32_t parent;
+        uint64_t cycles;
+    };
+
+    uint64_t op_executions[(size_t) Op::Count];
+    uint64_t op_cycles[(size_t) Op::Count];
+    std::vector<uint64_t> pc_executions;
+    std::vector<uint64_t> pc_cycles;
+
+    uint64_t pixels;
+    uint64_t collided_draws;
+    uint64_t key_wait_cycles;
+
+    /**
+     * Every call chain seen, the root first
+     */
+    std::vector<Frame> frames;
+
+    /**
+     * Chains by parent index and subroutine address
+     */
+    std::unordered_map<uint64_t, uint32_t> children;
+
+    /**
+     * The chain currently executing
+     */
+    uint32_t frame;
+
+    /**
+     * Writes the chain ending at index as "rom;sub_2A0;...", without a newline
+     */
+    bool writeChain(FILE *file, uint32_t index) const;
+};
@@ -0,0 +1,111 @@
+#include <cstdio>
+#include <cstring>
+#include "Quirks.h"
+#include "Rom.h"
+
+constexpr bool Quirks<QuirkProfile::CosmacVip>::shift_vy;
+constexpr bool Quirks<QuirkProfile::CosmacVip>::memory_increments_i;
+constexpr bool Quirks<QuirkProfile::CosmacVip>::jump_vx;
+constexpr bool Quirks<QuirkProfile::CosmacVip>::display_wait;
+constexpr bool Quirks<QuirkProfile::CosmacVip>::clip;
+constexpr bool Quirks<QuirkProfile::SuperChip>::shift_vy;
+constexpr bool Quirks<QuirkProfile::SuperChip>::memory_increments_i;
+constexpr bool Quirks<QuirkProfile::SuperChip>::jump_vx;
+constexpr bool Quirks<QuirkProfile::SuperChip>::display_wait;
+constexpr bool Quirks<QuirkProfile::SuperChip>::clip;
+constexpr bool Quirks<QuirkProfile::Modern>::shift_vy;
+constexpr bool Quirks<QuirkProfile::Modern>::memory_increments_i;
+constexpr bool Quirks<QuirkProfile::Modern>::jump_vx;
+constexpr bool Quirks<QuirkProfile::Modern>::display_wait;
+constexpr bool Quirks<QuirkProfile::Modern>::clip;
+
+const char *quirkProfileName(QuirkProfile profile) {
+    switch (profile) {
+        case QuirkProfile::CosmacVip:
+            return "vip";
+        case QuirkProfile::SuperChip:
+            return "schip";
+        case QuirkProfile::Modern:
+            return "modern";
+        default:
+            return "unknown";
+    }
+}
+
+bool parseQuirkProfile(const char *name, QuirkProfile &profile) {
+    for (uint8_t i = 0; i < (uint8_t) QuirkProfile::Count; ++i) {
+        if (std::strcmp(name, quirkProfileName((QuirkProfile) i)) == 0) {
+            profile = (QuirkProfile) i;
+            return true;
+        }
+    }
+    return false;
+}
+
+template<QuirkProfile P>
+static QuirkFlags flags() {
+    return QuirkFlags{Quirks<P>::shift_vy, Quirks<P>::memory_increments_i, Quirks<P>::jump_vx,
+                      Quirks<P>::display_wait, Quirks<P>::clip};
+}
+
+QuirkFlags quirkFlags(QuirkProfile profile) {
+    switch (profile) {
+        case QuirkProfile::CosmacVip:
+            return flags<QuirkProfile::CosmacVip>();
+        case QuirkProfile::SuperChip:
+            return flags<QuirkProfile::SuperChip>();
+        default:
+            return flags<QuirkProfile::Modern>();
+    }
+}
+
+bool QuirkDatabase::load(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (file == nullptr) {
+        return false;
+    }
+
+    char line[1024];
+    bool valid = true;
+    while (valid && fgets(line, sizeof(line), file) != nullptr) {
+        if (line[0] == '#' || line[strspn(line, " \t\r\n")] == '\0') {
+            continue;
+        }
+
+        // hash profile, then an optional comment such as the rom's name
+        unsigned long long hash;
+        char name[16];
+        QuirkProfile profile;
+        valid = sscanf(line, "%16llx %15s", &hash, name) == 2 && parseQuirkProfile(name, profile);
+        if (valid) {
+            this->add(hash, profile);
+        }
+    }
+    fclose(file);
+    return valid;
+}
+
+void QuirkDatabase::add(uint64_t hash, QuirkProfile profile) {
+    this->entries[hash] = profile;
+}
+
+bool QuirkDatabase::find(uint64_t hash, QuirkProfile &profile) const {
+    auto entry = this->entries.find(hash);
+    if (entry == this->entries.end()) {
+        return false;
+    }
+    profile = entry->second;
+    return true;
+}
+
+size_t QuirkDatabase::size() const {
+    return this->entries.size();
+}
+
+QuirkProfile QuirkDatabase::select(const uint8_t *rom, size_t size) const {
+    QuirkProfile profile;
+    if (this->find(romHash(rom, size), profile)) {
+        return profile;
+    }
+    return detectProfile(rom, size) == RomProfile::SuperChip ? QuirkProfile::SuperChip : QuirkProfile::Modern;
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+/**
+ * The interpreters whose behaviour ROMs depend on where the original CHIP-8 left it unclear or where
+ * later machines changed it
+ */
+enum class QuirkProfile : uint8_t {
+    /**
+     * The original COSMAC VIP interpreter
+     */
+    CosmacVip,
+
+    /**
+     * SUPER-CHIP 1.1 on the HP 48
+     */
+    SuperChip,
+
+    /**
+     * What most ROMs written since the 1990s expect, and the default
+     */
+    Modern,
+
+    Count
+};
+
+const char *quirkProfileName(QuirkProfile profile);
+
+/**
+ * Parses a name returned by quirkProfileName(). Returns false, leaving profile untouched, if it is unknown.
+ */
+bool parseQuirkProfile(const char *name, QuirkProfile &profile);
+
+/**
+ * The behaviour of a profile, as compile-time constants the instruction handlers are instantiated with
+ */
+template<QuirkProfile P>
+struct Quirks;
+
+template<>
+struct Quirks<QuirkProfile::CosmacVip> {
+    /**
+     * 8XY6 and 8XYE shift VY into VX, rather than VX in place
+     */
+    static constexpr bool shift_vy = true;
+
+    /**
+     * FX55 and FX65 leave I pointing past the last register transferred
+     */
+    static constexpr bool memory_increments_i = true;
+
+    /**
+     * BNNN is BXNN, jumping to XNN + VX, rather than NNN + V0
+     */
+    static constexpr bool jump_vx = false;
+
+    /**
+     * DXYN waits for the start of the next frame before drawing
+     */
+    static constexpr bool display_wait = true;
+
+    /**
+     * Sprites are cut off at the right and bottom edges of the screen, rather than wrapping around
+     */
+    static constexpr bool clip = true;
+};
+
+template<>
+struct Quirks<QuirkProfile::SuperChip> {
+    static constexpr bool shift_vy = false;
+    static constexpr bool memory_increments_i = false;
+    static constexpr bool jump_vx = true;
+    static constexpr bool display_wait = false;
+    static constexpr bool clip = true;
+};
+
+template<>
+struct Quirks<QuirkProfile::Modern> {
+    static constexpr bool shift_vy = false;
+    static constexpr bool memory_increments_i = false;
+    static constexpr bool jump_vx = false;
+    static constexpr bool display_wait = false;
+    static constexpr bool clip = false;
+};
+
+/**
+ * The constants of Quirks<P> for a profile only known at run time, for code generators deciding
+ * what to emit; the instruction handlers use the constants themselves
+ */
+struct QuirkFlags {
+    bool shift_vy;
+    bool memory_increments_i;
+    bool jump_vx;
+    bool display_wait;
+    bool clip;
+};
+
+QuirkFlags quirkFlags(QuirkProfile profile);
+
+/**
+ * The profile each known ROM needs, by romHash()
+ */
+class QuirkDatabase {
+public:
+    /**
+     * Adds the entries of a text file with one ROM per line: its hash in hex and a profile name,
+     * followed by anything, e.g. the name of the ROM. Lines starting with # are ignored.
+     * Returns false if the file cannot be read or a line does not parse; the entries before it are kept.
+     */
+    bool load(const char *path);
+
+    void add(uint64_t hash, QuirkProfile profile);
+
+    /**
+     * Returns true and sets profile if the ROM with the given hash is known
+     */
+    bool find(uint64_t hash, QuirkProfile &profile) const;
+
+    size_t size() const;
+
+    /**
+     * The profile to run a ROM with: its entry if it is known, otherwise SUPER-CHIP for ROMs
+     * detectProfile() recognizes as such and Modern for the rest
+     */
+    QuirkProfile select(const uint8_t *rom, size_t size) const;
+
+private:
+    std::unordered_map<uint64_t, QuirkProfile> entries;
+};
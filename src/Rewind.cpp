@@ -0,0 +1,147 @@
+#include <algorithm>
+#include <memory>
+#include "Rewind.h"
+
+Rewind::Rewind(Machine &machine, size_t budget, uint32_t keyframe_interval) :
+        machine(machine), budget(budget), keyframe_interval(std::max<uint32_t>(keyframe_interval, 1)),
+        used(0), since_keyframe(0), last_rows{}, last_hires_rows{} {
+}
+
+size_t Rewind::Frame::size() const {
+    return sizeof(Frame) + this->pages.capacity() + this->rows.capacity() * sizeof(uint64_t);
+}
+
+size_t Rewind::frames() const {
+    return this->history.size();
+}
+
+size_t Rewind::memoryUsage() const {
+    return this->used;
+}
+
+void Rewind::clear() {
+    this->history.clear();
+    this->used = 0;
+    this->since_keyframe = 0;
+}
+
+void Rewind::record() {
+    const Memory &memory = this->machine.memory;
+    const Graphics &graphics = this->machine.graphics;
+
+    Frame frame;
+    frame.keyframe = this->history.empty() || this->since_keyframe + 1 >= this->keyframe_interval;
+    frame.cpu = this->machine.cpu.snapshot();
+    frame.quirks = this->machine.cpu.quirks();
+    frame.page_mask = frame.keyframe ? ~0ull : memory.dirtyPages();
+    frame.row_mask = 0;
+    frame.hires = graphics.isHires();
+    frame.hires_row_mask = 0;
+
+    for (uint16_t page = 0; page < Memory::PAGE_COUNT; ++page) {
+        if (frame.page_mask & (1ull << page)) {
+            const uint8_t *start = memory.memory + page * Memory::PAGE_SIZE;
+            frame.pages.insert(frame.pages.end(), start, start + Memory::PAGE_SIZE);
+        }
+    }
+    for (int row = 0; row < Graphics::HEIGHT; ++row) {
+        if (frame.keyframe || graphics.rows[row] != this->last_rows[row]) {
+            frame.row_mask |= 1u << (unsigned) row;
+            frame.rows.push_back(graphics.rows[row]);
+        }
+    }
+
+    for (int row = 0; row < Graphics::HIRES_HEIGHT; ++row) {
+        const uint64_t *words = graphics.hires_rows[row];
+        if (frame.keyframe || words[0] != this->last_hires_rows[row][0] || words[1] != this->last_hires_rows[row][1]) {
+            frame.hires_row_mask |= 1ull << (unsigned) row;
+            frame.rows.insert(frame.rows.end(), words, words + 2);
+        }
+    }
+
+    std::copy(graphics.rows, graphics.rows + Graphics::HEIGHT, this->last_rows);
+    std::copy(graphics.hires_rows[0], graphics.hires_rows[0] + 2 * Graphics::HIRES_HEIGHT, this->last_hires_rows[0]);
+    this->machine.memory.clearDirtyPages();
+
+    this->since_keyframe = frame.keyframe ? 0 : this->since_keyframe + 1;
+    this->used += frame.size();
+    this->history.push_back(std::move(frame));
+    this->evict();
+}
+
+void Rewind::evict() {
+    while (this->used > this->budget) {
+        // drop the oldest keyframe together with its deltas, but always keep the newest keyframe
+        auto next = std::find_if(this->history.begin() + 1, this->history.end(), [](const Frame &frame) {
+            return frame.keyframe;
+        });
+        if (next == this->history.end()) {
+            return;
+        }
+        for (auto count = next - this->history.begin(); count > 0; --count) {
+            this->used -= this->history.front().size();
+            this->history.pop_front();
+        }
+    }
+}
+
+void Rewind::rebuild(size_t index, MachineState &out) const {
+    size_t first = index;
+    while (!this->history[first].keyframe) {
+        first--;
+    }
+
+    for (size_t i = first; i <= index; ++i) {
+        const Frame &frame = this->history[i];
+        out.cpu = frame.cpu;
+        out.quirks = frame.quirks;
+
+        const uint8_t *page_data = frame.pages.data();
+        for (uint16_t page = 0; page < Memory::PAGE_COUNT; ++page) {
+            if (frame.page_mask & (1ull << page)) {
+                std::copy(page_data, page_data + Memory::PAGE_SIZE, out.memory + page * Memory::PAGE_SIZE);
+                page_data += Memory::PAGE_SIZE;
+            }
+        }
+
+        const uint64_t *row_data = frame.rows.data();
+        for (int row = 0; row < Graphics::HEIGHT; ++row) {
+            if (frame.row_mask & (1u << (unsigned) row)) {
+                out.rows[row] = *row_data++;
+            }
+        }
+        out.hires = frame.hires ? 1 : 0;
+        for (int row = 0; row < Graphics::HIRES_HEIGHT; ++row) {
+            if (frame.hires_row_mask & (1ull << (unsigned) row)) {
+                out.hires_rows[row][0] = *row_data++;
+                out.hires_rows[row][1] = *row_data++;
+            }
+        }
+    }
+}
+
+bool Rewind::stepBack() {
+    if (this->history.size() < 2) {
+        return false;
+    }
+
+    std::unique_ptr<MachineState> state(new MachineState());
+    this->rebuild(this->history.size() - 2, *state);
+    if (!this->machine.restore(*state)) {
+        return false;
+    }
+
+    this->used -= this->history.back().size();
+    this->history.pop_back();
+
+    this->since_keyframe = 0;
+    for (size_t i = this->history.size() - 1; !this->history[i].keyframe; --i) {
+        this->since_keyframe++;
+    }
+
+    // the machine now matches the newest frame exactly
+    std::copy(state->rows, state->rows + Graphics::HEIGHT, this->last_rows);
+    std::copy(state->hires_rows[0], state->hires_rows[0] + 2 * Graphics::HIRES_HEIGHT, this->last_hires_rows[0]);
+    this->machine.memory.clearDirtyPages();
+    return true;
+}
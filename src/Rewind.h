@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include "Machine.h"
+
+/**
+ * Frame history of a Machine that can be stepped backwards.
+ *
+ * Every recorded frame stores the cpu state plus only the memory pages and framebuffer rows that
+ * changed since the previous frame, found through Memory's dirty pages. Every keyframe_interval
+ * frames a keyframe stores everything, so any frame is rebuilt from the keyframe before it and at
+ * most keyframe_interval - 1 deltas. Once the history exceeds its byte budget, the oldest keyframe
+ * and its deltas are dropped.
+ */
+class Rewind {
+public:
+    explicit Rewind(Machine &machine, size_t budget = 4 * 1024 * 1024, uint32_t keyframe_interval = 60);
+
+    Rewind(const Rewind &) = delete;
+    Rewind &operator=(const Rewind &) = delete;
+
+    /**
+     * Appends the current state of the machine as the newest frame
+     */
+    void record();
+
+    /**
+     * Restores the frame before the newest one and discards the newest.
+     * Returns false, leaving the machine untouched, if fewer than two frames are recorded.
+     */
+    bool stepBack();
+
+    /**
+     * Discards the whole history
+     */
+    void clear();
+
+    /**
+     * The number of frames that can be restored
+     */
+    size_t frames() const;
+
+    /**
+     * Approximate number of bytes used by the history
+     */
+    size_t memoryUsage() const;
+
+private:
+    struct Frame {
+        bool keyframe;
+        CpuState cpu;
+        QuirkProfile quirks;
+        uint64_t page_mask;
+        uint32_t row_mask;
+        bool hires;
+        uint64_t hires_row_mask;
+
+        /**
+         * Contents of the pages in page_mask, then the rows in row_mask, then both words of the
+         * hi-res rows in hires_row_mask, in ascending order
+         */
+        std::vector<uint8_t> pages;
+        std::vector<uint64_t> rows;
+
+        size_t size() const;
+    };
+
+    Machine &machine;
+    size_t budget;
+    uint32_t keyframe_interval;
+
+    std::deque<Frame> history;
+    size_t used;
+
+    /**
+     * Frames recorded since the last keyframe
+     */
+    uint32_t since_keyframe;
+
+    /**
+     * Framebuffer of the newest frame, to find the rows that changed
+     */
+    uint64_t last_rows[Graphics::HEIGHT];
+    uint64_t last_hires_rows[Graphics::HIRES_HEIGHT][2];
+
+    void evict();
+    void rebuild(size_t index, MachineState &out) const;
+};
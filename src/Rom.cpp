@@ -0,0 +1,282 @@
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+#include "Machine.h"
+#include "Rom.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define CHIP8_POSIX_FILES 1
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+const char *const RomLibrary::INDEX_NAME = ".chip8-index";
+
+static const char INDEX_HEADER[] = "chip8-rom-index 1";
+
+uint64_t romHash(const uint8_t *data, size_t size) {
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+const char *profileName(RomProfile profile) {
+    switch (profile) {
+        case RomProfile::Chip8:
+            return "chip8";
+        case RomProfile::SuperChip:
+            return "schip";
+    }
+    return "unknown";
+}
+
+static bool isSuperChipOpcode(uint16_t opcode) {
+    switch (opcode & 0xF000u) {
+        case 0x0000:
+            return opcode == 0x00FB || opcode == 0x00FC || opcode == 0x00FD || opcode == 0x00FE
+                   || opcode == 0x00FF || (opcode & 0xFFF0u) == 0x00C0;
+        case 0xD000:
+            return (opcode & 0x000Fu) == 0;
+        case 0xF000:
+            return (opcode & 0x00FFu) == 0x30 || (opcode & 0x00FFu) == 0x75 || (opcode & 0x00FFu) == 0x85;
+        default:
+            return false;
+    }
+}
+
+RomProfile detectProfile(const uint8_t *data, size_t size) {
+    // sprite data can look like any opcode, so a single match is not enough
+    int matches = 0;
+    for (size_t i = 0; i + 1 < size; i += 2) {
+        uint16_t opcode = (uint16_t) ((data[i] << 8u) | data[i + 1]);
+        if (opcode != 0x00C0 && isSuperChipOpcode(opcode) && ++matches >= 2) {
+            return RomProfile::SuperChip;
+        }
+    }
+    return RomProfile::Chip8;
+}
+
+RomFile::RomFile() : contents(nullptr), length(0), mapped(false), content_hash(0), last_error(nullptr) {
+}
+
+RomFile::~RomFile() {
+    this->close();
+}
+
+void RomFile::close() {
+#ifdef CHIP8_POSIX_FILES
+    if (this->mapped) {
+        munmap(const_cast<uint8_t *>(this->contents), this->length);
+    }
+#endif
+    this->buffer.clear();
+    this->contents = nullptr;
+    this->length = 0;
+    this->mapped = false;
+    this->content_hash = 0;
+}
+
+bool RomFile::open(const char *path) {
+    this->close();
+
+#ifdef CHIP8_POSIX_FILES
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        this->last_error = "could not be opened";
+        return false;
+    }
+
+    struct stat info{};
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        ::close(fd);
+        this->last_error = "is not a regular file";
+        return false;
+    }
+    size_t size = (size_t) info.st_size;
+    if (size == 0 || size > Machine::MAX_PROGRAM_SIZE) {
+        ::close(fd);
+        this->last_error = size == 0 ? "is empty" : "is too large to fit in memory";
+        return false;
+    }
+
+    void *mem = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mem == MAP_FAILED) {
+        this->last_error = "could not be mapped";
+        return false;
+    }
+    this->contents = static_cast<const uint8_t *>(mem);
+    this->length = size;
+    this->mapped = true;
+#else
+    FILE *file = fopen(path, "rb");
+    if (file == nullptr) {
+        this->last_error = "could not be opened";
+        return false;
+    }
+
+    // read one byte more than fits, to tell a full-size rom from a larger file
+    this->buffer.resize(Machine::MAX_PROGRAM_SIZE + 1);
+    size_t size = fread(this->buffer.data(), 1, this->buffer.size(), file);
+    fclose(file);
+    if (size == 0 || size > Machine::MAX_PROGRAM_SIZE) {
+        this->buffer.clear();
+        this->last_error = size == 0 ? "is empty" : "is too large to fit in memory";
+        return false;
+    }
+    this->buffer.resize(size);
+    this->contents = this->buffer.data();
+    this->length = size;
+#endif
+
+    this->content_hash = romHash(this->contents, this->length);
+    this->last_error = nullptr;
+    return true;
+}
+
+const uint8_t *RomFile::data() const {
+    return this->contents;
+}
+
+size_t RomFile::size() const {
+    return this->length;
+}
+
+uint64_t RomFile::hash() const {
+    return this->content_hash;
+}
+
+const char *RomFile::error() const {
+    return this->last_error != nullptr ? this->last_error : "";
+}
+
+RomLibrary::RomLibrary(std::string directory) : directory(std::move(directory)) {
+}
+
+const std::vector<RomEntry> &RomLibrary::entries() const {
+    return this->roms;
+}
+
+const RomEntry *RomLibrary::find(const std::string &name) const {
+    for (auto &entry : this->roms) {
+        if (entry.name == name) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+const RomEntry *RomLibrary::find(uint64_t hash) const {
+    for (auto &entry : this->roms) {
+        if (entry.hash == hash) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+std::string RomLibrary::path(const RomEntry &entry) const {
+    return this->directory + "/" + entry.name;
+}
+
+bool RomLibrary::loadIndex(std::vector<RomEntry> &out) const {
+    FILE *file = fopen((this->directory + "/" + INDEX_NAME).c_str(), "r");
+    if (file == nullptr) {
+        return false;
+    }
+
+    char line[1024];
+    bool valid = fgets(line, sizeof(line), file) != nullptr && strncmp(line, INDEX_HEADER, strlen(INDEX_HEADER)) == 0;
+    while (valid && fgets(line, sizeof(line), file) != nullptr) {
+        // hash size mtime profile name, the name taking the rest of the line
+        RomEntry entry{};
+        unsigned long long hash, size;
+        long long mtime;
+        char profile[16];
+        int name_start = 0;
+        if (sscanf(line, "%16llx %llu %lld %15s %n", &hash, &size, &mtime, profile, &name_start) < 4 || name_start == 0) {
+            continue;
+        }
+        entry.name = line + name_start;
+        entry.name.erase(entry.name.find_last_not_of("\r\n") + 1);
+        entry.hash = hash;
+        entry.size = size;
+        entry.mtime = mtime;
+        entry.profile = strcmp(profile, profileName(RomProfile::SuperChip)) == 0 ? RomProfile::SuperChip : RomProfile::Chip8;
+        out.push_back(entry);
+    }
+    fclose(file);
+    return valid;
+}
+
+bool RomLibrary::saveIndex() const {
+    FILE *file = fopen((this->directory + "/" + INDEX_NAME).c_str(), "w");
+    if (file == nullptr) {
+        return false;
+    }
+
+    bool written = fprintf(file, "%s\n", INDEX_HEADER) > 0;
+    for (auto &entry : this->roms) {
+        written &= fprintf(file, "%016llx %llu %lld %s %s\n", (unsigned long long) entry.hash,
+                           (unsigned long long) entry.size, (long long) entry.mtime, profileName(entry.profile),
+                           entry.name.c_str()) > 0;
+    }
+    return fclose(file) == 0 && written;
+}
+
+size_t RomLibrary::refresh() {
+    std::vector<RomEntry> indexed;
+    this->loadIndex(indexed);
+    this->roms.clear();
+
+    size_t hashed = 0;
+#ifdef CHIP8_POSIX_FILES
+    DIR *dir = opendir(this->directory.c_str());
+    if (dir == nullptr) {
+        return 0;
+    }
+
+    while (dirent *item = readdir(dir)) {
+        std::string name = item->d_name;
+        if (name[0] == '.') {
+            continue;
+        }
+
+        struct stat info{};
+        if (stat((this->directory + "/" + name).c_str(), &info) != 0 || !S_ISREG(info.st_mode)) {
+            continue;
+        }
+
+        auto known = std::find_if(indexed.begin(), indexed.end(), [&](const RomEntry &entry) {
+            return entry.name == name && entry.size == (uint64_t) info.st_size && entry.mtime == (int64_t) info.st_mtime;
+        });
+        if (known != indexed.end()) {
+            this->roms.push_back(*known);
+            continue;
+        }
+
+        RomFile rom;
+        if (!rom.open((this->directory + "/" + name).c_str())) {
+            continue;
+        }
+        this->roms.push_back(RomEntry{name, rom.size(), (int64_t) info.st_mtime, rom.hash(),
+                                      detectProfile(rom.data(), rom.size())});
+        hashed++;
+    }
+    closedir(dir);
+#endif
+
+    std::sort(this->roms.begin(), this->roms.end(), [](const RomEntry &a, const RomEntry &b) {
+        return a.name < b.name;
+    });
+    this->saveIndex();
+    return hashed;
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Returns the 64-bit FNV-1a hash of data, used to identify ROMs by content
+ */
+uint64_t romHash(const uint8_t *data, size_t size);
+
+/**
+ * The machine a ROM was written for, as far as its opcodes tell
+ */
+enum class RomProfile : uint8_t {
+    Chip8,
+
+    /**
+     * Uses SUPER-CHIP instructions such as scrolling, high resolution mode or 16x16 sprites
+     */
+    SuperChip,
+};
+
+const char *profileName(RomProfile profile);
+
+/**
+ * Guesses the profile of a ROM by looking for SUPER-CHIP opcodes
+ */
+RomProfile detectProfile(const uint8_t *data, size_t size);
+
+/**
+ * A ROM image mapped read-only into memory.
+ * Where memory mapping is unavailable, the file is read into a buffer instead.
+ */
+class RomFile {
+public:
+    RomFile();
+    ~RomFile();
+
+    RomFile(const RomFile &) = delete;
+    RomFile &operator=(const RomFile &) = delete;
+
+    /**
+     * Maps the file at path, replacing any previously opened file.
+     * Returns false if it cannot be read, is empty or does not fit between 0x200 and 0xFFF.
+     */
+    bool open(const char *path);
+
+    void close();
+
+    const uint8_t *data() const;
+    size_t size() const;
+
+    /**
+     * The romHash() of the contents
+     */
+    uint64_t hash() const;
+
+    /**
+     * Describes why the last open() failed
+     */
+    const char *error() const;
+
+private:
+    const uint8_t *contents;
+    size_t length;
+    bool mapped;
+    uint64_t content_hash;
+    const char *last_error;
+    std::vector<uint8_t> buffer;
+};
+
+struct RomEntry {
+    /**
+     * File name, relative to the library directory
+     */
+    std::string name;
+    uint64_t size;
+    int64_t mtime;
+    uint64_t hash;
+    RomProfile profile;
+};
+
+/**
+ * An index of the ROMs in a directory, kept on disk in the directory as INDEX_NAME.
+ *
+ * Refreshing only hashes files whose size or modification time differ from the index, so large
+ * collections are listed without reading every ROM again.
+ */
+class RomLibrary {
+public:
+    static const char *const INDEX_NAME;
+
+    explicit RomLibrary(std::string directory);
+
+    /**
+     * Loads the index, rescans the directory and writes the index back.
+     * Returns the number of files that had to be hashed.
+     */
+    size_t refresh();
+
+    const std::vector<RomEntry> &entries() const;
+
+    /**
+     * Returns the entry with the given name or hash, or nullptr
+     */
+    const RomEntry *find(const std::string &name) const;
+    const RomEntry *find(uint64_t hash) const;
+
+    /**
+     * The full path of an entry
+     */
+    std::string path(const RomEntry &entry) const;
+
+private:
+    std::string directory;
+    std::vector<RomEntry> roms;
+
+    bool loadIndex(std::vector<RomEntry> &out) const;
+    bool saveIndex() const;
+};
@@ -0,0 +1,234 @@
+#include <cstring>
+#include "SaveState.h"
+
+static const char SAVE_STATE_MAGIC[4] = {'C', '8', 'S', 'S'};
+static const uint16_t SAVE_STATE_VERSION = 2;
+static const size_t HEADER_SIZE = 18;
+
+// the size of every field serialize() writes, the only payload size a valid file can have
+static const size_t PAYLOAD_SIZE = sizeof(CpuState::pc) + sizeof(CpuState::instruction_register)
+                                   + sizeof(CpuState::data_registers) + sizeof(CpuState::stack)
+                                   + sizeof(CpuState::stack_pointer) + sizeof(CpuState::delay_timer)
+                                   + sizeof(CpuState::sound_timer) + sizeof(CpuState::waiting_for_key)
+                                   + sizeof(CpuState::waiting_for_key_reg) + sizeof(CpuState::cycles_per_frame)
+                                   + sizeof(CpuState::frame_countdown) + sizeof(CpuState::cycles)
+                                   + sizeof(CpuState::rng_state) + sizeof(MachineState::memory)
+                                   + sizeof(MachineState::rows) + sizeof(MachineState::hires)
+                                   + sizeof(MachineState::hires_rows);
+
+static void put(std::vector<uint8_t> &out, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; ++i) {
+        out.push_back((uint8_t) (value >> (8u * i)));
+    }
+}
+
+/**
+ * Reads little-endian fields from a buffer, failing once it runs past the end
+ */
+class Reader {
+public:
+    Reader(const uint8_t *data, size_t size) : data(data), size(size), offset(0) {}
+
+    template<typename T>
+    bool get(T &value) {
+        if (this->size - this->offset < sizeof(T)) {
+            return false;
+        }
+        uint64_t result = 0;
+        for (size_t i = 0; i < sizeof(T); ++i) {
+            result |= (uint64_t) this->data[this->offset++] << (8u * i);
+        }
+        value = (T) result;
+        return true;
+    }
+
+    template<typename T, size_t N>
+    bool get(T (&values)[N]) {
+        for (auto &value : values) {
+            if (!this->get(value)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool atEnd() const {
+        return this->offset == this->size;
+    }
+
+private:
+    const uint8_t *data;
+    size_t size;
+    size_t offset;
+};
+
+template<typename T>
+static void put(std::vector<uint8_t> &out, const T &value) {
+    put(out, (uint64_t) value, sizeof(T));
+}
+
+template<typename T, size_t N>
+static void put(std::vector<uint8_t> &out, const T (&values)[N]) {
+    for (const auto &value : values) {
+        put(out, value);
+    }
+}
+
+static std::vector<uint8_t> serialize(const MachineState &state) {
+    const CpuState &cpu = state.cpu;
+    std::vector<uint8_t> out;
+    out.reserve(PAYLOAD_SIZE);
+
+    put(out, cpu.pc);
+    put(out, cpu.instruction_register);
+    put(out, cpu.data_registers);
+    put(out, cpu.stack);
+    put(out, cpu.stack_pointer);
+    put(out, cpu.delay_timer);
+    put(out, cpu.sound_timer);
+    put(out, cpu.waiting_for_key);
+    put(out, cpu.waiting_for_key_reg);
+    put(out, cpu.cycles_per_frame);
+    put(out, cpu.frame_countdown);
+    put(out, cpu.cycles);
+    put(out, cpu.rng_state);
+    put(out, state.memory);
+    put(out, state.rows);
+    put(out, state.hires);
+    put(out, state.hires_rows);
+    return out;
+}
+
+static bool deserialize(const uint8_t *data, size_t size, MachineState &out) {
+    CpuState &cpu = out.cpu;
+    Reader in(data, size);
+
+    return in.get(cpu.pc)
+           && in.get(cpu.instruction_register)
+           && in.get(cpu.data_registers)
+           && in.get(cpu.stack)
+           && in.get(cpu.stack_pointer)
+           && in.get(cpu.delay_timer)
+           && in.get(cpu.sound_timer)
+           && in.get(cpu.waiting_for_key)
+           && in.get(cpu.waiting_for_key_reg)
+           && in.get(cpu.cycles_per_frame)
+           && in.get(cpu.frame_countdown)
+           && in.get(cpu.cycles)
+           && in.get(cpu.rng_state)
+           && in.get(out.memory)
+           && in.get(out.rows)
+           && in.get(out.hires)
+           && in.get(out.hires_rows)
+           && in.atEnd();
+}
+
+/*
+ * PackBits-style run-length encoding. A control byte c < 128 is followed by c + 1 literal bytes;
+ * c >= 128 is followed by one byte repeated c - 125 times, i.e. runs of 3 to 130 bytes.
+ * Mostly empty memory and screens shrink to a small fraction of their size.
+ */
+
+static void compress(const std::vector<uint8_t> &in, std::vector<uint8_t> &out) {
+    size_t i = 0;
+    while (i < in.size()) {
+        size_t run = 1;
+        while (i + run < in.size() && run < 130 && in[i + run] == in[i]) {
+            run++;
+        }
+
+        if (run >= 3) {
+            out.push_back((uint8_t) (run + 125));
+            out.push_back(in[i]);
+            i += run;
+            continue;
+        }
+
+        // literals up to the next run of 3 or more
+        size_t start = i;
+        while (i < in.size() && i - start < 128) {
+            if (i + 2 < in.size() && in[i] == in[i + 1] && in[i] == in[i + 2]) {
+                break;
+            }
+            i++;
+        }
+        out.push_back((uint8_t) (i - start - 1));
+        out.insert(out.end(), in.begin() + start, in.begin() + i);
+    }
+}
+
+static bool decompress(const uint8_t *in, size_t size, std::vector<uint8_t> &out, size_t expected) {
+    size_t i = 0;
+    while (i < size) {
+        uint8_t control = in[i++];
+        if (control < 128) {
+            size_t count = control + 1u;
+            if (size - i < count || out.size() + count > expected) {
+                return false;
+            }
+            out.insert(out.end(), in + i, in + i + count);
+            i += count;
+        } else {
+            size_t count = control - 125u;
+            if (i == size || out.size() + count > expected) {
+                return false;
+            }
+            out.insert(out.end(), count, in[i++]);
+        }
+    }
+    return out.size() == expected;
+}
+
+std::vector<uint8_t> encodeState(const MachineState &state, bool compress) {
+    std::vector<uint8_t> payload = serialize(state);
+
+    std::vector<uint8_t> out(SAVE_STATE_MAGIC, SAVE_STATE_MAGIC + 4);
+    put(out, SAVE_STATE_VERSION);
+    put(out, compress ? SAVE_STATE_RLE : (uint16_t) 0);
+    put(out, (uint8_t) state.quirks);
+    put(out, (uint8_t) 0);
+    put(out, (uint32_t) payload.size());
+
+    if (compress) {
+        std::vector<uint8_t> packed;
+        ::compress(payload, packed);
+        put(out, (uint32_t) packed.size());
+        out.insert(out.end(), packed.begin(), packed.end());
+    } else {
+        put(out, (uint32_t) payload.size());
+        out.insert(out.end(), payload.begin(), payload.end());
+    }
+    return out;
+}
+
+bool decodeState(const uint8_t *data, size_t size, MachineState &out) {
+    if (size < HEADER_SIZE || memcmp(data, SAVE_STATE_MAGIC, 4) != 0) {
+        return false;
+    }
+
+    uint16_t version, flags;
+    uint8_t quirks, reserved;
+    uint32_t payload_size, stored_size;
+    Reader header(data + 4, HEADER_SIZE - 4);
+    header.get(version);
+    header.get(flags);
+    header.get(quirks);
+    header.get(reserved);
+    header.get(payload_size);
+    header.get(stored_size);
+    if (version != SAVE_STATE_VERSION || (flags & ~SAVE_STATE_RLE) != 0 || quirks >= (uint8_t) QuirkProfile::Count
+        || reserved != 0 || payload_size != PAYLOAD_SIZE || stored_size != size - HEADER_SIZE) {
+        return false;
+    }
+    out.quirks = (QuirkProfile) quirks;
+
+    const uint8_t *stored = data + HEADER_SIZE;
+    if (!(flags & SAVE_STATE_RLE)) {
+        return deserialize(stored, stored_size, out);
+    }
+
+    std::vector<uint8_t> payload;
+    payload.reserve(payload_size);
+    return decompress(stored, stored_size, payload, payload_size)
+           && deserialize(payload.data(), payload.size(), out);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Machine.h"
+
+/*
+ * Save-state files start with an 18 byte header:
+ *   "C8SS" magic, uint16 version, uint16 flags, uint8 quirk profile, uint8 reserved,
+ *   uint32 payload size, uint32 stored size
+ * followed by the stored payload. Without compression the stored payload is the payload itself;
+ * with SAVE_STATE_RLE it is run-length encoded. The payload holds every other field of MachineState,
+ * in declaration order and little-endian, so files are portable between hosts and compilers.
+ */
+
+/**
+ * Header flag: the payload is run-length encoded
+ */
+static const uint16_t SAVE_STATE_RLE = 1;
+
+/**
+ * Serializes a machine state into the save-state file format
+ */
+std::vector<uint8_t> encodeState(const MachineState &state, bool compress);
+
+/**
+ * Parses a save-state file. Returns false if the data is truncated, corrupt, of another version or
+ * of an unknown quirk profile.
+ */
+bool decodeState(const uint8_t *data, size_t size, MachineState &out);
@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <thread>
+#include <utility>
+#include "Scheduler.h"
+
+constexpr uint32_t Scheduler::FRAME_RATE;
+constexpr uint32_t Scheduler::MAX_CATCH_UP;
+
+// sleeping is only accurate to about a scheduler quantum, so the end of every wait is spent yielding
+static const std::chrono::microseconds SPIN_MARGIN(1000);
+
+static Scheduler::Clock::duration framePeriod(double multiplier) {
+    std::chrono::duration<double> period(1.0 / (Scheduler::FRAME_RATE * multiplier));
+    return std::chrono::duration_cast<Scheduler::Clock::duration>(period);
+}
+
+Scheduler::Scheduler(Cpu &cpu) : cpu(cpu), mode(Pacing::RealTime), frame_period(framePeriod(1.0)), frame_count(0),
+                                     input_queue(nullptr) {
+    this->reset();
+}
+
+void Scheduler::setPacing(Pacing pacing, double multiplier) {
+    this->mode = pacing;
+    this->frame_period = framePeriod(pacing == Pacing::Multiplier && multiplier > 0 ? multiplier : 1.0);
+    this->reset();
+}
+
+Pacing Scheduler::pacing() const {
+    return this->mode;
+}
+
+void Scheduler::setInstructionsPerFrame(uint32_t instructions) {
+    this->cpu.setCyclesPerFrame(instructions);
+}
+
+uint64_t Scheduler::frames() const {
+    return this->frame_count;
+}
+
+void Scheduler::reset() {
+    this->next_frame = Clock::now();
+}
+
+void Scheduler::setFrameListener(std::function<void()> listener) {
+    this->frame_listener = std::move(listener);
+}
+
+void Scheduler::setInputQueue(InputQueue *queue, std::function<void(uint8_t key, bool down)> apply) {
+    this->input_queue = queue;
+    this->apply_input = std::move(apply);
+    this->pending_input.clear();
+}
+
+void Scheduler::takeInput() {
+    if (this->input_queue == nullptr) {
+        return;
+    }
+
+    KeyEvent chunk[64];
+    size_t count;
+    while ((count = this->input_queue->drain(chunk, 64)) > 0) {
+        this->pending_input.insert(this->pending_input.end(), chunk, chunk + count);
+    }
+}
+
+State Scheduler::runFrame() {
+    return this->runFrame(Clock::time_point::max());
+}
+
+State Scheduler::runFrame(Clock::time_point end) {
+    this->takeInput();
+
+    uint32_t instructions = this->cpu.cyclesPerFrame();
+    uint64_t first = this->cpu.cycles;
+    uint64_t last = first + instructions;
+    Clock::time_point start = end == Clock::time_point::max() ? end : end - this->frame_period;
+
+    State result = State::Running;
+    size_t applied = 0;
+    for (; applied < this->pending_input.size(); ++applied) {
+        const KeyEvent &event = this->pending_input[applied];
+        if (event.time >= end && end != Clock::time_point::max()) {
+            break;
+        }
+
+        // events are queued in order, so their cycles never go backwards
+        uint64_t cycle = first;
+        if (event.time > start) {
+            cycle += (uint64_t) (event.time - start).count() * instructions / (uint64_t) this->frame_period.count();
+        }
+        if (cycle > this->cpu.cycles) {
+            result = this->cpu.run(std::min(cycle, last) - this->cpu.cycles);
+            if (isFault(result)) {
+                break;
+            }
+        }
+        this->apply_input(event.key, event.down);
+    }
+    this->pending_input.erase(this->pending_input.begin(), this->pending_input.begin() + applied);
+
+    if (!isFault(result) && last > this->cpu.cycles) {
+        result = this->cpu.run(last - this->cpu.cycles);
+    }
+    if (!isFault(result)) {
+        this->frame_count++;
+        if (this->frame_listener) {
+            this->frame_listener();
+        }
+    }
+    return result;
+}
+
+State Scheduler::advance() {
+    State result = State::Running;
+    Clock::time_point now = Clock::now();
+
+    if (this->mode == Pacing::Unthrottled) {
+        Clock::time_point end = now + framePeriod(1.0);
+        do {
+            result = this->runFrame();
+        } while (!isFault(result) && Clock::now() < end);
+        this->next_frame = Clock::now();
+        return result;
+    }
+
+    uint32_t ran = 0;
+    while (this->next_frame <= now && ran < MAX_CATCH_UP) {
+        result = this->runFrame(this->next_frame);
+        if (isFault(result)) {
+            return result;
+        }
+        this->next_frame += this->frame_period;
+        ran++;
+    }
+
+    if (this->next_frame <= now) {
+        // too far behind to catch up; continue from now rather than running a burst of frames
+        this->next_frame = now + this->frame_period;
+    }
+    return result;
+}
+
+void Scheduler::skip() {
+    // events arriving meanwhile are kept, to be applied at the start of the next executed frame
+    this->takeInput();
+    if (this->mode == Pacing::Unthrottled) {
+        return;
+    }
+
+    Clock::time_point now = Clock::now();
+    if (this->next_frame <= now) {
+        this->next_frame = std::max(this->next_frame + this->frame_period, now);
+    }
+}
+
+void Scheduler::wait() {
+    if (this->mode == Pacing::Unthrottled) {
+        return;
+    }
+
+    if (this->next_frame - Clock::now() > SPIN_MARGIN) {
+        std::this_thread::sleep_until(this->next_frame - SPIN_MARGIN);
+    }
+    while (Clock::now() < this->next_frame) {
+        std::this_thread::yield();
+    }
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "Cpu.h"
+#include "InputQueue.h"
+
+enum class Pacing : uint8_t {
+    /**
+     * Emulated time advances at the speed of the host clock
+     */
+    RealTime,
+
+    /**
+     * Emulated time advances at a fixed multiple of the host clock
+     */
+    Multiplier,
+
+    /**
+     * Frames run back to back as fast as the host allows
+     */
+    Unthrottled,
+};
+
+/**
+ * Drives a Cpu in 60 Hz frames of emulated time.
+ *
+ * Every frame executes the cpu's cycles per frame, so the timers tick exactly once per frame.
+ * Frames are paced against std::chrono::steady_clock deadlines rather than fixed sleeps; a frontend
+ * calls advance() to run the frames that are due, presents, then wait()s for the next deadline.
+ */
+class Scheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * Frames of emulated time per second
+     */
+    static constexpr uint32_t FRAME_RATE = 60;
+
+    /**
+     * The most frames advance() runs to catch up after the host stalled; older frames are dropped
+     */
+    static constexpr uint32_t MAX_CATCH_UP = 4;
+
+    explicit Scheduler(Cpu &cpu);
+
+    /**
+     * Selects how frames are paced. The multiplier is only used with Pacing::Multiplier.
+     */
+    void setPacing(Pacing pacing, double multiplier = 1.0);
+    Pacing pacing() const;
+
+    /**
+     * Sets the number of instructions the cpu executes per frame
+     */
+    void setInstructionsPerFrame(uint32_t instructions);
+
+    /**
+     * Sets a function called at the end of every executed frame, e.g. to record rewind history
+     */
+    void setFrameListener(std::function<void()> listener);
+
+    /**
+     * Sets the queue key events come from and the function that applies one, e.g. by forwarding it to
+     * Input. Every frame drains the whole queue. Paced frames apply each event before the instruction
+     * matching its host time within the frame period that ended at the frame's deadline, so events
+     * keep their spacing one frame later; events newer than that wait for the frame they belong to.
+     * Unpaced frames apply every queued event before their first instruction.
+     */
+    void setInputQueue(InputQueue *queue, std::function<void(uint8_t key, bool down)> apply);
+
+    /**
+     * Executes one frame of emulated time, regardless of pacing
+     */
+    State runFrame();
+
+    /**
+     * Executes every frame that is due by the host clock. Unthrottled, executes frames for one
+     * host frame period instead. Stops early at the first fault.
+     */
+    State advance();
+
+    /**
+     * Consumes a due frame without executing it, so callers doing something else in place of
+     * emulation, such as rewinding, keep the same pace. Does nothing when unthrottled. Queued key events
+     * are still drained, and applied at the start of the next executed frame.
+     */
+    void skip();
+
+    /**
+     * Blocks until the next frame is due. Returns immediately when unthrottled.
+     */
+    void wait();
+
+    /**
+     * Restarts pacing from the current time, e.g. after the emulator was paused
+     */
+    void reset();
+
+    /**
+     * The number of frames executed so far
+     */
+    uint64_t frames() const;
+
+private:
+    Cpu &cpu;
+    Pacing mode;
+    Clock::duration frame_period;
+    Clock::time_point next_frame;
+    uint64_t frame_count;
+    std::function<void()> frame_listener;
+
+    InputQueue *input_queue;
+    std::function<void(uint8_t key, bool down)> apply_input;
+
+    /**
+     * Events taken from the queue that belong to a later frame, oldest first
+     */
+    std::vector<KeyEvent> pending_input;
+
+    /**
+     * Executes one frame, applying the events from before end at their cycles
+     */
+    State runFrame(Clock::time_point end);
+
+    /**
+     * Moves every queued event to pending_input
+     */
+    void takeInput();
+};
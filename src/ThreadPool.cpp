@@ -0,0 +1,125 @@
+#include "ThreadPool.h"
+
+/**
+ * Index of the pool worker running on this thread, or -1 on other threads
+ */
+static thread_local int current_worker = -1;
+static thread_local const ThreadPool *current_pool = nullptr;
+
+ThreadPool::ThreadPool(unsigned threads) : pending(0), next_worker(0), stopping(false) {
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    if (threads == 0) {
+        threads = 1;
+    }
+
+    for (unsigned i = 0; i < threads; ++i) {
+        this->workers.emplace_back(new Worker());
+    }
+    for (unsigned i = 0; i < threads; ++i) {
+        this->threads.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    this->wait();
+    {
+        std::lock_guard<std::mutex> lock(this->state_mutex);
+        this->stopping = true;
+    }
+    this->work_available.notify_all();
+    for (auto &thread : this->threads) {
+        thread.join();
+    }
+}
+
+unsigned ThreadPool::size() const {
+    return (unsigned) this->workers.size();
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    unsigned index;
+    if (current_pool == this) {
+        index = (unsigned) current_worker;
+    } else {
+        index = this->next_worker++ % this->size();
+    }
+
+    this->pending++;
+    {
+        std::lock_guard<std::mutex> lock(this->workers[index]->mutex);
+        this->workers[index]->tasks.push_back(std::move(task));
+    }
+    {
+        // taken so a worker cannot miss the notification between checking for work and sleeping
+        std::lock_guard<std::mutex> lock(this->state_mutex);
+    }
+    this->work_available.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(this->state_mutex);
+    this->all_done.wait(lock, [this] { return this->pending == 0; });
+}
+
+bool ThreadPool::take(unsigned index, std::function<void()> &task) {
+    {
+        Worker &own = *this->workers[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+
+    for (unsigned offset = 1; offset < this->size(); ++offset) {
+        Worker &victim = *this->workers[(index + offset) % this->size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::workerLoop(unsigned index) {
+    current_worker = (int) index;
+    current_pool = this;
+
+    std::function<void()> task;
+    while (true) {
+        if (this->take(index, task)) {
+            task();
+            task = nullptr;
+
+            if (--this->pending == 0) {
+                std::lock_guard<std::mutex> lock(this->state_mutex);
+                this->all_done.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(this->state_mutex);
+        if (this->stopping) {
+            return;
+        }
+        // recheck under the lock: pending counts queued tasks as well as running ones
+        this->work_available.wait(lock, [this] {
+            if (this->stopping) {
+                return true;
+            }
+            for (auto &worker : this->workers) {
+                std::lock_guard<std::mutex> worker_lock(worker->mutex);
+                if (!worker->tasks.empty()) {
+                    return true;
+                }
+            }
+            return false;
+        });
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * A fixed-size work-stealing thread pool.
+ *
+ * Every worker owns a deque of tasks. Workers take tasks from the back of their own deque and,
+ * once it is empty, steal from the front of the others, so uneven tasks still keep every core busy.
+ */
+class ThreadPool {
+public:
+    /**
+     * Starts the given number of workers; 0 uses one worker per hardware thread
+     */
+    explicit ThreadPool(unsigned threads = 0);
+
+    /**
+     * Finishes all queued tasks, then stops the workers
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    /**
+     * Queues a task. Tasks submitted from a worker go to that worker's own deque.
+     */
+    void submit(std::function<void()> task);
+
+    /**
+     * Blocks until every submitted task has completed
+     */
+    void wait();
+
+    unsigned size() const;
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+
+    /**
+     * Submitted tasks that have not finished running yet
+     */
+    std::atomic<size_t> pending;
+
+    /**
+     * Round-robin counter for tasks submitted from outside the pool
+     */
+    std::atomic<unsigned> next_worker;
+
+    std::mutex state_mutex;
+    std::condition_variable work_available;
+    std::condition_variable all_done;
+    bool stopping;
+
+    void workerLoop(unsigned index);
+    bool take(unsigned index, std::function<void()> &task);
+};
@@ -0,0 +1,56 @@
+#include <algorithm>
+#include <cstring>
+#include "Trace.h"
+
+static const char TRACE_MAGIC[4] = {'C', '8', 'T', 'R'};
+static const uint16_t TRACE_VERSION = 1;
+
+TraceBuffer::TraceBuffer(size_t capacity) : head(0), tail(0), dropped_records(0) {
+    this->capacity = 1;
+    while (this->capacity < capacity) {
+        this->capacity <<= 1u;
+    }
+    this->records.reset(new TraceRecord[this->capacity]);
+}
+
+size_t TraceBuffer::drain(TraceRecord *out, size_t max) {
+    size_t tail = this->tail.load(std::memory_order_relaxed);
+    size_t available = this->head.load(std::memory_order_acquire) - tail;
+    size_t count = std::min(available, max);
+
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = this->records[(tail + i) & (this->capacity - 1)];
+    }
+
+    this->tail.store(tail + count, std::memory_order_release);
+    return count;
+}
+
+bool TraceBuffer::write(FILE *file) {
+    TraceRecord chunk[256];
+    size_t count;
+    while ((count = this->drain(chunk, 256)) > 0) {
+        if (fwrite(chunk, sizeof(TraceRecord), count, file) != count) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TraceBuffer::writeHeader(FILE *file) {
+    uint16_t fields[2] = {TRACE_VERSION, sizeof(TraceRecord)};
+    return fwrite(TRACE_MAGIC, 1, 4, file) == 4 && fwrite(fields, sizeof(uint16_t), 2, file) == 2;
+}
+
+bool TraceBuffer::readHeader(FILE *file) {
+    char magic[4];
+    uint16_t fields[2];
+    if (fread(magic, 1, 4, file) != 4 || fread(fields, sizeof(uint16_t), 2, file) != 2) {
+        return false;
+    }
+    return memcmp(magic, TRACE_MAGIC, 4) == 0 && fields[0] == TRACE_VERSION && fields[1] == sizeof(TraceRecord);
+}
+
+uint64_t TraceBuffer::dropped() const {
+    return this->dropped_records.load(std::memory_order_relaxed);
+}
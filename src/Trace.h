@@ -0,0 +1,128 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+
+/*
+ * Compile-time trace levels. Set CHIP8_TRACE_LEVEL when configuring; trace points above the
+ * configured level compile to nothing.
+ */
+#define CHIP8_TRACE_NONE 0
+#define CHIP8_TRACE_EVENTS 1
+#define CHIP8_TRACE_INSTRUCTIONS 2
+
+#ifndef CHIP8_TRACE_LEVEL
+#define CHIP8_TRACE_LEVEL CHIP8_TRACE_NONE
+#endif
+
+#if CHIP8_TRACE_LEVEL >= CHIP8_TRACE_EVENTS
+#define CHIP8_TRACE_EVENT(cpu, kind, addr, detail) (cpu).trace((kind), (addr), (detail))
+#else
+#define CHIP8_TRACE_EVENT(cpu, kind, addr, detail) ((void) 0)
+#endif
+
+#if CHIP8_TRACE_LEVEL >= CHIP8_TRACE_INSTRUCTIONS
+#define CHIP8_TRACE_INSTRUCTION(cpu) (cpu).trace(TraceKind::Instruction, (cpu).pc, 0)
+#else
+#define CHIP8_TRACE_INSTRUCTION(cpu) ((void) 0)
+#endif
+
+enum class TraceKind : uint8_t {
+    /**
+     * An instruction about to be executed
+     */
+    Instruction,
+
+    /**
+     * An opcode the interpreter does not implement was skipped
+     */
+    UnknownOpcode,
+
+    /**
+     * The cpu faulted; detail holds the State
+     */
+    Fault,
+};
+
+/**
+ * A fixed-size trace record: the cpu state before the traced instruction executed
+ */
+struct TraceRecord {
+    uint64_t cycle;
+    uint16_t pc;
+    uint16_t opcode;
+    uint16_t instruction_register;
+    uint8_t kind;
+    uint8_t detail;
+    uint8_t data_registers[16];
+};
+
+static_assert(sizeof(TraceRecord) == 32, "trace records are written to disk as-is");
+
+/**
+ * Lock-free single-producer single-consumer ring of trace records.
+ *
+ * The emulating thread pushes records and never blocks: when the ring is full the record is dropped
+ * and counted. Another thread (or the same one, between frames) drains records, usually into a
+ * trace dump with writeHeader() and write().
+ */
+class TraceBuffer {
+public:
+    /**
+     * Creates a ring holding capacity records, rounded up to a power of two
+     */
+    explicit TraceBuffer(size_t capacity = 1u << 16u);
+
+    TraceBuffer(const TraceBuffer &) = delete;
+    TraceBuffer &operator=(const TraceBuffer &) = delete;
+
+    /**
+     * Appends a record; called by the producer only
+     */
+    void push(const TraceRecord &record) {
+        size_t head = this->head.load(std::memory_order_relaxed);
+        if (head - this->tail.load(std::memory_order_acquire) == this->capacity) {
+            this->dropped_records.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        this->records[head & (this->capacity - 1)] = record;
+        this->head.store(head + 1, std::memory_order_release);
+    }
+
+    /**
+     * Moves up to max records into out, oldest first; called by the consumer only.
+     * Returns the number of records moved.
+     */
+    size_t drain(TraceRecord *out, size_t max);
+
+    /**
+     * Drains every available record into a trace dump file; called by the consumer only.
+     * Returns false if writing failed.
+     */
+    bool write(FILE *file);
+
+    /**
+     * Writes the header that starts a trace dump file
+     */
+    static bool writeHeader(FILE *file);
+
+    /**
+     * Reads and checks the header of a trace dump file
+     */
+    static bool readHeader(FILE *file);
+
+    /**
+     * The number of records dropped because the ring was full
+     */
+    uint64_t dropped() const;
+
+private:
+    size_t capacity;
+    std::unique_ptr<TraceRecord[]> records;
+    std::atomic<size_t> head;
+    std::atomic<size_t> tail;
+    std::atomic<uint64_t> dropped_records;
+};
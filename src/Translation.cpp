@@ -0,0 +1,60 @@
+#include <algorithm>
+#include "Translation.h"
+
+static const uint16_t ROM_START = 0x200;
+static const size_t ADDRESS_SPACE = 4096;
+
+Translation::Translation(const uint8_t *rom, size_t size, const TranslatedBlock *blocks, size_t count,
+                         QuirkProfile quirks) :
+        rom(rom, rom + std::min(size, ADDRESS_SPACE - ROM_START)), by_start(ADDRESS_SPACE, nullptr),
+        enabled(ADDRESS_SPACE, 0), max_span(0), profile(quirks) {
+    for (size_t i = 0; i < count; ++i) {
+        const TranslatedBlock &block = blocks[i];
+        // a block has to lie within the ROM, which is the only code validate() can check it against
+        if (block.start < ROM_START || block.end <= block.start || block.end > ROM_START + this->rom.size()) {
+            continue;
+        }
+        this->by_start[block.start] = &block;
+        this->max_span = std::max<uint16_t>(this->max_span, (uint16_t) (block.end - block.start));
+    }
+}
+
+void Translation::invalidate(uint16_t addr) {
+    if (addr >= ADDRESS_SPACE) {
+        return;
+    }
+    uint16_t first = addr >= this->max_span ? (uint16_t) (addr - this->max_span + 1) : (uint16_t) 0;
+    for (uint16_t start = first; start <= addr; ++start) {
+        const TranslatedBlock *block = this->by_start[start];
+        if (block != nullptr && block->end > addr) {
+            this->enabled[start] = 0;
+        }
+    }
+}
+
+size_t Translation::validate(const Memory &memory) {
+    size_t count = 0;
+    for (size_t start = ROM_START; start < ADDRESS_SPACE; ++start) {
+        const TranslatedBlock *block = this->by_start[start];
+        if (block == nullptr) {
+            continue;
+        }
+        bool matches = true;
+        for (uint16_t addr = block->start; addr < block->end && matches; ++addr) {
+            matches = memory.read(addr) == this->rom[addr - ROM_START];
+        }
+        this->enabled[start] = matches ? 1 : 0;
+        count += matches ? 1 : 0;
+    }
+    return count;
+}
+
+size_t Translation::size() const {
+    return (size_t) std::count_if(this->by_start.begin(), this->by_start.end(), [](const TranslatedBlock *block) {
+        return block != nullptr;
+    });
+}
+
+QuirkProfile Translation::quirks() const {
+    return this->profile;
+}
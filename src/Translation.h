@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Memory.h"
+#include "Quirks.h"
+
+/**
+ * A basic block translated ahead of time into a native function, see Translator.h
+ */
+struct TranslatedBlock {
+    uint16_t start;
+
+    /**
+     * One past the last byte of CHIP-8 code covered by the block
+     */
+    uint16_t end;
+
+    /**
+     * The number of CHIP-8 instructions executed by one call of fn
+     */
+    uint16_t length;
+
+    /**
+     * Receives V0-VF and I, returns the next pc; the same signature as Jit::BlockFn
+     */
+    uint16_t (*fn)(uint8_t *data_registers, uint16_t *instruction_register);
+};
+
+/**
+ * The blocks of one ROM translated ahead of time, as looked up by Cpu::run().
+ *
+ * A block is only used while the memory it was translated from still holds the same bytes: writes
+ * into a block disable it and restoring memory checks every block again, so self-modifying code the
+ * translator did not see coming falls back to the interpreter.
+ */
+class Translation {
+public:
+    /**
+     * Takes the ROM the blocks were translated from, as loaded at 0x200, the blocks, which have to
+     * outlive the Translation, and the quirk profile they were translated for. Blocks start disabled
+     * until validate() finds the ROM in memory.
+     */
+    Translation(const uint8_t *rom, size_t size, const TranslatedBlock *blocks, size_t count,
+                QuirkProfile quirks = QuirkProfile::Modern);
+
+    /**
+     * Returns the enabled block starting at addr, or nullptr if there is none
+     */
+    const TranslatedBlock *lookup(uint16_t addr) const {
+        return addr < 4096 && this->enabled[addr] ? this->by_start[addr] : nullptr;
+    }
+
+    /**
+     * Disables every block covering addr
+     */
+    void invalidate(uint16_t addr);
+
+    /**
+     * Enables exactly the blocks whose code in memory matches the ROM, returning how many are enabled
+     */
+    size_t validate(const Memory &memory);
+
+    size_t size() const;
+
+    QuirkProfile quirks() const;
+
+private:
+    std::vector<uint8_t> rom;
+    std::vector<const TranslatedBlock *> by_start;
+    std::vector<uint8_t> enabled;
+
+    /**
+     * The length in bytes of the longest block, bounding the starts invalidate() has to look at
+     */
+    uint16_t max_span;
+
+    QuirkProfile profile;
+};
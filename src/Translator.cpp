@@ -0,0 +1,374 @@
+#include <algorithm>
+#include "Translator.h"
+
+static const uint16_t ROM_START = 0x200;
+static const size_t ADDRESS_SPACE = 4096;
+
+// the driver compiled into every translated ROM, after the ROM and the block table
+static const char DRIVER[] = R"driver(
+static const size_t BLOCK_COUNT = sizeof(BLOCKS) / sizeof(BLOCKS[0]);
+
+static State runFor(Machine &machine, uint64_t cycles, double &seconds) {
+    auto start = std::chrono::steady_clock::now();
+    State state = machine.cpu.run(cycles);
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return state;
+}
+
+int main(int argc, char **argv) {
+    uint64_t cycles = 600000;
+    uint32_t seed = 1;
+    uint32_t cycles_per_frame = Cpu::DEFAULT_CYCLES_PER_FRAME;
+    bool verify = false;
+    for (int i = 1; i < argc; ++i) {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "-c") == 0 && has_value) {
+            cycles = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--seed") == 0 && has_value) {
+            seed = (uint32_t) strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--cpf") == 0 && has_value) {
+            cycles_per_frame = (uint32_t) strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--verify") == 0) {
+            verify = true;
+        } else {
+            printf("Usage: %s [-c cycles] [--seed seed] [--cpf cycles-per-frame] [--verify]\n"
+                   "  -c        instructions to run (default: 600000)\n"
+                   "  --seed    random number generator seed (default: 1)\n"
+                   "  --cpf     instructions per 60 Hz frame\n"
+                   "  --verify  also run the interpreter and fail unless both end in the same state\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::unique_ptr<Machine> machine(new Machine());
+    machine->loadRom(ROM, sizeof(ROM));
+    machine->cpu.seed(seed);
+    machine->cpu.setCyclesPerFrame(cycles_per_frame);
+    machine->cpu.setQuirks(QUIRKS);
+    Translation translation(ROM, sizeof(ROM), BLOCKS, BLOCK_COUNT, QUIRKS);
+    machine->cpu.setTranslation(&translation);
+
+    double seconds;
+    State state = runFor(*machine, cycles, seconds);
+    uint64_t hash = machine->stateHash();
+    printf("translated:  %016" PRIx64 " after %" PRIu64 " cycles in %.3f s%s\n", hash, machine->cpu.cycles,
+           seconds, isFault(state) ? " (faulted)" : "");
+    if (!verify) {
+        return isFault(state) ? 1 : 0;
+    }
+
+    std::unique_ptr<Machine> reference(new Machine());
+    reference->loadRom(ROM, sizeof(ROM));
+    reference->cpu.seed(seed);
+    reference->cpu.setCyclesPerFrame(cycles_per_frame);
+    reference->cpu.setQuirks(QUIRKS);
+    State expected = runFor(*reference, cycles, seconds);
+    uint64_t expected_hash = reference->stateHash();
+    printf("interpreted: %016" PRIx64 " after %" PRIu64 " cycles in %.3f s%s\n", expected_hash,
+           reference->cpu.cycles, seconds, isFault(expected) ? " (faulted)" : "");
+    return hash == expected_hash && state == expected ? 0 : 1;
+}
+)driver";
+
+uint16_t Translator::opcode(uint16_t addr) const {
+    return (uint16_t) ((this->rom[addr - ROM_START] << 8u) | this->rom[addr + 1 - ROM_START]);
+}
+
+bool Translator::isTranslatable(const Instruction &inst) {
+    switch (inst.op) {
+        case Op::JP:
+        case Op::SE_VX_NN:
+        case Op::SNE_VX_NN:
+        case Op::SE_VX_VY:
+        case Op::SNE_VX_VY:
+        case Op::LD_VX_NN:
+        case Op::ADD_VX_NN:
+        case Op::LD_VX_VY:
+        case Op::OR:
+        case Op::AND:
+        case Op::XOR:
+        case Op::ADD_VX_VY:
+        case Op::SUB:
+        case Op::SHR:
+        case Op::SUBN:
+        case Op::SHL:
+        case Op::LD_I:
+        case Op::ADD_I_VX:
+        case Op::LD_F_VX:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool Translator::translate(const uint8_t *rom, size_t size, QuirkProfile quirks) {
+    this->translated.clear();
+    this->skipped.clear();
+    this->profile = quirks;
+    if (size == 0 || !this->rom_analysis.analyze(rom, size)) {
+        this->rom.clear();
+        return false;
+    }
+    this->rom.assign(rom, rom + size);
+
+    std::vector<bool> modified(ADDRESS_SPACE, false);
+    for (auto &write : this->rom_analysis.selfModifyingWrites()) {
+        for (size_t addr = write.target; addr < write.target + write.length && addr < ADDRESS_SPACE; ++addr) {
+            modified[addr] = true;
+        }
+    }
+
+    for (auto &block : this->rom_analysis.blocks()) {
+        if (std::any_of(modified.begin() + block.start, modified.begin() + block.end, [](bool m) { return m; })) {
+            this->skipped.push_back(block);
+            continue;
+        }
+
+        // basic blocks end with their only jump or skip; within one, a translated block runs up to the
+        // next instruction that is not translatable, which the interpreter steps over before the next
+        // translated block takes over
+        TranslatedBlock current{0, 0, 0, nullptr};
+        for (uint16_t pc = block.start; pc < block.end; pc += 2) {
+            Instruction inst = decode(this->opcode(pc));
+            if (!isTranslatable(inst)) {
+                if (current.length > 0) {
+                    this->translated.push_back(current);
+                    current.length = 0;
+                }
+                continue;
+            }
+            if (current.length == 0) {
+                current.start = pc;
+            }
+            current.end = (uint16_t) (pc + 2);
+            current.length++;
+        }
+        if (current.length > 0) {
+            this->translated.push_back(current);
+        }
+    }
+    return true;
+}
+
+const std::vector<TranslatedBlock> &Translator::blocks() const {
+    return this->translated;
+}
+
+const std::vector<BasicBlock> &Translator::skippedBlocks() const {
+    return this->skipped;
+}
+
+const Analysis &Translator::analysis() const {
+    return this->rom_analysis;
+}
+
+bool Translator::writeBlock(FILE *file, const TranslatedBlock &block) const {
+    // registers used and written, as bit masks over V0-VF, with bit 16 standing for I
+    const uint32_t I = 1u << 16u;
+    const bool shift_vy = quirkFlags(this->profile).shift_vy;
+    uint32_t used = 0, written = 0;
+    for (uint16_t pc = block.start; pc < block.end; pc += 2) {
+        Instruction inst = decode(this->opcode(pc));
+        uint32_t x = 1u << inst.x, y = 1u << inst.y, f = 1u << 0xFu;
+        switch (inst.op) {
+            case Op::LD_VX_NN:
+                written |= x;
+                break;
+            case Op::ADD_VX_NN:
+                used |= x;
+                written |= x;
+                break;
+            case Op::LD_VX_VY:
+                used |= y;
+                written |= x;
+                break;
+            case Op::OR:
+            case Op::AND:
+            case Op::XOR:
+                used |= x | y;
+                written |= x;
+                break;
+            case Op::ADD_VX_VY:
+            case Op::SUB:
+            case Op::SUBN:
+                used |= x | y;
+                written |= x | f;
+                break;
+            case Op::SHR:
+            case Op::SHL:
+                used |= shift_vy ? y : x;
+                written |= x | f;
+                break;
+            case Op::LD_I:
+                written |= I;
+                break;
+            case Op::ADD_I_VX:
+                used |= x | I;
+                written |= I;
+                break;
+            case Op::LD_F_VX:
+                used |= x;
+                written |= I;
+                break;
+            case Op::SE_VX_NN:
+            case Op::SNE_VX_NN:
+                used |= x;
+                break;
+            case Op::SE_VX_VY:
+            case Op::SNE_VX_VY:
+                used |= inst.x != inst.y ? x | y : 0;
+                break;
+            default:
+                break;
+        }
+    }
+    used |= written;
+
+    // parameters the block does not touch stay unnamed
+    bool ok = fprintf(file, "\nstatic uint16_t block_%03X(uint8_t *%s, uint16_t *%s) {\n", block.start,
+                      (used & ~I) != 0 ? "v" : "", (used & I) != 0 ? "i" : "") > 0;
+    for (unsigned r = 0; r < 16; ++r) {
+        if (used & (1u << r)) {
+            ok &= fprintf(file, "    uint8_t v%X = v[0x%X];\n", r, r) > 0;
+        }
+    }
+    if (used & I) {
+        ok &= fprintf(file, "    uint16_t ir = *i;\n") > 0;
+    }
+
+    // every statement mirrors the interpreter's handler, including the order VF is written in
+    char text[32];
+    const char *result = nullptr;
+    char next[64];
+    uint16_t pc = block.start;
+    for (; pc < block.end; pc += 2) {
+        Instruction inst = decode(this->opcode(pc));
+        unsigned x = inst.x, y = inst.y, nn = inst.nn, nnn = inst.nnn;
+        disassemble(this->opcode(pc), text, sizeof(text));
+        ok &= fprintf(file, "    // %03X  %s\n", pc, text) > 0;
+        switch (inst.op) {
+            case Op::LD_VX_NN:
+                ok &= fprintf(file, "    v%X = 0x%02X;\n", x, nn) > 0;
+                break;
+            case Op::ADD_VX_NN:
+                ok &= fprintf(file, "    v%X += 0x%02X;\n", x, nn) > 0;
+                break;
+            case Op::LD_VX_VY:
+                ok &= fprintf(file, "    v%X = v%X;\n", x, y) > 0;
+                break;
+            case Op::OR:
+                ok &= fprintf(file, "    v%X |= v%X;\n", x, y) > 0;
+                break;
+            case Op::AND:
+                ok &= fprintf(file, "    v%X &= v%X;\n", x, y) > 0;
+                break;
+            case Op::XOR:
+                ok &= fprintf(file, "    v%X ^= v%X;\n", x, y) > 0;
+                break;
+            case Op::ADD_VX_VY:
+                ok &= fprintf(file, "    vF = (uint8_t) (v%X + v%X > 0xFF);\n    v%X += v%X;\n", x, y, x, y) > 0;
+                break;
+            case Op::SUB:
+                // a register always equals itself, which compilers warn about comparing
+                ok &= (x == y ? fprintf(file, "    vF = 1;\n")
+                              : fprintf(file, "    vF = (uint8_t) (v%X >= v%X);\n", x, y)) > 0;
+                ok &= fprintf(file, "    v%X -= v%X;\n", x, y) > 0;
+                break;
+            case Op::SHR:
+                ok &= fprintf(file, "    {\n        uint8_t shifted = v%X;\n        v%X = (uint8_t) (shifted >> 1u);\n"
+                                    "        vF = (uint8_t) (shifted & 1u);\n    }\n", shift_vy ? y : x, x) > 0;
+                break;
+            case Op::SUBN:
+                ok &= (x == y ? fprintf(file, "    vF = 1;\n")
+                              : fprintf(file, "    vF = (uint8_t) (v%X >= v%X);\n", y, x)) > 0;
+                ok &= fprintf(file, "    v%X = (uint8_t) (v%X - v%X);\n", x, y, x) > 0;
+                break;
+            case Op::SHL:
+                ok &= fprintf(file, "    {\n        uint8_t shifted = v%X;\n        v%X = (uint8_t) (shifted << 1u);\n"
+                                    "        vF = (uint8_t) (shifted >> 7u);\n    }\n", shift_vy ? y : x, x) > 0;
+                break;
+            case Op::LD_I:
+                ok &= fprintf(file, "    ir = 0x%03X;\n", nnn) > 0;
+                break;
+            case Op::ADD_I_VX:
+                ok &= fprintf(file, "    ir += v%X;\n", x) > 0;
+                break;
+            case Op::LD_F_VX:
+                ok &= fprintf(file, "    ir = (uint16_t) ((v%X & 0xFu) * 5u);\n", x) > 0;
+                break;
+            case Op::JP:
+                snprintf(next, sizeof(next), "0x%03X", nnn);
+                result = next;
+                break;
+            case Op::SE_VX_NN:
+            case Op::SNE_VX_NN:
+                snprintf(next, sizeof(next), "v%X %s 0x%02X ? 0x%03X : 0x%03X", x,
+                         inst.op == Op::SE_VX_NN ? "==" : "!=", nn, pc + 4, pc + 2);
+                result = next;
+                break;
+            case Op::SE_VX_VY:
+            case Op::SNE_VX_VY:
+                if (x == y) {
+                    snprintf(next, sizeof(next), "0x%03X", inst.op == Op::SE_VX_VY ? pc + 4 : pc + 2);
+                } else {
+                    snprintf(next, sizeof(next), "v%X %s v%X ? 0x%03X : 0x%03X", x,
+                             inst.op == Op::SE_VX_VY ? "==" : "!=", y, pc + 4, pc + 2);
+                }
+                result = next;
+                break;
+            default:
+                break;
+        }
+    }
+    if (result == nullptr) {
+        snprintf(next, sizeof(next), "0x%03X", pc);
+        result = next;
+    }
+
+    for (unsigned r = 0; r < 16; ++r) {
+        if (written & (1u << r)) {
+            ok &= fprintf(file, "    v[0x%X] = v%X;\n", r, r) > 0;
+        }
+    }
+    if (written & I) {
+        ok &= fprintf(file, "    *i = ir;\n") > 0;
+    }
+    ok &= fprintf(file, "    return %s;\n}\n", result) > 0;
+    return ok;
+}
+
+bool Translator::write(FILE *file, const char *name) const {
+    if (this->rom.empty()) {
+        return false;
+    }
+    bool ok = fprintf(file, "// Translated ahead of time from %s; do not edit\n", name) > 0;
+    ok &= fprintf(file, "// %zu blocks translated, %zu left to the interpreter as they may be modified\n",
+                  this->translated.size(), this->skipped.size()) > 0;
+    ok &= fprintf(file, "#include <chrono>\n#include <cinttypes>\n#include <cstdio>\n#include <cstdlib>\n"
+                        "#include <cstring>\n#include <memory>\n#include \"Machine.h\"\n#include \"Translation.h\"\n") > 0;
+
+    ok &= fprintf(file, "\nstatic const uint8_t ROM[] = {") > 0;
+    for (size_t i = 0; i < this->rom.size(); ++i) {
+        ok &= fprintf(file, "%s0x%02X,", i % 16 == 0 ? "\n    " : " ", this->rom[i]) > 0;
+    }
+    ok &= fprintf(file, "\n};\n") > 0;
+
+    for (auto &block : this->translated) {
+        ok &= this->writeBlock(file, block);
+    }
+
+    ok &= fprintf(file, "\nstatic const TranslatedBlock BLOCKS[] = {\n") > 0;
+    for (auto &block : this->translated) {
+        ok &= fprintf(file, "    {0x%03X, 0x%03X, %u, &block_%03X},\n", block.start, block.end, block.length,
+                      block.start) > 0;
+    }
+    if (this->translated.empty()) {
+        // an array cannot be empty; a block outside the ROM is ignored by Translation
+        ok &= fprintf(file, "    {0, 0, 0, nullptr},\n") > 0;
+    }
+    ok &= fprintf(file, "};\n") > 0;
+    ok &= fprintf(file, "\nstatic const QuirkProfile QUIRKS = (QuirkProfile) %u; // %s\n", (unsigned) this->profile,
+                  quirkProfileName(this->profile)) > 0;
+    ok &= fputs(DRIVER, file) != EOF;
+    return ok;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include "Analyzer.h"
+#include "Translation.h"
+
+/**
+ * Ahead-of-time recompiler turning a ROM into C++ source for a dedicated executable.
+ *
+ * The basic blocks found by Analysis are translated into one function each, holding the registers
+ * they use in locals. Like the Jit, a function covers straight-line ALU, register and I instructions
+ * up to a jump or skip; everything else (calls, returns, BNNN, drawing, timers, input, memory
+ * transfers) is left to Cpu::step(), and a new function starts after it. Blocks that a reachable
+ * FX33 or FX55 writes into are not translated, and code only reached through BNNN is never seen,
+ * so both run in the interpreter. Writes the analysis cannot see are caught at run time by Translation.
+ *
+ * The generated source defines the ROM and a main() that runs it under the quirk profile it was
+ * translated for with the translated blocks attached, printing the state hash; with --verify it also runs the interpreter and compares the hashes.
+ */
+class Translator {
+public:
+    /**
+     * Translates a ROM to run under a quirk profile, replacing any previous results.
+     * Returns false, leaving nothing translated, if it is empty or does not fit between 0x200 and 0xFFF.
+     */
+    bool translate(const uint8_t *rom, size_t size, QuirkProfile quirks = QuirkProfile::Modern);
+
+    /**
+     * The blocks that will be written, ordered by start address; fn is not set
+     */
+    const std::vector<TranslatedBlock> &blocks() const;
+
+    /**
+     * Basic blocks left to the interpreter because they may be modified
+     */
+    const std::vector<BasicBlock> &skippedBlocks() const;
+
+    const Analysis &analysis() const;
+
+    /**
+     * Writes the generated C++ source; name is only mentioned in comments.
+     * Returns false if nothing was translated or the file could not be written.
+     */
+    bool write(FILE *file, const char *name) const;
+
+private:
+    Analysis rom_analysis;
+    std::vector<uint8_t> rom;
+    std::vector<TranslatedBlock> translated;
+    std::vector<BasicBlock> skipped;
+    QuirkProfile profile = QuirkProfile::Modern;
+
+    uint16_t opcode(uint16_t addr) const;
+
+    /**
+     * Returns true if inst can be part of a translated block
+     */
+    static bool isTranslatable(const Instruction &inst);
+
+    bool writeBlock(FILE *file, const TranslatedBlock &block) const;
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * Hands values from one producer thread to one consumer thread without either ever waiting.
+ *
+ * Of the three slots, the producer owns one to write into and the consumer owns one to read from.
+ * The third is the hand-off: publish() swaps the written slot into it and acquire() swaps it out again,
+ * each with a single atomic exchange. The consumer always reads the newest published value; values
+ * published faster than they are acquired are dropped, and acquiring with nothing new keeps the
+ * previous value, counted as a repeat.
+ */
+template<typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : slots(), back(0), front(1), middle(2), dropped_count(0), repeated_count(0) {}
+
+    TripleBuffer(const TripleBuffer &) = delete;
+    TripleBuffer &operator=(const TripleBuffer &) = delete;
+
+    /**
+     * The slot to fill before the next publish(); producer only. It holds whatever was
+     * published two or more publishes ago, not the last value written.
+     */
+    T &write() {
+        return this->slots[this->back];
+    }
+
+    /**
+     * Makes the written slot the newest value; producer only
+     */
+    void publish() {
+        uint8_t previous = this->middle.exchange((uint8_t) (this->back | FRESH), std::memory_order_acq_rel);
+        if (previous & FRESH) {
+            this->dropped_count.fetch_add(1, std::memory_order_relaxed);
+        }
+        this->back = (uint8_t) (previous & INDEX);
+    }
+
+    /**
+     * Takes the newest value, if one was published since the last acquire(); consumer only.
+     * Returns false, leaving read() as it was, if nothing new was published.
+     */
+    bool acquire() {
+        if (!(this->middle.load(std::memory_order_relaxed) & FRESH)) {
+            this->repeated_count.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        uint8_t previous = this->middle.exchange(this->front, std::memory_order_acq_rel);
+        this->front = (uint8_t) (previous & INDEX);
+        return true;
+    }
+
+    /**
+     * The value taken by the last successful acquire(); consumer only
+     */
+    const T &read() const {
+        return this->slots[this->front];
+    }
+
+    /**
+     * Values replaced by a newer one before they were acquired
+     */
+    uint64_t dropped() const {
+        return this->dropped_count.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Calls to acquire() that found nothing new
+     */
+    uint64_t repeated() const {
+        return this->repeated_count.load(std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr uint8_t INDEX = 0x3;
+
+    /**
+     * Set in middle while it holds a value the consumer has not acquired yet
+     */
+    static constexpr uint8_t FRESH = 0x4;
+
+    T slots[3];
+    uint8_t back;
+    uint8_t front;
+    std::atomic<uint8_t> middle;
+
+    std::atomic<uint64_t> dropped_count;
+    std::atomic<uint64_t> repeated_count;
+};
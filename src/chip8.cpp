@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <vector>
+#include "chip8.h"
+#include "Machine.h"
+#include "ThreadPool.h"
+
+static_assert((int) State::Running == CHIP8_RUNNING && (int) State::WaitingForKey == CHIP8_WAITING_FOR_KEY
+              && (int) State::PcOutOfBounds == CHIP8_PC_OUT_OF_BOUNDS
+              && (int) State::StackOverflow == CHIP8_STACK_OVERFLOW
+              && (int) State::StackUnderflow == CHIP8_STACK_UNDERFLOW, "chip8_state mirrors State");
+static_assert((int) QuirkProfile::CosmacVip == CHIP8_QUIRKS_VIP && (int) QuirkProfile::SuperChip == CHIP8_QUIRKS_SCHIP
+              && (int) QuirkProfile::Modern == CHIP8_QUIRKS_MODERN, "chip8_quirks mirrors QuirkProfile");
+
+struct chip8 {
+    Machine machine;
+
+    /**
+     * The machine as constructed, before any program was loaded, which reset() starts over from
+     */
+    MachineState start;
+
+    std::vector<uint8_t> rom;
+    uint32_t seed;
+
+    /**
+     * Where the quirk profile of a loaded program is looked up; shared by the instances of a pool
+     */
+    std::shared_ptr<const QuirkDatabase> quirks_db;
+
+    uint32_t cycles_per_frame = Cpu::DEFAULT_CYCLES_PER_FRAME;
+
+    /**
+     * The keys held down during the last step, bit k for key k
+     */
+    uint16_t keys = 0;
+
+    uint16_t reward_addr = 0;
+    uint16_t reward_size = 0;
+
+    explicit chip8(uint32_t seed) : seed(seed), quirks_db(std::make_shared<QuirkDatabase>()) {
+        this->machine.snapshot(this->start);
+        this->machine.cpu.seed(seed);
+    }
+
+    void reset(uint32_t seed) {
+        // the program keeps the quirk profile it was loaded or last set with
+        this->start.quirks = this->machine.cpu.quirks();
+        this->machine.restore(this->start);
+        this->machine.loadRom(this->rom.data(), this->rom.size());
+        this->seed = seed;
+        this->machine.cpu.seed(seed);
+        this->machine.cpu.setCyclesPerFrame(this->cycles_per_frame);
+        for (uint8_t key = 0; key < 16; ++key) {
+            this->machine.input.onKeyUp(key);
+        }
+        this->machine.input.clearTriggered();
+        this->keys = 0;
+    }
+
+    State step(uint32_t frames, uint16_t inputs) {
+        uint16_t changed = inputs ^ this->keys;
+        for (uint8_t key = 0; key < 16; ++key) {
+            if (changed & (1u << key)) {
+                if (inputs & (1u << key)) {
+                    this->machine.input.onKeyDown(key);
+                } else {
+                    this->machine.input.onKeyUp(key);
+                }
+            }
+        }
+        this->keys = inputs;
+
+        State state = this->machine.cpu.run(0);
+        for (uint32_t frame = 0; frame < frames && !isFault(state); ++frame) {
+            state = this->machine.cpu.run(this->machine.cpu.cyclesPerFrame());
+        }
+        return state;
+    }
+};
+
+struct chip8_pool {
+    std::vector<std::unique_ptr<chip8>> instances;
+    ThreadPool workers;
+
+    explicit chip8_pool(unsigned threads) : workers(threads) {}
+};
+
+chip8_t *chip8_create(uint32_t seed) {
+    return new(std::nothrow) chip8(seed);
+}
+
+void chip8_destroy(chip8_t *chip8) {
+    delete chip8;
+}
+
+int chip8_load_rom(chip8_t *chip8, const uint8_t *data, size_t size) {
+    if (size > Machine::MAX_PROGRAM_SIZE) {
+        return 0;
+    }
+    chip8->rom.assign(data, data + size);
+    chip8->machine.cpu.setQuirks(chip8->quirks_db->select(data, size));
+    chip8->reset(chip8->seed);
+    return 1;
+}
+
+/**
+ * Reads a database into a new one, so a file that fails to load leaves the current one as it was
+ */
+static std::shared_ptr<const QuirkDatabase> loadQuirks(const char *path) {
+    std::shared_ptr<QuirkDatabase> db = std::make_shared<QuirkDatabase>();
+    return db->load(path) ? db : nullptr;
+}
+
+int chip8_load_quirks_db(chip8_t *chip8, const char *path) {
+    std::shared_ptr<const QuirkDatabase> db = loadQuirks(path);
+    if (!db) {
+        return 0;
+    }
+    chip8->quirks_db = db;
+    return 1;
+}
+
+int chip8_set_quirks(chip8_t *chip8, int quirks) {
+    if (quirks < 0 || quirks >= (int) QuirkProfile::Count) {
+        return 0;
+    }
+    chip8->machine.cpu.setQuirks((QuirkProfile) quirks);
+    return 1;
+}
+
+void chip8_reset(chip8_t *chip8, uint32_t seed) {
+    chip8->reset(seed);
+}
+
+void chip8_set_cycles_per_frame(chip8_t *chip8, uint32_t cycles_per_frame) {
+    chip8->machine.cpu.setCyclesPerFrame(cycles_per_frame);
+    chip8->cycles_per_frame = chip8->machine.cpu.cyclesPerFrame();
+}
+
+int chip8_step_frames(chip8_t *chip8, uint32_t frames, uint16_t inputs) {
+    return (int) chip8->step(frames, inputs);
+}
+
+const uint64_t *chip8_framebuffer(const chip8_t *chip8) {
+    return chip8->machine.graphics.rows;
+}
+
+const uint64_t *chip8_hires_framebuffer(const chip8_t *chip8) {
+    return chip8->machine.graphics.hires_rows[0];
+}
+
+int chip8_hires(const chip8_t *chip8) {
+    return chip8->machine.graphics.isHires() ? 1 : 0;
+}
+
+const uint8_t *chip8_registers(const chip8_t *chip8) {
+    return chip8->machine.cpu.data_registers;
+}
+
+uint16_t chip8_pc(const chip8_t *chip8) {
+    return chip8->machine.cpu.pc;
+}
+
+uint16_t chip8_index_register(const chip8_t *chip8) {
+    return chip8->machine.cpu.instruction_register;
+}
+
+uint64_t chip8_cycles(const chip8_t *chip8) {
+    return chip8->machine.cpu.cycles;
+}
+
+const uint8_t *chip8_memory(const chip8_t *chip8) {
+    return chip8->machine.memory.memory;
+}
+
+int chip8_set_reward_region(chip8_t *chip8, uint16_t addr, uint16_t size) {
+    if ((size_t) addr + size > sizeof(chip8->machine.memory.memory)) {
+        return 0;
+    }
+    chip8->reward_addr = addr;
+    chip8->reward_size = size;
+    return 1;
+}
+
+const uint8_t *chip8_reward(const chip8_t *chip8, size_t *size) {
+    if (size != nullptr) {
+        *size = chip8->reward_size;
+    }
+    return chip8->machine.memory.memory + chip8->reward_addr;
+}
+
+uint64_t chip8_state_hash(const chip8_t *chip8) {
+    return chip8->machine.stateHash();
+}
+
+chip8_pool_t *chip8_pool_create(size_t count, uint32_t seed, unsigned threads) {
+    std::unique_ptr<chip8_pool> pool(new(std::nothrow) chip8_pool(threads));
+    if (!pool) {
+        return nullptr;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        pool->instances.emplace_back(new(std::nothrow) chip8((uint32_t) (seed + i)));
+        if (!pool->instances.back()) {
+            return nullptr;
+        }
+    }
+    return pool.release();
+}
+
+void chip8_pool_destroy(chip8_pool_t *pool) {
+    delete pool;
+}
+
+size_t chip8_pool_size(const chip8_pool_t *pool) {
+    return pool->instances.size();
+}
+
+chip8_t *chip8_pool_instance(chip8_pool_t *pool, size_t i) {
+    return i < pool->instances.size() ? pool->instances[i].get() : nullptr;
+}
+
+int chip8_pool_load_rom(chip8_pool_t *pool, const uint8_t *data, size_t size) {
+    if (size > Machine::MAX_PROGRAM_SIZE) {
+        return 0;
+    }
+    for (auto &instance : pool->instances) {
+        chip8_load_rom(instance.get(), data, size);
+    }
+    return 1;
+}
+
+int chip8_pool_load_quirks_db(chip8_pool_t *pool, const char *path) {
+    std::shared_ptr<const QuirkDatabase> db = loadQuirks(path);
+    if (!db) {
+        return 0;
+    }
+    for (auto &instance : pool->instances) {
+        instance->quirks_db = db;
+    }
+    return 1;
+}
+
+void chip8_pool_reset(chip8_pool_t *pool, uint32_t seed) {
+    for (size_t i = 0; i < pool->instances.size(); ++i) {
+        pool->instances[i]->reset((uint32_t) (seed + i));
+    }
+}
+
+void chip8_pool_step_frames(chip8_pool_t *pool, uint32_t frames, const uint16_t *inputs, int *states) {
+    // a few chunks per worker, so instances that run into slow code do not hold up the rest
+    size_t count = pool->instances.size();
+    size_t chunks = std::min<size_t>(count, pool->workers.size() * 4);
+    for (size_t chunk = 0; chunk < chunks; ++chunk) {
+        size_t first = count * chunk / chunks, last = count * (chunk + 1) / chunks;
+        pool->workers.submit([pool, frames, inputs, states, first, last] {
+            for (size_t i = first; i < last; ++i) {
+                State state = pool->instances[i]->step(frames, inputs != nullptr ? inputs[i] : 0);
+                if (states != nullptr) {
+                    states[i] = (int) state;
+                }
+            }
+        });
+    }
+    pool->workers.wait();
+}
@@ -0,0 +1,185 @@
+#ifndef CHIP8_H
+#define CHIP8_H
+
+/*
+ * C interface to the emulator, for embedding it in other processes and languages. Built as the
+ * shared library libchip8; every other symbol of the library stays hidden.
+ *
+ * Observations are pointers into the emulator's own state. They stay valid, at the same address,
+ * for the lifetime of the instance and see every change as it is made, so nothing is copied per step;
+ * only read them while no step of that instance is running.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define CHIP8_API __attribute__((visibility("default")))
+#else
+#define CHIP8_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct chip8 chip8_t;
+typedef struct chip8_pool chip8_pool_t;
+
+/**
+ * How the last step ended; the values above CHIP8_WAITING_FOR_KEY are faults the instance cannot
+ * continue from without a reset
+ */
+enum chip8_state {
+    CHIP8_RUNNING = 0,
+    CHIP8_WAITING_FOR_KEY = 1,
+    CHIP8_PC_OUT_OF_BOUNDS = 2,
+    CHIP8_STACK_OVERFLOW = 3,
+    CHIP8_STACK_UNDERFLOW = 4,
+};
+
+/**
+ * How ambiguous instructions behave, see Quirks.h
+ */
+enum chip8_quirks {
+    CHIP8_QUIRKS_VIP = 0,
+    CHIP8_QUIRKS_SCHIP = 1,
+    CHIP8_QUIRKS_MODERN = 2,
+};
+
+/**
+ * Creates an instance with nothing loaded, its random number generator seeded with seed.
+ * Returns NULL if it could not be allocated.
+ */
+CHIP8_API chip8_t *chip8_create(uint32_t seed);
+
+CHIP8_API void chip8_destroy(chip8_t *chip8);
+
+/**
+ * Copies a program into memory at 0x200 and resets the instance to run it with its last seed, under
+ * the profile the quirk database lists for it, or else CHIP8_QUIRKS_SCHIP if it uses SUPER-CHIP
+ * instructions and CHIP8_QUIRKS_MODERN otherwise.
+ * Returns 1 on success, 0, leaving the instance untouched, if the program does not fit.
+ */
+CHIP8_API int chip8_load_rom(chip8_t *chip8, const uint8_t *data, size_t size);
+
+/**
+ * Reads the quirk database chip8_load_rom() consults from now on: a text file with a line per known
+ * program holding its 64-bit FNV-1a hash in hex and vip, schip or modern. Lines starting with # are ignored.
+ * Returns 1 on success, 0, keeping the database used so far, if the file could not be read or is invalid.
+ */
+CHIP8_API int chip8_load_quirks_db(chip8_t *chip8, const char *path);
+
+/**
+ * Runs the loaded program under another chip8_quirks profile from now on, e.g. right after loading it.
+ * Returns 1 on success, 0 if quirks is not a profile.
+ */
+CHIP8_API int chip8_set_quirks(chip8_t *chip8, int quirks);
+
+/**
+ * Restarts the loaded program from a cleared memory, screen and keypad with the given seed
+ */
+CHIP8_API void chip8_reset(chip8_t *chip8, uint32_t seed);
+
+/**
+ * Sets the number of instructions per 60 Hz frame, 10 by default
+ */
+CHIP8_API void chip8_set_cycles_per_frame(chip8_t *chip8, uint32_t cycles_per_frame);
+
+/**
+ * Runs frames 60 Hz frames with the keys in inputs held down, bit k for key k, stopping early at a
+ * fault. Keys not held during the last step are pressed first, ending a wait of FX0A. Returns a chip8_state.
+ */
+CHIP8_API int chip8_step_frames(chip8_t *chip8, uint32_t frames, uint16_t inputs);
+
+/**
+ * The 64x32 screen, one word per row, the most significant bit the leftmost pixel
+ */
+CHIP8_API const uint64_t *chip8_framebuffer(const chip8_t *chip8);
+
+/**
+ * The SUPER-CHIP 128x64 screen, two words per row, the left half first
+ */
+CHIP8_API const uint64_t *chip8_hires_framebuffer(const chip8_t *chip8);
+
+/**
+ * Returns 1 if the high resolution screen is the one shown
+ */
+CHIP8_API int chip8_hires(const chip8_t *chip8);
+
+/**
+ * V0-VF
+ */
+CHIP8_API const uint8_t *chip8_registers(const chip8_t *chip8);
+
+CHIP8_API uint16_t chip8_pc(const chip8_t *chip8);
+CHIP8_API uint16_t chip8_index_register(const chip8_t *chip8);
+
+/**
+ * The number of instructions executed since the last reset
+ */
+CHIP8_API uint64_t chip8_cycles(const chip8_t *chip8);
+
+/**
+ * All 4096 bytes of memory
+ */
+CHIP8_API const uint8_t *chip8_memory(const chip8_t *chip8);
+
+/**
+ * Selects the bytes of memory a program keeps its score or other reward signal in.
+ * Returns 1 on success, 0, leaving the region as it was, if it does not lie within memory.
+ */
+CHIP8_API int chip8_set_reward_region(chip8_t *chip8, uint16_t addr, uint16_t size);
+
+/**
+ * The reward region, storing its size in size if that is not NULL. Empty until one is set.
+ */
+CHIP8_API const uint8_t *chip8_reward(const chip8_t *chip8, size_t *size);
+
+/**
+ * A 64-bit hash of the complete machine state; equal states hash equally on every host
+ */
+CHIP8_API uint64_t chip8_state_hash(const chip8_t *chip8);
+
+/**
+ * Creates count instances stepped together, instance i seeded with seed + i, and threads worker
+ * threads, 0 for one per hardware thread. Returns NULL if they could not be allocated.
+ */
+CHIP8_API chip8_pool_t *chip8_pool_create(size_t count, uint32_t seed, unsigned threads);
+
+CHIP8_API void chip8_pool_destroy(chip8_pool_t *pool);
+
+CHIP8_API size_t chip8_pool_size(const chip8_pool_t *pool);
+
+/**
+ * Instance i of the pool, for observing or configuring it; owned by the pool
+ */
+CHIP8_API chip8_t *chip8_pool_instance(chip8_pool_t *pool, size_t i);
+
+/**
+ * Loads the program into every instance. Returns 1 on success, 0 if it does not fit.
+ */
+CHIP8_API int chip8_pool_load_rom(chip8_pool_t *pool, const uint8_t *data, size_t size);
+
+/**
+ * Reads a quirk database, see chip8_load_quirks_db(), once and shares it between every instance.
+ * Returns 1 on success, 0, keeping the databases used so far, if it could not be read or is invalid.
+ */
+CHIP8_API int chip8_pool_load_quirks_db(chip8_pool_t *pool, const char *path);
+
+/**
+ * Resets every instance, instance i with seed + i
+ */
+CHIP8_API void chip8_pool_reset(chip8_pool_t *pool, uint32_t seed);
+
+/**
+ * Runs frames frames on every instance in parallel, instance i with inputs[i] held down, and stores
+ * the chip8_state each ended in to states[i] unless states is NULL
+ */
+CHIP8_API void chip8_pool_step_frames(chip8_pool_t *pool, uint32_t frames, const uint16_t *inputs, int *states);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //CHIP8_H
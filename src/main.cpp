@@ -1,65 +1,240 @@
-#include <iostream>
-#include <fstream>
-#include <iterator>
-#include <unordered_map>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
 
-#include "Memory.h"
-#include "Cpu.h"
+#include "Analyzer.h"
+#include "Audio.h"
+#include "FrameStream.h"
+#include "InputLog.h"
+#include "InputQueue.h"
+#include "Machine.h"
+#include "Quirks.h"
+#include "Rewind.h"
+#include "Rom.h"
+#include "Scheduler.h"
+#include "TripleBuffer.h"
 #include "SDL2/SDL.h"
 
-static std::unordered_map<SDL_Keycode, uint8_t> keymap = {
-        {SDLK_1, 0},
-        {SDLK_2, 1},
-        {SDLK_3, 2},
-        {SDLK_4, 3},
-
-        {SDLK_q, 4},
-        {SDLK_w, 5},
-        {SDLK_e, 6},
-        {SDLK_r, 7},
-
-        {SDLK_a, 8},
-        {SDLK_s, 9},
-        {SDLK_d, 10},
-        {SDLK_f, 11},
-
-        {SDLK_q, 12},
-        {SDLK_w, 13},
-        {SDLK_q, 14},
-        {SDLK_w, 15}
+/**
+ * The CHIP-8 key of every ASCII keycode, or -1. The hex keypad maps onto the left of the keyboard:
+ *   1 2 3 C      1 2 3 4
+ *   4 5 6 D      q w e r
+ *   7 8 9 E      a s d f
+ *   A 0 B F      z x c v
+ */
+struct Keymap {
+    int8_t keys[128];
 };
 
+static constexpr Keymap makeKeymap() {
+    Keymap keymap{};
+    for (auto &key : keymap.keys) {
+        key = -1;
+    }
+    const char layout[] = "x123qweasdzc4rfv";
+    for (int8_t key = 0; key < 16; ++key) {
+        keymap.keys[(uint8_t) layout[key]] = key;
+    }
+    return keymap;
+}
+
+static constexpr Keymap KEYMAP = makeKeymap();
+
+static int chip8Key(SDL_Keycode keycode) {
+    return keycode >= 0 && keycode < 128 ? KEYMAP.keys[keycode] : -1;
+}
+
+/**
+ * What the window thread asks of the emulation thread
+ */
+struct Command {
+    enum Type : uint8_t {
+        Save,
+        Load,
+        RewindStart,
+        RewindStop
+    } type;
+};
+
+/**
+ * The buzzer plays at AUDIO_RATE through a device buffer of AUDIO_BUFFER samples. At most AUDIO_MAX_QUEUED
+ * samples wait in the ring, so every sample plays within 20 ms of being rendered, while a whole frame of
+ * 800 samples still fits once the device has caught up.
+ */
+static const int AUDIO_RATE = 48000;
+static const uint16_t AUDIO_BUFFER = 128;
+static const size_t AUDIO_MAX_QUEUED = AUDIO_RATE / 50 - AUDIO_BUFFER;
+
+/**
+ * Runs on SDL's audio thread, so it only takes what the emulation thread already rendered
+ */
+static void audioCallback(void *userdata, uint8_t *stream, int len) {
+    static_cast<RingSink *>(userdata)->read(reinterpret_cast<float *>(stream), len / sizeof(float));
+}
+
+static void usage(const char *name) {
+    printf("Usage: %s [--ipf instructions-per-frame] [--speed multiplier | --unthrottled]\n"
+           "          [--quirks vip|schip|modern] [--quirks-db file] [--record-frames file] [--record-input file] rom-file\n"
+           "       %s [options] --library directory rom-name-or-hash\n"
+           "       %s --list directory\n", name, name, name);
+}
+
+static int listLibrary(const char *directory) {
+    RomLibrary library(directory);
+    library.refresh();
+    for (auto &entry : library.entries()) {
+        printf("%016" PRIx64 " %5" PRIu64 " %-5s %s\n", entry.hash, entry.size, profileName(entry.profile), entry.name.c_str());
+    }
+    return 0;
+}
+
 int main(int argc, char **argv) {
-    if (argc != 2) {
-        printf("Usage: %s [rom-file]", argv[1]);
+    uint32_t instructions_per_frame = Cpu::DEFAULT_CYCLES_PER_FRAME;
+    Pacing pacing = Pacing::RealTime;
+    double multiplier = 1.0;
+    const char *rom_path = nullptr;
+    const char *library_path = nullptr;
+    const char *frames_path = nullptr;
+    const char *input_log_path = nullptr;
+    const char *quirks_name = nullptr;
+    const char *quirks_db_path = nullptr;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--ipf") == 0 && i + 1 < argc) {
+            instructions_per_frame = (uint32_t) std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            pacing = Pacing::Multiplier;
+            multiplier = std::strtod(argv[++i], nullptr);
+        } else if (std::strcmp(argv[i], "--unthrottled") == 0) {
+            pacing = Pacing::Unthrottled;
+        } else if (std::strcmp(argv[i], "--list") == 0 && i + 1 < argc) {
+            return listLibrary(argv[i + 1]);
+        } else if (std::strcmp(argv[i], "--library") == 0 && i + 1 < argc) {
+            library_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--record-frames") == 0 && i + 1 < argc) {
+            frames_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--record-input") == 0 && i + 1 < argc) {
+            input_log_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--quirks") == 0 && i + 1 < argc) {
+            quirks_name = argv[++i];
+        } else if (std::strcmp(argv[i], "--quirks-db") == 0 && i + 1 < argc) {
+            quirks_db_path = argv[++i];
+        } else if (argv[i][0] != '-' && rom_path == nullptr) {
+            rom_path = argv[i];
+        } else {
+            usage(argv[0]);
+            return 0;
+        }
+    }
+
+    if (rom_path == nullptr) {
+        usage(argv[0]);
         return 0;
     }
 
-    FILE *rom = std::fopen(argv[1], "r");
+    std::string path = rom_path;
+    if (library_path != nullptr) {
+        RomLibrary library(library_path);
+        library.refresh();
+        const RomEntry *entry = library.find(path);
+        if (entry == nullptr) {
+            char *end;
+            uint64_t hash = std::strtoull(rom_path, &end, 16);
+            entry = *end == '\0' ? library.find(hash) : nullptr;
+        }
+        if (entry == nullptr) {
+            printf("%s is not in %s\n", rom_path, library_path);
+            return 1;
+        }
+        path = library.path(*entry);
+    }
 
-    if (rom == nullptr) {
-        printf("%s could not be loaded!", argv[1]);
-        return 0;
+    RomFile rom;
+    if (!rom.open(path.c_str())) {
+        printf("%s %s!\n", path.c_str(), rom.error());
+        return 1;
+    }
+
+    // the quirk profile is the one given, or else the database's entry for the rom or a guess from its opcodes
+    QuirkDatabase quirks_db;
+    if (quirks_db_path != nullptr && !quirks_db.load(quirks_db_path)) {
+        printf("Could not read the quirk database %s\n", quirks_db_path);
+        return 1;
+    }
+    QuirkProfile quirks = quirks_db.select(rom.data(), rom.size());
+    if (quirks_name != nullptr && !parseQuirkProfile(quirks_name, quirks)) {
+        printf("Unknown quirk profile %s\n", quirks_name);
+        return 1;
+    }
+
+    Machine machine;
+    Graphics &graphics = machine.graphics;
+    Input &input = machine.input;
+    Cpu &cpu = machine.cpu;
+    machine.loadRom(rom.data(), rom.size());
+    cpu.setQuirks(quirks);
+
+    // decode (and with the recompiler, compile) every block the rom is known to contain up front,
+    // rather than on first execution
+    Analysis analysis;
+    analysis.analyze(rom.data(), rom.size());
+    for (auto &block : analysis.blocks()) {
+        cpu.prefetch(block.start, block.end);
     }
+    printf("Loaded %s (%zu bytes, %016" PRIx64 ", %s, %s quirks)\n", path.c_str(), rom.size(), rom.hash(),
+           profileName(detectProfile(rom.data(), rom.size())), quirkProfileName(quirks));
 
-    uint8_t buffer[4096 - 0x200];
-    std::fread(buffer, 4096 - 0x200, sizeof(uint8_t), rom);
+    // F5 saves the session next to the rom, F9 restores it
+    std::string state_path = path + ".state";
 
-    auto memory = Memory();
+    Scheduler scheduler(cpu);
+    scheduler.setInstructionsPerFrame(instructions_per_frame);
+    scheduler.setPacing(pacing, multiplier);
 
-    for (int i = 0; i < 4096 - 0x200; ++i) {
-        memory.memory[0x200 + i] = buffer[i];
-        printf("%x ", buffer[i]);
+    // the log fixes the seed, so the key events at their cycles are all a replay needs; jumping
+    // back in time would break that, so rewinding and loading states are off while recording
+    InputLog input_log;
+    bool recording_input = input_log_path != nullptr;
+    if (recording_input) {
+        input_log.start(machine, rom.hash(), std::random_device()());
+        printf("Recording input to %s; rewinding and loading states are disabled\n", input_log_path);
     }
 
-    auto graphics = Graphics(memory);
-    auto input = Input();
-    Cpu cpu(memory, graphics, input, 0x200);
+    // holding backspace steps back one frame per frame
+    Rewind rewind(machine);
 
-    for (int i = 0; i < 100; i++) {
-        cpu.step();
+    // emulated frames are recorded and timed by frame count, since rewinding moves the cycle count
+    // back; frames shown while rewinding are not part of the recording
+    FILE *frames_file = nullptr;
+    FrameRecorder recorder;
+    if (frames_path != nullptr) {
+        frames_file = fopen(frames_path, "wb");
+        if (frames_file == nullptr || !recorder.open(frames_file, Scheduler::FRAME_RATE * instructions_per_frame)) {
+            printf("Could not record to %s\n", frames_path);
+            return 1;
+        }
     }
 
+    // the buzzer is rendered a frame at a time into a ring the audio callback drains
+    RingSink audio_ring(4 * AUDIO_RATE / Scheduler::FRAME_RATE, AUDIO_MAX_QUEUED);
+    Buzzer buzzer(audio_ring, AUDIO_RATE);
+    cpu.setSoundListener(&buzzer);
+
+    scheduler.setFrameListener([&]() {
+        rewind.record();
+        buzzer.render(cpu);
+        if (frames_file != nullptr && graphics.isDirty()) {
+            recorder.capture(graphics, scheduler.frames() * instructions_per_frame);
+        }
+    });
+
     if (SDL_Init(SDL_INIT_EVERYTHING) < 0) {
         printf("SDL failed to initialize: %s\n", SDL_GetError());
         return 1;
@@ -74,54 +249,212 @@ int main(int argc, char **argv) {
         return 2;
     }
 
-    SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, 0);
+    SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_PRESENTVSYNC);
     SDL_RenderSetLogicalSize(renderer, 1024, 512);
 
-    SDL_Texture *sdlTexture = SDL_CreateTexture(renderer,
-                                                SDL_PIXELFORMAT_ARGB8888,
-                                                SDL_TEXTUREACCESS_STREAMING,
-                                                64, 32);
+    SDL_AudioSpec audio_spec{};
+    audio_spec.freq = AUDIO_RATE;
+    audio_spec.format = AUDIO_F32SYS;
+    audio_spec.channels = 1;
+    audio_spec.samples = AUDIO_BUFFER;
+    audio_spec.callback = audioCallback;
+    audio_spec.userdata = &audio_ring;
+    SDL_AudioDeviceID audio = SDL_OpenAudioDevice(nullptr, 0, &audio_spec, nullptr, 0);
+    if (audio == 0) {
+        printf("Continuing without sound: %s\n", SDL_GetError());
+    } else {
+        SDL_PauseAudioDevice(audio, 0);
+    }
 
+    // without vsync, presenting no longer paces the window thread, so it sleeps for a frame instead
+    SDL_RendererInfo renderer_info;
+    bool vsync = SDL_GetRendererInfo(renderer, &renderer_info) == 0 && (renderer_info.flags & SDL_RENDERER_PRESENTVSYNC);
 
-    SDL_Event event;
-    while (true) {
-        SDL_PollEvent(&event);
-        if (event.type == SDL_QUIT) {
-            break;
+    // the emulation runs on its own thread and publishes every frame that changed the screen; this
+    // thread polls events and presents the newest published frame at display rate, and neither ever
+    // waits for the other
+    TripleBuffer<Graphics::Screen> published;
+    std::atomic<bool> quit(false);
+    std::mutex commands_mutex;
+    std::vector<Command> commands;
+
+    // key events keep the time SDL saw them, so the scheduler can apply them at the matching cycle
+    InputQueue key_events;
+    scheduler.setInputQueue(&key_events, [&](uint8_t key, bool down) {
+        if (recording_input) {
+            input_log.record(machine, key, down);
         }
+        if (down) {
+            input.onKeyDown(key);
+        } else {
+            input.onKeyUp(key);
+        }
+    });
+    Scheduler::Clock::time_point sdl_start = Scheduler::Clock::now() - std::chrono::milliseconds(SDL_GetTicks());
+    auto sdlTime = [sdl_start](uint32_t timestamp) {
+        return sdl_start + std::chrono::milliseconds(timestamp);
+    };
 
-        switch (event.type) {
-            case SDL_KEYDOWN:
-                if (keymap.find(event.key.keysym.sym) != keymap.end()) {
-                    input.onKeyDown(keymap[event.key.keysym.sym]);
+    std::thread emulation([&]() {
+        std::vector<Command> pending;
+        bool rewinding = false;
+        scheduler.reset();
+        while (!quit.load()) {
+            // commands that arrive while the window thread holds the lock are taken next frame
+            if (commands_mutex.try_lock()) {
+                pending.swap(commands);
+                commands_mutex.unlock();
+            }
+            for (const Command &command : pending) {
+                switch (command.type) {
+                    case Command::Save:
+                        printf(machine.save(state_path.c_str()) ? "Saved %s\n" : "Could not save %s\n", state_path.c_str());
+                        break;
+                    case Command::Load:
+                        printf(machine.load(state_path.c_str()) ? "Loaded %s\n" : "Could not load %s\n", state_path.c_str());
+                        rewind.clear();
+                        buzzer.sync(cpu);
+                        scheduler.reset();
+                        break;
+                    case Command::RewindStart:
+                    case Command::RewindStop:
+                        rewinding = command.type == Command::RewindStart;
+                        break;
                 }
+            }
+            pending.clear();
+
+            State state = State::Running;
+            if (rewinding) {
+                rewind.stepBack();
+                scheduler.skip();
+            } else {
+                state = scheduler.advance();
+            }
+            if (isFault(state)) {
+                printf("Emulation stopped: fault at pc %x\n", cpu.pc);
+                quit = true;
                 break;
-            case SDL_KEYUP:
-                if (keymap.find(event.key.keysym.sym) != keymap.end()) {
-                    input.onKeyUp(keymap[event.key.keysym.sym]);
+            }
+
+            // a frame whose changes cancelled out is not published at all
+            if (graphics.isDirty()) {
+                if (graphics.changedRows() != 0) {
+                    graphics.copyTo(published.write());
+                    published.publish();
                 }
-                break;
-            default:
-                break;
+                graphics.clearDirty();
+            }
+
+            scheduler.wait();
         }
+    });
 
-        if (graphics.isDirty()) {
-            SDL_UpdateTexture(sdlTexture, nullptr, graphics.buffer, 64 * sizeof(uint32_t));
-            SDL_RenderClear(renderer);
-            SDL_RenderCopy(renderer, sdlTexture, nullptr, nullptr);
+    auto send = [&](Command command) {
+        std::lock_guard<std::mutex> lock(commands_mutex);
+        commands.push_back(command);
+    };
 
-            SDL_RenderPresent(renderer);
+    // the window thread's own copy of the screen, which tracks the rows uploaded to the texture
+    Memory presented_memory;
+    Graphics presented(presented_memory);
+    uint64_t presented_frames = 0;
 
-            graphics.clearDirty();
+    // recreated whenever a SUPER-CHIP rom switches resolution
+    int texture_width = presented.width();
+    SDL_Texture *sdlTexture = SDL_CreateTexture(renderer,
+                                                SDL_PIXELFORMAT_ARGB8888,
+                                                SDL_TEXTUREACCESS_STREAMING,
+                                                presented.width(), presented.height());
+
+
+    uint32_t pixels[Graphics::HIRES_WIDTH * Graphics::HIRES_HEIGHT];
+
+    SDL_Event event;
+    while (!quit.load()) {
+        // every pending event is taken each refresh, so bursts are never left waiting
+        while (SDL_PollEvent(&event)) {
+            int key;
+            switch (event.type) {
+                case SDL_QUIT:
+                    quit = true;
+                    break;
+                case SDL_KEYDOWN:
+                    key = chip8Key(event.key.keysym.sym);
+                    if (event.key.keysym.sym == SDLK_F5) {
+                        send(Command{Command::Save});
+                    } else if (event.key.keysym.sym == SDLK_BACKSPACE && !recording_input) {
+                        send(Command{Command::RewindStart});
+                    } else if (event.key.keysym.sym == SDLK_F9 && !recording_input) {
+                        send(Command{Command::Load});
+                    } else if (key >= 0 && !event.key.repeat) {
+                        key_events.push(KeyEvent{sdlTime(event.key.timestamp), (uint8_t) key, true});
+                    }
+                    break;
+                case SDL_KEYUP:
+                    key = chip8Key(event.key.keysym.sym);
+                    if (event.key.keysym.sym == SDLK_BACKSPACE) {
+                        send(Command{Command::RewindStop});
+                    } else if (key >= 0) {
+                        key_events.push(KeyEvent{sdlTime(event.key.timestamp), (uint8_t) key, false});
+                    }
+                    break;
+                default:
+                    break;
+            }
         }
 
-        cpu.step();
-        SDL_Delay(2);
+        if (published.acquire()) {
+            presented.copyFrom(published.read());
+            if (presented.width() != texture_width) {
+                SDL_DestroyTexture(sdlTexture);
+                texture_width = presented.width();
+                sdlTexture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
+                                               presented.width(), presented.height());
+            }
+
+            // upload only the rows that changed since the last presented frame
+            uint64_t changed = presented.changedRows();
+            int first, count, pitch = presented.width() * (int) sizeof(uint32_t);
+            while (Graphics::nextSpan(changed, first, count)) {
+                presented.toARGB(pixels, first, count);
+                SDL_Rect rect{0, first, presented.width(), count};
+                SDL_UpdateTexture(sdlTexture, &rect, pixels + first * presented.width(), pitch);
+            }
+            presented.clearDirty();
+            presented_frames++;
+        }
+
+        SDL_RenderClear(renderer);
+        SDL_RenderCopy(renderer, sdlTexture, nullptr, nullptr);
+        SDL_RenderPresent(renderer);
+        if (!vsync) {
+            SDL_Delay(1000 / Scheduler::FRAME_RATE);
+        }
+    }
+
+    emulation.join();
+    if (audio != 0) {
+        SDL_CloseAudioDevice(audio);
     }
+    printf("Presented %" PRIu64 " frames; %" PRIu64 " dropped, %" PRIu64 " repeated\n",
+           presented_frames, published.dropped(), published.repeated());
 
+    SDL_DestroyTexture(sdlTexture);
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
 
+    if (recording_input) {
+        input_log.finish(machine);
+        printf(input_log.save(input_log_path) ? "Saved %s\n" : "Could not save %s\n", input_log_path);
+    }
+
+    if (frames_file != nullptr) {
+        recorder.flush();
+        fclose(frames_file);
+        printf("Recorded %" PRIu64 " frames to %s\n", recorder.frames(), frames_path);
+    }
+
 
     return 0;
 }
@@ -0,0 +1,88 @@
+#pragma clang diagnostic push
+#pragma ide diagnostic ignored "cert-err58-cpp"
+
+#include <Analyzer.h>
+#include <Machine.h>
+#include <cstring>
+#include "gtest/gtest.h"
+
+static const uint8_t ROM[] = {
+        0x60, 0x00, // 0x200: V0 = 0
+        0x22, 0x10, // 0x202: call 0x210
+        0x30, 0x01, // 0x204: skip if V0 == 1
+        0x12, 0x0A, // 0x206: jump to 0x20A
+        0x12, 0x00, // 0x208: jump to 0x200
+        0xA2, 0x08, // 0x20A: I = 0x208
+        0xF0, 0x33, // 0x20C: BCD of V0 at I, overwriting the jump at 0x208
+        0xB3, 0x00, // 0x20E: jump to 0x300 + V0
+        0x70, 0x01, // 0x210: V0 += 1
+        0x00, 0xEE, // 0x212: return
+        0xFF, 0x00, 0x81,
+};
+
+TEST(AnalyzerTest, ControlFlow) {
+    Analysis analysis;
+    ASSERT_TRUE(analysis.analyze(ROM, sizeof(ROM)));
+
+    ASSERT_EQ(analysis.blocks().size(), 6u);
+    const BasicBlock &first = analysis.blocks()[0];
+    EXPECT_EQ(first.start, 0x200);
+    EXPECT_EQ(first.end, 0x204);
+    EXPECT_EQ(first.successors, (std::vector<uint16_t>{0x204, 0x210}));
+    EXPECT_EQ(analysis.blocks()[1].successors, (std::vector<uint16_t>{0x206, 0x208}));
+    EXPECT_EQ(analysis.blocks()[3].successors, (std::vector<uint16_t>{0x200}));
+    EXPECT_EQ(analysis.blocks()[4].start, 0x20A);
+    EXPECT_EQ(analysis.blocks()[4].end, 0x210);
+    EXPECT_TRUE(analysis.blocks()[4].successors.empty());
+
+    EXPECT_EQ(analysis.subroutines(), (std::vector<uint16_t>{0x210}));
+    EXPECT_EQ(analysis.indirectJumps(), (std::vector<uint16_t>{0x20E}));
+    EXPECT_TRUE(analysis.unknownOpcodes().empty());
+    ASSERT_EQ(analysis.selfModifyingWrites().size(), 1u);
+    EXPECT_EQ(analysis.selfModifyingWrites()[0].pc, 0x20C);
+    EXPECT_EQ(analysis.selfModifyingWrites()[0].target, 0x208);
+
+    EXPECT_TRUE(analysis.isInstruction(0x212));
+    EXPECT_TRUE(analysis.isCode(0x213));
+    EXPECT_FALSE(analysis.isCode(0x214));
+    auto data = analysis.dataRegions();
+    ASSERT_EQ(data.size(), 1u);
+    EXPECT_EQ(data[0], std::make_pair((uint16_t) 0x214, (uint16_t) 0x217));
+    EXPECT_EQ(analysis.instructions().size(), 10u);
+
+    EXPECT_FALSE(analysis.analyze(ROM, 4096));
+    EXPECT_TRUE(analysis.blocks().empty());
+}
+
+TEST(AnalyzerTest, Disassemble) {
+    char text[32];
+    disassemble(0xF033, text, sizeof(text));
+    EXPECT_STREQ(text, "LD B, V0");
+    disassemble(0xB300, text, sizeof(text));
+    EXPECT_STREQ(text, "JP V0, 0x300");
+    disassemble(0xD125, text, sizeof(text));
+    EXPECT_STREQ(text, "DRW V1, V2, 5");
+    disassemble(0x5121, text, sizeof(text));
+    EXPECT_STREQ(text, "DW 0x5121");
+}
+
+TEST(AnalyzerTest, Prefetch) {
+    Analysis analysis;
+    analysis.analyze(ROM, sizeof(ROM));
+
+    Machine plain;
+    plain.loadRom(ROM, sizeof(ROM));
+    plain.cpu.seed(1);
+    Machine prefetched;
+    prefetched.loadRom(ROM, sizeof(ROM));
+    prefetched.cpu.seed(1);
+    for (auto &block : analysis.blocks()) {
+        prefetched.cpu.prefetch(block.start, block.end);
+    }
+
+    // the self-modifying store still invalidates the prefetched jump it overwrites
+    plain.cpu.run(40);
+    prefetched.cpu.run(40);
+    EXPECT_EQ(prefetched.cpu.pc, plain.cpu.pc);
+    EXPECT_EQ(prefetched.stateHash(), plain.stateHash());
+}
@@ -0,0 +1,83 @@
+#pragma clang diagnostic push
+#pragma ide diagnostic ignored "cert-err58-cpp"
+
+#include <Audio.h>
+#include <Machine.h>
+#include <Scheduler.h>
+#include <algorithm>
+#include <cmath>
+#include "gtest/gtest.h"
+
+static float peak(const std::vector<float> &samples, size_t first, size_t last) {
+    float peak = 0;
+    for (size_t i = first; i < last; ++i) {
+        peak = std::max(peak, std::fabs(samples[i]));
+    }
+    return peak;
+}
+
+TEST(AudioTest, BuzzerFollowsSoundTimer) {
+    const uint8_t rom[] = {
+            0x60, 0x04, // 0x200: V0 = 4
+            0xF0, 0x18, // 0x202: sound timer = V0
+            0x12, 0x04, // 0x204: jump to itself
+    };
+    Machine machine;
+    machine.loadRom(rom, sizeof(rom));
+    Scheduler scheduler(machine.cpu);
+    scheduler.setInstructionsPerFrame(10);
+
+    // 48000 Hz at 600 cycles per second is 80 samples per cycle
+    NullSink sink;
+    Buzzer buzzer(sink, 48000);
+    machine.cpu.setSoundListener(&buzzer);
+    scheduler.setFrameListener([&]() { buzzer.render(machine.cpu); });
+    for (int i = 0; i < 6; ++i) {
+        scheduler.runFrame();
+    }
+    ASSERT_EQ(sink.samples.size(), 6u * 800);
+
+    // FX18 is the instruction at cycle 1; the first tick follows 9 cycles later, the fourth at cycle 40
+    EXPECT_EQ(peak(sink.samples, 0, 80), 0.0f);
+    EXPECT_GT(peak(sink.samples, 80, 130), 0.0f);
+    EXPECT_GT(peak(sink.samples, 200, 3200), 0.2f);
+    EXPECT_GT(peak(sink.samples, 3200, 3248), 0.0f);
+    EXPECT_EQ(peak(sink.samples, 3250, sink.samples.size()), 0.0f);
+    EXPECT_LE(peak(sink.samples, 0, sink.samples.size()), 0.25f);
+
+    // after going back in time the buzzer continues from the restored timer
+    MachineState state;
+    machine.snapshot(state);
+    scheduler.runFrame();
+    machine.restore(state);
+    buzzer.render(machine.cpu);
+    EXPECT_EQ(sink.samples.size(), 7u * 800);
+}
+
+TEST(AudioTest, RingBoundsLatency) {
+    RingSink ring(1024, 300);
+    float samples[256];
+    std::fill(samples, samples + 256, 0.5f);
+
+    ring.write(samples, 256);
+    EXPECT_EQ(ring.queued(), 256u);
+    // only the first 44 samples fit below max_queued, the rest are dropped
+    ring.write(samples, 256);
+    EXPECT_EQ(ring.queued(), 300u);
+    EXPECT_EQ(ring.dropped(), 212u);
+    ring.write(samples, 100);
+    EXPECT_LE(ring.queued(), 300u);
+    EXPECT_EQ(ring.dropped(), 312u);
+
+    // once some were played, the next write fills up to max_queued again
+    float out[600];
+    EXPECT_EQ(ring.read(out, 100), 100u);
+    ring.write(samples, 256);
+    EXPECT_EQ(ring.queued(), 300u);
+    EXPECT_EQ(ring.dropped(), 468u);
+
+    EXPECT_EQ(ring.read(out, 600), 300u);
+    EXPECT_EQ(out[299], 0.5f);
+    EXPECT_EQ(out[300], 0.0f);
+    EXPECT_EQ(ring.underruns(), 1u);
+}
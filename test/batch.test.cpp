@@ -0,0 +1,159 @@
+#pragma clang diagnostic push
+#pragma ide diagnostic ignored "cert-err58-cpp"
+
+#include <BatchCpu.h>
+#include <cstring>
+#include "gtest/gtest.h"
+
+// Draws a sprite at a random position, and branches, calls and stores based on a random bit,
+// so lanes spread out over different pcs and memory contents
+static const uint8_t DIVERGING_ROM[] = {
+        0xC0, 0x3F, // 0x200: V0 = random & 0x3F
+        0xC1, 0x01, // 0x202: V1 = random & 0x01
+        0xA2, 0x30, // 0x204: I = 0x230
+        0xD0, 0x15, // 0x206: Draw 5 rows at (V0, V1)
+        0x31, 0x01, // 0x208: Skip if V1 == 1
+        0x22, 0x20, // 0x20A: Call 0x220
+        0x72, 0x01, // 0x20C: V2 += 1
+        0x83, 0x24, // 0x20E: V3 += V2
+        0x83, 0x56, // 0x210: V3 >>= 1
+        0xF3, 0x33, // 0x212: BCD of V3 at I
+        0xF2, 0x65, // 0x214: Load V0-V2 from I
+        0x42, 0x00, // 0x216: Skip if V2 != 0
+        0x62, 0x01, // 0x218: V2 = 1
+        0x12, 0x00, // 0x21A: Jump to 0x200
+        0x00, 0x00,
+        0x00, 0x00,
+        0x74, 0x01, // 0x220: V4 += 1
+        0x85, 0x40, // 0x222: V5 = V4
+        0x85, 0x5E, // 0x224: V5 <<= 1
+        0x8F, 0x57, // 0x226: VF = V5 - VF
+        0x00, 0xEE, // 0x228: Return
+        0x00, 0x00,
+        0x00, 0x00,
+        0x00, 0x00,
+        0xF0, 0x90, 0x90, 0x90, 0xF0, // 0x230: sprite
+};
+
+TEST(BatchCpuTest, MatchesSeparateCpus) {
+    const size_t lanes = 37;
+    const uint32_t seed = 99;
+
+    BatchCpu batch(lanes, DIVERGING_ROM, sizeof(DIVERGING_ROM), seed);
+
+    std::vector<std::unique_ptr<Machine>> machines;
+    for (size_t i = 0; i < lanes; ++i) {
+        machines.emplace_back(new Machine());
+        machines.back()->loadRom(DIVERGING_ROM, sizeof(DIVERGING_ROM));
+        machines.back()->cpu.seed(seed + (uint32_t) i);
+    }
+
+    for (int step = 0; step < 2000; ++step) {
+        batch.step();
+        for (auto &machine : machines) {
+            machine->cpu.step();
+        }
+    }
+
+    for (size_t i = 0; i < lanes; ++i) {
+        Cpu &cpu = machines[i]->cpu;
+        EXPECT_EQ(batch.pc(i), cpu.pc) << "lane " << i;
+        EXPECT_EQ(batch.instructionRegister(i), cpu.instruction_register) << "lane " << i;
+        EXPECT_EQ(batch.cycles(i), cpu.cycles) << "lane " << i;
+        for (uint8_t r = 0; r < 16; ++r) {
+            EXPECT_EQ(batch.dataRegister(i, r), cpu.data_registers[r]) << "lane " << i << " V" << (int) r;
+        }
+        EXPECT_EQ(memcmp(batch.machine(i).memory.memory, machines[i]->memory.memory, 4096), 0) << "lane " << i;
+        EXPECT_EQ(memcmp(batch.machine(i).graphics.rows, machines[i]->graphics.rows,
+                         sizeof(machines[i]->graphics.rows)), 0) << "lane " << i;
+    }
+
+    // the lanes must actually have diverged for this test to mean anything
+    bool diverged = false;
+    for (size_t i = 1; i < lanes; ++i) {
+        diverged |= batch.pc(i) != batch.pc(0) || batch.dataRegister(i, 4) != batch.dataRegister(0, 4);
+    }
+    EXPECT_TRUE(diverged);
+}
+
+TEST(BatchCpuTest, QuirkProfiles) {
+    const size_t lanes = 9;
+    for (QuirkProfile quirks : {QuirkProfile::CosmacVip, QuirkProfile::SuperChip, QuirkProfile::Modern}) {
+        BatchCpu batch(lanes, DIVERGING_ROM, sizeof(DIVERGING_ROM), 7, quirks);
+
+        std::vector<std::unique_ptr<Machine>> machines;
+        for (size_t i = 0; i < lanes; ++i) {
+            machines.emplace_back(new Machine());
+            machines.back()->loadRom(DIVERGING_ROM, sizeof(DIVERGING_ROM));
+            machines.back()->cpu.seed(7 + (uint32_t) i);
+            machines.back()->cpu.setQuirks(quirks);
+        }
+
+        for (int step = 0; step < 1000; ++step) {
+            batch.step();
+            for (auto &machine : machines) {
+                machine->cpu.step();
+            }
+        }
+
+        for (size_t i = 0; i < lanes; ++i) {
+            Cpu &cpu = machines[i]->cpu;
+            EXPECT_EQ(batch.pc(i), cpu.pc) << quirkProfileName(quirks) << " lane " << i;
+            EXPECT_EQ(batch.instructionRegister(i), cpu.instruction_register) << quirkProfileName(quirks) << " lane " << i;
+            for (uint8_t r = 0; r < 16; ++r) {
+                EXPECT_EQ(batch.dataRegister(i, r), cpu.data_registers[r]) << quirkProfileName(quirks) << " lane " << i;
+            }
+        }
+    }
+}
+
+TEST(BatchCpuTest, Faults) {
+    // 0x00EE - Return with an empty call stack
+    const uint8_t rom[] = {0x00, 0xEE};
+    BatchCpu batch(3, rom, sizeof(rom), 0);
+
+    batch.step();
+    for (size_t i = 0; i < batch.size(); ++i) {
+        EXPECT_EQ(batch.state(i), State::StackUnderflow);
+        EXPECT_EQ(batch.pc(i), 0x200);
+        EXPECT_EQ(batch.cycles(i), 0);
+    }
+}
+
+TEST(BatchCpuTest, Timers) {
+    // every lane sets its delay timer to a random value and spins reading it back
+    const uint8_t rom[] = {
+            0xC0, 0x0F, // 0x200: V0 = random & 0x0F
+            0xF0, 0x15, // 0x202: delay = V0
+            0xF1, 0x07, // 0x204: V1 = delay
+            0x31, 0x00, // 0x206: Skip if V1 == 0
+            0x12, 0x04, // 0x208: Jump to 0x204
+            0x72, 0x01, // 0x20A: V2 += 1
+            0x12, 0x00, // 0x20C: Jump to 0x200
+    };
+    const size_t lanes = 9;
+    BatchCpu batch(lanes, rom, sizeof(rom), 7);
+
+    std::vector<std::unique_ptr<Machine>> machines;
+    for (size_t i = 0; i < lanes; ++i) {
+        machines.emplace_back(new Machine());
+        machines.back()->loadRom(rom, sizeof(rom));
+        machines.back()->cpu.seed(7 + (uint32_t) i);
+    }
+
+    for (int step = 0; step < 1000; ++step) {
+        batch.step();
+        for (auto &machine : machines) {
+            machine->cpu.step();
+        }
+    }
+
+    for (size_t i = 0; i < lanes; ++i) {
+        Cpu &cpu = machines[i]->cpu;
+        EXPECT_EQ(batch.pc(i), cpu.pc) << "lane " << i;
+        EXPECT_EQ(batch.delayTimer(i), cpu.delayTimer()) << "lane " << i;
+        EXPECT_EQ(batch.soundTimer(i), cpu.soundTimer()) << "lane " << i;
+        EXPECT_EQ(batch.dataRegister(i, 2), cpu.data_registers[2]) << "lane " << i;
+    }
+    EXPECT_GT(batch.dataRegister(0, 2), 0);
+}
@@ -0,0 +1,138 @@
+#pragma clang diagnostic push
+#pragma ide diagnostic ignored "cert-err58-cpp"
+
+#include <Rom.h>
+#include <chip8.h>
+#include <cstdio>
+#include <vector>
+#include "gtest/gtest.h"
+
+static const uint8_t ROM[] = {
+        0x60, 0x00, // 0x200: V0 = 0
+        0xF1, 0x0A, // 0x202: wait for a key into V1
+        0xF1, 0x29, // 0x204: I = sprite of digit V1
+        0xD0, 0x05, // 0x206: draw it at (0, 0)
+        0x70, 0x01, // 0x208: V0 += 1
+        0xA3, 0x00, // 0x20A: I = 0x300
+        0xF0, 0x55, // 0x20C: store V0 at 0x300
+        0x12, 0x0E, // 0x20E: jump to 0x20E
+};
+
+TEST(CApiTest, Observe) {
+    chip8_t *chip8 = chip8_create(1);
+    ASSERT_NE(chip8, nullptr);
+    ASSERT_EQ(chip8_load_rom(chip8, ROM, sizeof(ROM)), 1);
+    ASSERT_EQ(chip8_set_reward_region(chip8, 0x300, 1), 1);
+    EXPECT_EQ(chip8_set_quirks(chip8, 7), 0);
+    EXPECT_EQ(chip8_set_quirks(chip8, CHIP8_QUIRKS_MODERN), 1);
+
+    // observations are taken once and read after every step
+    const uint8_t *registers = chip8_registers(chip8);
+    const uint64_t *framebuffer = chip8_framebuffer(chip8);
+    size_t reward_size = 0;
+    const uint8_t *reward = chip8_reward(chip8, &reward_size);
+    EXPECT_EQ(reward_size, 1u);
+    EXPECT_EQ(reward, chip8_memory(chip8) + 0x300);
+
+    EXPECT_EQ(chip8_step_frames(chip8, 2, 0), CHIP8_WAITING_FOR_KEY);
+    EXPECT_EQ(chip8_cycles(chip8), 20u);
+    EXPECT_EQ(reward[0], 0);
+    EXPECT_EQ(framebuffer[0], 0u);
+
+    EXPECT_EQ(chip8_step_frames(chip8, 1, 1u << 5u), CHIP8_RUNNING);
+    EXPECT_EQ(registers[1], 5);
+    EXPECT_EQ(reward[0], 1);
+    EXPECT_EQ(framebuffer[0], 0xF000000000000000ull);
+    EXPECT_EQ(chip8_index_register(chip8), 0x300);
+    EXPECT_EQ(chip8_pc(chip8), 0x20E);
+    EXPECT_EQ(chip8_hires(chip8), 0);
+    EXPECT_EQ(registers, chip8_registers(chip8));
+
+    // a reset instance is indistinguishable from a new one
+    chip8_t *fresh = chip8_create(7);
+    chip8_load_rom(fresh, ROM, sizeof(ROM));
+    chip8_reset(chip8, 7);
+    EXPECT_EQ(chip8_state_hash(chip8), chip8_state_hash(fresh));
+    EXPECT_EQ(reward[0], 0);
+    EXPECT_EQ(chip8_step_frames(chip8, 1, 0), CHIP8_WAITING_FOR_KEY);
+
+    std::vector<uint8_t> large(4096);
+    EXPECT_EQ(chip8_load_rom(chip8, large.data(), large.size()), 0);
+    EXPECT_EQ(chip8_set_reward_region(chip8, 0xFFF, 2), 0);
+
+    chip8_destroy(fresh);
+    chip8_destroy(chip8);
+}
+
+TEST(CApiTest, Pool) {
+    const size_t count = 6;
+    chip8_pool_t *pool = chip8_pool_create(count, 10, 3);
+    ASSERT_NE(pool, nullptr);
+    EXPECT_EQ(chip8_pool_size(pool), count);
+    EXPECT_EQ(chip8_pool_instance(pool, count), nullptr);
+    ASSERT_EQ(chip8_pool_load_rom(pool, ROM, sizeof(ROM)), 1);
+
+    std::vector<uint16_t> inputs;
+    for (size_t i = 0; i < count; ++i) {
+        inputs.push_back((uint16_t) (i % 2 == 0 ? 1u << i : 0));
+    }
+    std::vector<int> states(count, -1);
+    chip8_pool_step_frames(pool, 1, nullptr, states.data());
+    chip8_pool_step_frames(pool, 3, inputs.data(), states.data());
+
+    // every instance matches one stepped on its own
+    for (size_t i = 0; i < count; ++i) {
+        chip8_t *single = chip8_create((uint32_t) (10 + i));
+        chip8_load_rom(single, ROM, sizeof(ROM));
+        chip8_step_frames(single, 1, 0);
+        EXPECT_EQ(states[i], chip8_step_frames(single, 3, inputs[i]));
+        EXPECT_EQ(chip8_state_hash(chip8_pool_instance(pool, i)), chip8_state_hash(single)) << "instance " << i;
+        chip8_destroy(single);
+    }
+    EXPECT_EQ(states[0], CHIP8_RUNNING);
+    EXPECT_EQ(states[1], CHIP8_WAITING_FOR_KEY);
+    EXPECT_EQ(chip8_registers(chip8_pool_instance(pool, 4))[1], 4);
+
+    chip8_pool_reset(pool, 10);
+    chip8_pool_step_frames(pool, 1, nullptr, states.data());
+    EXPECT_EQ(states[0], CHIP8_WAITING_FOR_KEY);
+    chip8_pool_destroy(pool);
+}
+
+TEST(CApiTest, QuirksDatabase) {
+    const uint8_t rom[] = {
+            0x61, 0x10, // 0x200: V1 = 0x10
+            0x62, 0x03, // 0x202: V2 = 3
+            0x81, 0x26, // 0x204: V1 = V2 >> 1 under the VIP's quirks, V1 >> 1 otherwise
+            0x12, 0x06, // 0x206: jump to 0x206
+    };
+    const char *path = "capi.test.quirks";
+    FILE *file = fopen(path, "w");
+    ASSERT_NE(file, nullptr);
+    fprintf(file, "%016llx vip shifts\n", (unsigned long long) romHash(rom, sizeof(rom)));
+    fclose(file);
+
+    chip8_t *chip8 = chip8_create(1);
+    ASSERT_NE(chip8, nullptr);
+    EXPECT_EQ(chip8_load_quirks_db(chip8, "capi.test.missing"), 0);
+    ASSERT_EQ(chip8_load_rom(chip8, rom, sizeof(rom)), 1);
+    chip8_step_frames(chip8, 1, 0);
+    EXPECT_EQ(chip8_registers(chip8)[1], 0x08);
+
+    ASSERT_EQ(chip8_load_quirks_db(chip8, path), 1);
+    ASSERT_EQ(chip8_load_rom(chip8, rom, sizeof(rom)), 1);
+    chip8_step_frames(chip8, 1, 0);
+    EXPECT_EQ(chip8_registers(chip8)[1], 0x01);
+    chip8_destroy(chip8);
+
+    chip8_pool_t *pool = chip8_pool_create(3, 1, 1);
+    ASSERT_NE(pool, nullptr);
+    ASSERT_EQ(chip8_pool_load_quirks_db(pool, path), 1);
+    ASSERT_EQ(chip8_pool_load_rom(pool, rom, sizeof(rom)), 1);
+    chip8_pool_step_frames(pool, 1, nullptr, nullptr);
+    for (size_t i = 0; i < 3; ++i) {
+        EXPECT_EQ(chip8_registers(chip8_pool_instance(pool, i))[1], 0x01) << "instance " << i;
+    }
+    chip8_pool_destroy(pool);
+    remove(path);
+}
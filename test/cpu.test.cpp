@@ -234,14 +234,14 @@ TEST(CpuTest, ARITHMETIC) {
     EXPECT_EQ(cpu.data_registers[5], (uint8_t) ((uint8_t) 100 - (uint8_t) 250));
     EXPECT_EQ(cpu.data_registers[0xF], 0);
 
-    // 0x8[5][1]6 - Store V1 << 1 in V5. Set VF to lowest bit of V1
+    // 0x8[5][1]6 - Shift V5 right by one, V1 is ignored. Set VF to the bit shifted out of V5
     memory[0x20E] = 0x85;
     memory[0x20F] = 0x16;
-    cpu.data_registers[5] = 4;
-    cpu.data_registers[1] = 1;
+    cpu.data_registers[5] = 5;
+    cpu.data_registers[1] = 2;
 
     cpu.step();
-    EXPECT_EQ(cpu.data_registers[5], 1u << 1u);
+    EXPECT_EQ(cpu.data_registers[5], 5u >> 1u);
     EXPECT_EQ(cpu.data_registers[0xF], 1);
 
     // 0x8[5][1]7 - VX = VY - VX; Set VF if borrow does not occur
@@ -264,3 +264,291 @@ TEST(CpuTest, ARITHMETIC) {
     EXPECT_EQ(cpu.data_registers[5],  (uint8_t) ((uint8_t) 170 - (uint8_t) 200));
     EXPECT_EQ(cpu.data_registers[0xF], 0);
 }
+
+TEST(CPUTest, SELF_MODIFYING_CODE) {
+    auto memory = Memory();
+    auto graphics = Graphics(memory);
+    auto input = Input();
+    Cpu cpu(memory, graphics, input, 0x200);
+
+    const uint8_t program[] = {
+            0x61, 0x05, // 0x200: V1 = 0x05
+            0xA2, 0x00, // 0x202: I = 0x200
+            0x60, 0x71, // 0x204: V0 = 0x71
+            0x61, 0x02, // 0x206: V1 = 0x02
+            0xF1, 0x55, // 0x208: Store V0-V1 at I, rewriting 0x200 to 0x7102 (V1 += 2)
+            0x12, 0x00, // 0x20A: Jump to 0x200
+    };
+    memory.load(0x200, program, sizeof(program));
+
+    for (int i = 0; i < 6; ++i) {
+        cpu.step();
+    }
+    EXPECT_EQ(cpu.pc, 0x200);
+    EXPECT_EQ(cpu.data_registers[1], 0x02);
+
+    // the instruction at 0x200 was decoded before it was overwritten, and must be decoded again
+    cpu.step();
+    EXPECT_EQ(cpu.data_registers[1], 0x04);
+}
+
+TEST(CPUTest, FAULTS) {
+    auto memory = Memory();
+    auto graphics = Graphics(memory);
+    auto input = Input();
+    Cpu cpu(memory, graphics, input, 0x200);
+
+    // 0x00EE - Return with an empty call stack
+    memory[0x200] = 0x00;
+    memory[0x201] = 0xEE;
+
+    EXPECT_EQ(cpu.step(), State::StackUnderflow);
+    EXPECT_EQ(cpu.pc, 0x200);
+    EXPECT_EQ(cpu.step(), State::StackUnderflow);
+
+    // 0x2[202] - Call the next instruction until the stack is exhausted
+    for (uint16_t addr = 0x200; addr < 0x200 + 2 * (Cpu::STACK_SIZE + 1); addr += 2) {
+        memory[addr] = 0x20u | ((addr + 2) >> 8u);
+        memory[addr + 1] = (addr + 2) & 0xFFu;
+    }
+    for (size_t i = 0; i < Cpu::STACK_SIZE; ++i) {
+        EXPECT_EQ(cpu.step(), State::Running);
+    }
+    EXPECT_EQ(cpu.step(), State::StackOverflow);
+    EXPECT_EQ(cpu.pc, 0x200 + 2 * Cpu::STACK_SIZE);
+
+    // 0x1[FFE] - Jump to the last instruction, then run off the end of memory
+    cpu.pc = 0x202;
+    memory[0x202] = 0x1F;
+    memory[0x203] = 0xFE;
+    EXPECT_EQ(cpu.run(10), State::PcOutOfBounds);
+    EXPECT_EQ(cpu.pc, 0x1000);
+    EXPECT_EQ(cpu.step(), State::PcOutOfBounds);
+}
+
+TEST(CPUTest, OPCODE_DXYN) {
+    auto memory = Memory();
+    auto graphics = Graphics(memory);
+    auto input = Input();
+    Cpu cpu(memory, graphics, input, 0x200);
+
+    // 0xA[300] - I = 0x300; 0xD[0][1]2 - Draw 2 rows at (V0, V1), twice
+    const uint8_t program[] = {0xA3, 0x00, 0xD0, 0x12, 0xD0, 0x12};
+    memory.load(0x200, program, sizeof(program));
+    memory[0x300] = 0xC0;
+    memory[0x301] = 0x01;
+    cpu.data_registers[0] = 10;
+    cpu.data_registers[1] = 20;
+
+    cpu.step();
+    cpu.step();
+    EXPECT_EQ(cpu.data_registers[0xF], 0);
+    EXPECT_EQ(graphics.get(10, 20), 1);
+    EXPECT_EQ(graphics.get(11, 20), 1);
+    EXPECT_EQ(graphics.get(12, 20), 0);
+    EXPECT_EQ(graphics.get(17, 21), 1);
+
+    cpu.step();
+    EXPECT_EQ(cpu.data_registers[0xF], 1);
+    EXPECT_EQ(graphics.get(10, 20), 0);
+    EXPECT_EQ(graphics.get(17, 21), 0);
+}
+
+TEST(CPUTest, SUPER_CHIP) {
+    auto memory = Memory();
+    auto graphics = Graphics(memory);
+    auto input = Input();
+    Cpu cpu(memory, graphics, input, 0x200);
+
+    const uint8_t program[] = {
+            0x00, 0xFF, // 0x200: 128x64 mode
+            0xA3, 0x00, // 0x202: I = 0x300
+            0xD0, 0x10, // 0x204: Draw a 16x16 sprite at (V0, V1)
+            0x00, 0xC3, // 0x206: Scroll down 3 rows
+            0x00, 0xFB, // 0x208: Scroll right 4 pixels
+            0x00, 0xFC, // 0x20A: Scroll left 4 pixels, twice
+            0x00, 0xFC,
+            0x00, 0xFE, // 0x20E: 64x32 mode
+    };
+    memory.load(0x200, program, sizeof(program));
+    memory[0x300] = 0x80;
+    memory[0x301] = 0x01;
+    memory[0x31E] = 0xFF;
+    memory[0x31F] = 0xFF;
+    cpu.data_registers[0] = 100;
+    cpu.data_registers[1] = 40;
+
+    cpu.step();
+    EXPECT_TRUE(graphics.isHires());
+    EXPECT_EQ(graphics.width(), 128);
+
+    cpu.step();
+    cpu.step();
+    EXPECT_EQ(cpu.data_registers[0xF], 0);
+    EXPECT_EQ(graphics.get(100, 40), 1);
+    EXPECT_EQ(graphics.get(115, 40), 1);
+    EXPECT_EQ(graphics.get(101, 40), 0);
+    EXPECT_EQ(graphics.get(108, 55), 1);
+
+    cpu.step();
+    EXPECT_EQ(graphics.get(100, 43), 1);
+    EXPECT_EQ(graphics.get(100, 40), 0);
+
+    cpu.step();
+    EXPECT_EQ(graphics.get(104, 43), 1);
+    EXPECT_EQ(graphics.get(119, 43), 1);
+
+    cpu.step();
+    cpu.step();
+    EXPECT_EQ(graphics.get(96, 43), 1);
+    EXPECT_EQ(graphics.get(111, 58), 1);
+
+    cpu.step();
+    EXPECT_FALSE(graphics.isHires());
+    EXPECT_EQ(graphics.width(), 64);
+}
+
+TEST(CPUTest, OPCODE_FX29) {
+    auto memory = Memory();
+    auto graphics = Graphics(memory);
+    auto input = Input();
+    Cpu cpu(memory, graphics, input, 0x200);
+
+    // 0xF[3]29 - I = sprite of the digit in V3, twice
+    const uint8_t program[] = {0xF3, 0x29, 0xF3, 0x29};
+    memory.load(0x200, program, sizeof(program));
+    cpu.data_registers[3] = 0xB;
+
+    cpu.step();
+    EXPECT_EQ(cpu.instruction_register, 0xB * 5);
+
+    // only the low nibble selects the digit
+    cpu.data_registers[3] = 0x17;
+    cpu.step();
+    EXPECT_EQ(cpu.instruction_register, 0x7 * 5);
+}
+
+TEST(CPUTest, TIMERS) {
+    auto memory = Memory();
+    auto graphics = Graphics(memory);
+    auto input = Input();
+    Cpu cpu(memory, graphics, input, 0x200);
+
+    // 0x6[0]05 - V0 = 5; 0xF[0]15 - delay = V0; 0xF[0]18 - sound = V0; 0x1[206] - Jump to itself
+    const uint8_t program[] = {0x60, 0x05, 0xF0, 0x15, 0xF0, 0x18, 0x12, 0x06};
+    memory.load(0x200, program, sizeof(program));
+    cpu.setCyclesPerFrame(4);
+
+    cpu.run(3);
+    EXPECT_EQ(cpu.delayTimer(), 5);
+    EXPECT_EQ(cpu.soundTimer(), 5);
+
+    // the timers tick once every 4 cycles
+    cpu.step();
+    EXPECT_EQ(cpu.delayTimer(), 4);
+    cpu.run(3);
+    EXPECT_EQ(cpu.delayTimer(), 4);
+    cpu.step();
+    EXPECT_EQ(cpu.delayTimer(), 3);
+
+    // 0xF[1]07 - V1 = delay
+    memory[0x206] = 0xF1;
+    memory[0x207] = 0x07;
+    cpu.step();
+    EXPECT_EQ(cpu.data_registers[1], 3);
+
+    cpu.pc = 0x206;
+    cpu.run(100);
+    EXPECT_EQ(cpu.cycles, 109);
+    EXPECT_EQ(cpu.delayTimer(), 0);
+    EXPECT_EQ(cpu.soundTimer(), 0);
+}
+
+static void expectSameCpu(const Cpu &a, const Cpu &b) {
+    EXPECT_EQ(a.pc, b.pc);
+    EXPECT_EQ(a.cycles, b.cycles);
+    EXPECT_EQ(a.delayTimer(), b.delayTimer());
+    EXPECT_EQ(a.soundTimer(), b.soundTimer());
+    EXPECT_EQ(a.snapshot().frame_countdown, b.snapshot().frame_countdown);
+    EXPECT_EQ(a.snapshot().waiting_for_key, b.snapshot().waiting_for_key);
+    for (int i = 0; i < 16; ++i) {
+        EXPECT_EQ(a.data_registers[i], b.data_registers[i]);
+    }
+}
+
+TEST(CPUTest, IDLE_LOOPS) {
+    // 0x6[0]NN - V0 = delay; 0xF[0]15 - delay = V0; 0xF[1]18 - sound = V1; then one of the loops at 0x206
+    const uint16_t loops[][3] = {
+            {0xF207, 0x3200, 0x1206}, // wait for the delay timer to reach 0
+            {0xF207, 0x3203, 0x1206}, // wait for it to reach 3
+            {0xF207, 0x4200, 0x1206}, // wait for it to leave 0
+            {0xF207, 0x4205, 0x1206}, // wait for it to leave 5
+            {0xF207, 0x3209, 0x1206}, // wait for 9, which may already have passed
+            {0x1206, 0x0000, 0x0000}, // halt
+            {0xE39E, 0x1206, 0x0000}, // wait for key V3
+            {0xE3A1, 0x1206, 0x0000}, // wait for key V3 to be released
+            {0xF40A, 0x1206, 0x0000}, // wait for any key
+    };
+
+    for (auto &loop : loops) {
+        for (uint8_t delay : {0, 1, 5, 9, 30}) {
+            for (uint32_t cycles_per_frame : {1, 2, 3, 7, 10}) {
+                for (bool pressed : {false, true}) {
+                    SCOPED_TRACE(testing::Message() << std::hex << loop[0] << std::dec << " delay " << (int) delay
+                                                    << " cpf " << cycles_per_frame << " pressed " << pressed);
+                    auto memory = Memory();
+                    auto graphics = Graphics(memory);
+                    auto input = Input();
+                    const uint8_t program[] = {0x60, delay, 0xF0, 0x15, 0xF1, 0x18,
+                                               (uint8_t) (loop[0] >> 8u), (uint8_t) loop[0],
+                                               (uint8_t) (loop[1] >> 8u), (uint8_t) loop[1],
+                                               (uint8_t) (loop[2] >> 8u), (uint8_t) loop[2],
+                                               0x12, 0x0C};
+                    memory.load(0x200, program, sizeof(program));
+                    if (pressed) {
+                        input.onKeyDown(7);
+                        input.clearTriggered();
+                    }
+
+                    Cpu fast(memory, graphics, input, 0x200);
+                    Cpu slow(memory, graphics, input, 0x200);
+                    for (Cpu *cpu : {&fast, &slow}) {
+                        cpu->setCyclesPerFrame(cycles_per_frame);
+                        cpu->data_registers[1] = 200;
+                        cpu->data_registers[3] = 7;
+                    }
+
+                    // uneven slices end runs in the middle of a loop, too
+                    for (uint64_t slice : {1, 2, 10, 100, 1000, 3, 50000}) {
+                        fast.run(slice);
+                        for (uint64_t i = 0; i < slice; ++i) {
+                            slow.step();
+                        }
+                        expectSameCpu(fast, slow);
+                    }
+                }
+            }
+        }
+    }
+
+    // a wait restored into a fresh cpu ends on a key press without anything having been fetched yet
+    auto memory = Memory();
+    auto graphics = Graphics(memory);
+    auto input = Input();
+    const uint8_t program[] = {0xF4, 0x0A, 0x12, 0x02};
+    memory.load(0x200, program, sizeof(program));
+    Cpu waiting(memory, graphics, input, 0x200);
+    EXPECT_EQ(waiting.run(10), State::WaitingForKey);
+
+    Cpu fast(memory, graphics, input, 0x200);
+    Cpu slow(memory, graphics, input, 0x200);
+    ASSERT_TRUE(fast.restore(waiting.snapshot()));
+    ASSERT_TRUE(slow.restore(waiting.snapshot()));
+    input.onKeyDown(5);
+    EXPECT_EQ(fast.run(10), State::Running);
+    for (int i = 0; i < 10; ++i) {
+        slow.step();
+    }
+    expectSameCpu(fast, slow);
+    EXPECT_EQ(fast.data_registers[4], 5);
+}
@@ -0,0 +1,217 @@
+#pragma clang diagnostic push
+#pragma ide diagnostic ignored "cert-err58-cpp"
+
+#include <FrameStream.h>
+#include <Image.h>
+#include <Machine.h>
+#include <cstdio>
+#include <cstring>
+#include "gtest/gtest.h"
+
+TEST(FrameStreamTest, Roundtrip) {
+    Machine machine;
+    Graphics &graphics = machine.graphics;
+    const uint8_t sprite[] = {0xF0, 0x90, 0xF0};
+
+    FILE *file = tmpfile();
+    ASSERT_NE(file, nullptr);
+    FrameRecorder recorder;
+    ASSERT_TRUE(recorder.open(file, 600));
+
+    uint64_t expected[3][Graphics::HEIGHT];
+    graphics.draw(3, 5, sprite, 3);
+    ASSERT_TRUE(recorder.capture(graphics, 10));
+    std::memcpy(expected[0], graphics.rows, sizeof(graphics.rows));
+
+    // unchanged frames are dropped
+    ASSERT_TRUE(recorder.capture(graphics, 20));
+
+    graphics.draw(60, 30, sprite, 3);
+    ASSERT_TRUE(recorder.capture(graphics, 30));
+    std::memcpy(expected[1], graphics.rows, sizeof(graphics.rows));
+
+    graphics.clear();
+    ASSERT_TRUE(recorder.capture(graphics, 1000));
+    std::memcpy(expected[2], graphics.rows, sizeof(graphics.rows));
+
+    ASSERT_TRUE(recorder.flush());
+    EXPECT_EQ(recorder.frames(), 3u);
+
+    rewind(file);
+    FrameReader reader;
+    ASSERT_TRUE(reader.open(file));
+    EXPECT_EQ(reader.cyclesPerSecond(), 600u);
+
+    const uint64_t cycles[] = {10, 30, 1000};
+    uint64_t cycle;
+    Graphics::Screen screen;
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_TRUE(reader.next(cycle, screen));
+        EXPECT_EQ(cycle, cycles[i]);
+        EXPECT_FALSE(screen.hires);
+        EXPECT_EQ(std::memcmp(screen.rows, expected[i], sizeof(screen.rows)), 0);
+    }
+    EXPECT_FALSE(reader.next(cycle, screen));
+    fclose(file);
+}
+
+TEST(FrameStreamTest, RoundtripHires) {
+    Machine machine;
+    Graphics &graphics = machine.graphics;
+    const uint8_t sprite[] = {0xF0, 0x90, 0xF0};
+
+    FILE *file = tmpfile();
+    ASSERT_NE(file, nullptr);
+    FrameRecorder recorder;
+    ASSERT_TRUE(recorder.open(file, 600));
+
+    graphics.draw(3, 5, sprite, 3);
+    ASSERT_TRUE(recorder.capture(graphics, 10));
+    uint64_t lores[Graphics::HEIGHT];
+    std::memcpy(lores, graphics.rows, sizeof(lores));
+
+    // switching modes is a new frame, even while the high resolution screen is blank
+    graphics.setHires(true);
+    ASSERT_TRUE(recorder.capture(graphics, 20));
+    graphics.draw(120, 60, sprite, 3);
+    ASSERT_TRUE(recorder.capture(graphics, 30));
+    uint64_t hires[Graphics::HIRES_HEIGHT][2];
+    std::memcpy(hires, graphics.hires_rows, sizeof(hires));
+    ASSERT_TRUE(recorder.capture(graphics, 40));
+
+    graphics.setHires(false);
+    ASSERT_TRUE(recorder.capture(graphics, 50));
+    ASSERT_TRUE(recorder.flush());
+    EXPECT_EQ(recorder.frames(), 4u);
+
+    rewind(file);
+    FrameReader reader;
+    ASSERT_TRUE(reader.open(file));
+    uint64_t cycle;
+    Graphics::Screen screen;
+    const uint64_t cycles[] = {10, 20, 30, 50};
+    const bool modes[] = {false, true, true, false};
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(reader.next(cycle, screen));
+        EXPECT_EQ(cycle, cycles[i]);
+        EXPECT_EQ(screen.hires, modes[i]);
+        EXPECT_EQ(std::memcmp(screen.rows, lores, sizeof(lores)), 0);
+    }
+    EXPECT_EQ(std::memcmp(screen.hires_rows, hires, sizeof(hires)), 0);
+    EXPECT_FALSE(reader.next(cycle, screen));
+    fclose(file);
+}
+
+TEST(FrameStreamTest, ReadsVersion1) {
+    FILE *file = tmpfile();
+    ASSERT_NE(file, nullptr);
+    // the header, then a frame at cycle 5 with only the top left pixel set and no mode byte
+    const uint8_t stream[] = {'C', '8', 'F', 'S', 1, 0, 64, 0, 32, 0, 0, 0, 0x58, 0x02, 0, 0,
+                              0x05, 0x00, 0x01, 0x80, 0xFF, 0x01, 0x00};
+    fwrite(stream, 1, sizeof(stream), file);
+    rewind(file);
+
+    FrameReader reader;
+    ASSERT_TRUE(reader.open(file));
+    EXPECT_EQ(reader.cyclesPerSecond(), 600u);
+    uint64_t cycle;
+    Graphics::Screen screen;
+    ASSERT_TRUE(reader.next(cycle, screen));
+    EXPECT_EQ(cycle, 5u);
+    EXPECT_FALSE(screen.hires);
+    EXPECT_EQ(screen.rows[0], 1ull << 63u);
+    EXPECT_FALSE(reader.next(cycle, screen));
+    fclose(file);
+}
+
+TEST(FrameStreamTest, RejectsOtherFiles) {
+    FILE *file = tmpfile();
+    ASSERT_NE(file, nullptr);
+    fputs("C8SS not a frame stream", file);
+    rewind(file);
+
+    FrameReader reader;
+    EXPECT_FALSE(reader.open(file));
+    fclose(file);
+}
+
+TEST(FrameStreamTest, RejectsEmptyRuns) {
+    FILE *file = tmpfile();
+    ASSERT_NE(file, nullptr);
+    FrameRecorder recorder;
+    ASSERT_TRUE(recorder.open(file, 600));
+    // a frame at cycle 0 whose first run has no zero and no literal bytes
+    const uint8_t record[] = {0x00, 0x00, 0x00, 0x00};
+    fwrite(record, 1, sizeof(record), file);
+    rewind(file);
+
+    FrameReader reader;
+    ASSERT_TRUE(reader.open(file));
+    uint64_t cycle;
+    Graphics::Screen screen;
+    EXPECT_FALSE(reader.next(cycle, screen));
+    fclose(file);
+}
+
+TEST(ImageTest, Checksums) {
+    EXPECT_EQ(crc32(reinterpret_cast<const uint8_t *>("IEND"), 4), 0xAE426082u);
+    EXPECT_EQ(adler32(reinterpret_cast<const uint8_t *>("Wikipedia"), 9), 0x11E60398u);
+}
+
+TEST(ImageTest, RenderRows) {
+    uint64_t rows[2] = {1ull << 63u, 1};
+    IndexedImage image = renderRows(rows, 64, 2, 2);
+    ASSERT_EQ(image.width, 128);
+    ASSERT_EQ(image.height, 4);
+    EXPECT_EQ(image.pixels[0], 1);
+    EXPECT_EQ(image.pixels[1 + 128], 1);
+    EXPECT_EQ(image.pixels[2], 0);
+    EXPECT_EQ(image.pixels[127 + 128 * 3], 1);
+    EXPECT_EQ(image.pixels[125 + 128 * 3], 0);
+
+    uint64_t hires_rows[1][2] = {{1, 1ull << 63u}};
+    image = renderRows(hires_rows, 128, 1, 1);
+    ASSERT_EQ(image.width, 128);
+    EXPECT_EQ(image.pixels[63], 1);
+    EXPECT_EQ(image.pixels[64], 1);
+    EXPECT_EQ(image.pixels[62] + image.pixels[65] + image.pixels[127], 0);
+}
+
+static std::vector<uint8_t> contents(FILE *file) {
+    std::vector<uint8_t> data;
+    rewind(file);
+    int c;
+    while ((c = fgetc(file)) != EOF) {
+        data.push_back((uint8_t) c);
+    }
+    return data;
+}
+
+TEST(ImageTest, WritesPngAndGif) {
+    uint64_t rows[Graphics::HEIGHT] = {0xF0F0F0F0F0F0F0F0ull};
+    IndexedImage image = renderRows(rows, Graphics::WIDTH, Graphics::HEIGHT, 4);
+
+    FILE *png = tmpfile();
+    ASSERT_NE(png, nullptr);
+    ASSERT_TRUE(writePng(png, image));
+    std::vector<uint8_t> data = contents(png);
+    fclose(png);
+    ASSERT_GT(data.size(), 8u + image.pixels.size());
+    EXPECT_EQ(std::memcmp(data.data(), "\x89PNG\r\n\x1A\n", 8), 0);
+    EXPECT_EQ(std::memcmp(data.data() + data.size() - 12, "\0\0\0\0IEND\xAE\x42\x60\x82", 12), 0);
+
+    FILE *gif = tmpfile();
+    ASSERT_NE(gif, nullptr);
+    GifWriter writer;
+    ASSERT_TRUE(writer.open(gif, image.width, image.height, image.palette));
+    ASSERT_TRUE(writer.addFrame(image, 2));
+    rows[5] = ~0ull;
+    ASSERT_TRUE(writer.addFrame(renderRows(rows, Graphics::WIDTH, Graphics::HEIGHT, 4), 2));
+    ASSERT_TRUE(writer.close());
+    data = contents(gif);
+    fclose(gif);
+    EXPECT_EQ(std::memcmp(data.data(), "GIF89a", 6), 0);
+    EXPECT_EQ(data.back(), 0x3B);
+}
+
+#pragma clang diagnostic pop
@@ -0,0 +1,255 @@
+#pragma clang diagnostic push
+#pragma ide diagnostic ignored "cert-err58-cpp"
+
+#include <Graphics.h>
+#include <algorithm>
+#include "gtest/gtest.h"
+
+TEST(GraphicsTest, DrawXorsAndDetectsCollisions) {
+    auto memory = Memory();
+    auto graphics = Graphics(memory);
+
+    const uint8_t sprite[] = {0xF0, 0x90};
+
+    EXPECT_EQ(graphics.draw(4, 2, sprite, 2), 0);
+    EXPECT_EQ(graphics.rows[2], (uint64_t) 0xF0 << 52u);
+    EXPECT_EQ(graphics.rows[3], (uint64_t) 0x90 << 52u);
+    EXPECT_EQ(graphics.get(4, 2), 1);
+    EXPECT_EQ(graphics.get(5, 3), 0);
+
+    // drawing the same sprite again erases it
+    EXPECT_EQ(graphics.draw(4, 2, sprite, 2), 1);
+    EXPECT_EQ(graphics.rows[2], 0u);
+    EXPECT_EQ(graphics.rows[3], 0u);
+}
+
+TEST(GraphicsTest, DrawWrapsAroundEdges) {
+    auto memory = Memory();
+    auto graphics = Graphics(memory);
+
+    const uint8_t sprite[] = {0xFF, 0x81};
+
+    // starting coordinates wrap, and so do the pixels past the right and bottom edges
+    graphics.draw(60 + 64, 31, sprite, 2);
+    for (int x = 60; x < 64; ++x) {
+        EXPECT_EQ(graphics.get(x, 31), 1);
+    }
+    for (int x = 0; x < 4; ++x) {
+        EXPECT_EQ(graphics.get(x, 31), 1);
+    }
+    EXPECT_EQ(graphics.get(4, 31), 0);
+    EXPECT_EQ(graphics.get(60, 0), 1);
+    EXPECT_EQ(graphics.get(3, 0), 1);
+    EXPECT_EQ(graphics.get(61, 0), 0);
+}
+
+TEST(GraphicsTest, ToARGB) {
+    auto memory = Memory();
+    auto graphics = Graphics(memory);
+
+    graphics.set(0, 0, 1);
+    graphics.set(63, 31, 1);
+
+    uint32_t pixels[Graphics::WIDTH * Graphics::HEIGHT];
+    graphics.toARGB(pixels);
+
+    EXPECT_EQ(pixels[0], Graphics::SET_VAL);
+    EXPECT_EQ(pixels[1], Graphics::UNSET_VAL);
+    EXPECT_EQ(pixels[Graphics::WIDTH * Graphics::HEIGHT - 1], Graphics::SET_VAL);
+    EXPECT_EQ(pixels[Graphics::WIDTH * Graphics::HEIGHT - 2], Graphics::UNSET_VAL);
+}
+
+TEST(GraphicsTest, HiresDrawWrapsAcrossHalves) {
+    auto memory = Memory();
+    auto graphics = Graphics(memory);
+    graphics.setHires(true);
+
+    const uint8_t sprite[] = {0xFF};
+
+    // pixels cross from the left half of the row into the right one, and past the right edge
+    EXPECT_EQ(graphics.draw(60, 63, sprite, 1), 0);
+    EXPECT_EQ(graphics.hires_rows[63][0], 0xFull);
+    EXPECT_EQ(graphics.hires_rows[63][1], 0xFull << 60u);
+    graphics.draw(124 + 128, 63, sprite, 1);
+    EXPECT_EQ(graphics.hires_rows[63][0], (0xFull << 60u) | 0xFull);
+    EXPECT_EQ(graphics.hires_rows[63][1], (0xFull << 60u) | 0xFull);
+    EXPECT_EQ(graphics.draw(0, 63 + 64, sprite, 1), 1);
+
+    // the 64x32 screen is kept separately
+    EXPECT_EQ(graphics.rows[31], 0u);
+    graphics.setHires(false);
+    EXPECT_EQ(graphics.get(0, 31), 0);
+}
+
+TEST(GraphicsTest, DrawLarge) {
+    auto memory = Memory();
+    auto graphics = Graphics(memory);
+
+    uint8_t sprite[32] = {};
+    sprite[0] = 0x80;
+    sprite[31] = 0x01;
+
+    EXPECT_EQ(graphics.drawLarge(56, 20, sprite), 0);
+    EXPECT_EQ(graphics.get(56, 20), 1);
+    EXPECT_EQ(graphics.get(7, 35), 1);
+    EXPECT_EQ(graphics.drawLarge(56, 20, sprite), 1);
+    EXPECT_EQ(graphics.rows[20], 0u);
+}
+
+TEST(GraphicsTest, DrawClipsAtEdges) {
+    auto memory = Memory();
+    auto graphics = Graphics(memory);
+
+    const uint8_t sprite[] = {0xFF, 0xFF, 0xFF};
+    graphics.clearDirty();
+
+    // the starting coordinates still wrap, but the pixels past the right and bottom edges are cut off
+    EXPECT_EQ(graphics.draw<true>(60 + 64, 30, sprite, 3), 0);
+    EXPECT_EQ(graphics.rows[30], 0xFull);
+    EXPECT_EQ(graphics.rows[31], 0xFull);
+    EXPECT_EQ(graphics.rows[0], 0u);
+    EXPECT_EQ(graphics.dirtyRows(), 3ull << 30u);
+
+    uint8_t large[32];
+    std::fill(large, large + 32, 0xFF);
+    EXPECT_EQ(graphics.drawLarge<true>(56, 24, large), 1);
+    EXPECT_EQ(graphics.rows[24], 0xFFull);
+    EXPECT_EQ(graphics.rows[31], 0xF0ull);
+    EXPECT_EQ(graphics.rows[0], 0u);
+
+    graphics.setHires(true);
+    EXPECT_EQ(graphics.drawLarge<true>(120, 60, large), 0);
+    EXPECT_EQ(graphics.hires_rows[60][1], 0xFFull);
+    EXPECT_EQ(graphics.hires_rows[63][1], 0xFFull);
+    EXPECT_EQ(graphics.hires_rows[60][0], 0u);
+    EXPECT_EQ(graphics.hires_rows[0][1], 0u);
+    EXPECT_EQ(graphics.draw<true>(60, 63, sprite, 3), 0);
+    EXPECT_EQ(graphics.hires_rows[63][0], 0xFull);
+    EXPECT_EQ(graphics.hires_rows[63][1], (0xFull << 60u) | 0xFFull);
+}
+
+TEST(GraphicsTest, Scroll) {
+    auto memory = Memory();
+    auto graphics = Graphics(memory);
+
+    for (bool hires : {false, true}) {
+        graphics.setHires(hires);
+        int w = graphics.width(), h = graphics.height();
+        graphics.clear();
+        graphics.set(w / 2 - 2, 0, 1);
+        graphics.set(w - 1, h - 1, 1);
+
+        graphics.scrollDown(1);
+        EXPECT_EQ(graphics.get(w / 2 - 2, 1), 1);
+        EXPECT_EQ(graphics.get(w / 2 - 2, 0), 0);
+        EXPECT_EQ(graphics.get(w - 1, 0), 0);
+
+        // crosses the halves of a hi-res row
+        graphics.scrollRight();
+        EXPECT_EQ(graphics.get(w / 2 + 2, 1), 1);
+        graphics.scrollLeft();
+        graphics.scrollLeft();
+        EXPECT_EQ(graphics.get(w / 2 - 6, 1), 1);
+        EXPECT_EQ(graphics.get(w / 2 + 2, 1), 0);
+
+        graphics.scrollDown(200);
+        EXPECT_EQ(graphics.get(w / 2 - 6, 1), 0);
+    }
+}
+
+TEST(GraphicsTest, HiresToARGB) {
+    auto memory = Memory();
+    auto graphics = Graphics(memory);
+    graphics.setHires(true);
+
+    graphics.set(64, 0, 1);
+    graphics.set(127, 63, 1);
+
+    uint32_t pixels[Graphics::HIRES_WIDTH * Graphics::HIRES_HEIGHT];
+    graphics.toARGB(pixels);
+
+    EXPECT_EQ(pixels[63], Graphics::UNSET_VAL);
+    EXPECT_EQ(pixels[64], Graphics::SET_VAL);
+    EXPECT_EQ(pixels[Graphics::HIRES_WIDTH * Graphics::HIRES_HEIGHT - 1], Graphics::SET_VAL);
+    EXPECT_EQ(pixels[Graphics::HIRES_WIDTH * Graphics::HIRES_HEIGHT - 2], Graphics::UNSET_VAL);
+}
+
+TEST(GraphicsTest, DirtyRows) {
+    auto memory = Memory();
+    auto graphics = Graphics(memory);
+
+    // nothing was rendered yet, so everything differs
+    EXPECT_EQ(graphics.changedRows(), 0xFFFFFFFFull);
+    graphics.clearDirty();
+    EXPECT_FALSE(graphics.isDirty());
+    EXPECT_EQ(graphics.changedRows(), 0u);
+
+    // rows wrap around the bottom edge
+    const uint8_t sprite[] = {0x80, 0x80, 0x80};
+    graphics.draw(0, 30, sprite, 3);
+    EXPECT_EQ(graphics.dirtyRows(), (3ull << 30u) | 1u);
+    EXPECT_EQ(graphics.changedRows(), (3ull << 30u) | 1u);
+
+    uint64_t rows = graphics.changedRows();
+    int first, count;
+    ASSERT_TRUE(Graphics::nextSpan(rows, first, count));
+    EXPECT_EQ(first, 0);
+    EXPECT_EQ(count, 1);
+    ASSERT_TRUE(Graphics::nextSpan(rows, first, count));
+    EXPECT_EQ(first, 30);
+    EXPECT_EQ(count, 2);
+    EXPECT_FALSE(Graphics::nextSpan(rows, first, count));
+
+    // drawing and erasing touches rows without changing them
+    graphics.clearDirty();
+    graphics.draw(10, 5, sprite, 2);
+    graphics.draw(10, 5, sprite, 2);
+    EXPECT_TRUE(graphics.isDirty());
+    EXPECT_EQ(graphics.dirtyRows(), 3ull << 5u);
+    EXPECT_EQ(graphics.changedRows(), 0u);
+
+    graphics.set(3, 7, 1);
+    EXPECT_EQ(graphics.changedRows(), 1ull << 7u);
+
+    // a mode switch changes every row of the new mode
+    graphics.clearDirty();
+    graphics.setHires(true);
+    EXPECT_EQ(graphics.changedRows(), ~0ull);
+    graphics.clearDirty();
+    uint8_t large[32] = {0x80};
+    large[8] = 0x01;
+    graphics.drawLarge(0, 60, large);
+    EXPECT_EQ(graphics.dirtyRows(), (0xFull << 60u) | 0xFFFu);
+    EXPECT_EQ(graphics.changedRows(), (1ull << 60u) | 1u);
+}
+
+TEST(GraphicsTest, CopyScreen) {
+    auto memory = Memory();
+    auto graphics = Graphics(memory);
+    auto other_memory = Memory();
+    auto copy = Graphics(other_memory);
+    const uint8_t sprite[] = {0xF0, 0x90};
+    Graphics::Screen screen;
+
+    graphics.draw(10, 5, sprite, 2);
+    graphics.copyTo(screen);
+    copy.clearDirty();
+    copy.copyFrom(screen);
+    EXPECT_EQ(copy.changedRows(), 3ull << 5u);
+    EXPECT_EQ(copy.get(10, 5), 1);
+    EXPECT_EQ(copy.get(11, 6), 0);
+
+    // only rows that differ from the last copy count as changed
+    copy.clearDirty();
+    graphics.set(0, 20, 1);
+    graphics.copyTo(screen);
+    copy.copyFrom(screen);
+    EXPECT_EQ(copy.changedRows(), 1ull << 20u);
+
+    graphics.setHires(true);
+    graphics.set(100, 60, 1);
+    graphics.copyTo(screen);
+    copy.copyFrom(screen);
+    EXPECT_TRUE(copy.isHires());
+    EXPECT_EQ(copy.get(100, 60), 1);
+}
@@ -0,0 +1,127 @@
+#pragma clang diagnostic push
+#pragma ide diagnostic ignored "cert-err58-cpp"
+
+#include <InputLog.h>
+#include <Machine.h>
+#include <Rom.h>
+#include <cstdio>
+#include <memory>
+#include "gtest/gtest.h"
+
+// Waits for a key, mixes it with a random number, draws and checks whether key 5 is held
+static const uint8_t ROM[] = {
+        0xC0, 0xFF, // 0x200: V0 = random
+        0xF1, 0x0A, // 0x202: V1 = wait for key
+        0x80, 0x14, // 0x204: V0 += V1
+        0xA2, 0x20, // 0x206: I = 0x220
+        0xD0, 0x15, // 0x208: Draw 5 rows at (V0, V1)
+        0x62, 0x05, // 0x20A: V2 = 5
+        0xE2, 0x9E, // 0x20C: Skip if key V2 is pressed
+        0x73, 0x01, // 0x20E: V3 += 1
+        0x12, 0x00, // 0x210: Jump to 0x200
+        0x00, 0x00,
+        0x00, 0x00,
+        0x00, 0x00,
+        0x00, 0x00,
+        0x00, 0x00,
+        0x00, 0x00,
+        0x00, 0x00,
+        0xF0, 0x90, 0x90, 0x90, 0xF0, // 0x220: sprite
+};
+
+static std::unique_ptr<Machine> newMachine() {
+    std::unique_ptr<Machine> machine(new Machine());
+    machine->loadRom(ROM, sizeof(ROM));
+    return machine;
+}
+
+// A session with a few key presses at odd cycles, as they would arrive from SDL
+static void record(Machine &machine, InputLog &log) {
+    machine.cpu.setCyclesPerFrame(12);
+    machine.cpu.setQuirks(QuirkProfile::SuperChip);
+    log.start(machine, romHash(ROM, sizeof(ROM)), 1234);
+
+    const uint8_t keys[] = {5, 5, 0xA, 3, 5};
+    for (uint8_t key : keys) {
+        machine.cpu.run(997);
+        log.record(machine, key, true);
+        machine.input.onKeyDown(key);
+        machine.cpu.run(31);
+        log.record(machine, key, false);
+        machine.input.onKeyUp(key);
+    }
+    machine.cpu.run(500);
+    log.finish(machine);
+}
+
+TEST(InputLogTest, ReplayReproducesSession) {
+    auto original = newMachine();
+    InputLog log;
+    record(*original, log);
+    EXPECT_EQ(log.events().size(), 10u);
+    EXPECT_EQ(log.endCycle(), original->cpu.cycles);
+    EXPECT_EQ(log.finalHash(), original->stateHash());
+
+    auto replayed = newMachine();
+    EXPECT_FALSE(isFault(replay(log, *replayed)));
+    EXPECT_EQ(replayed->cpu.cycles, log.endCycle());
+    EXPECT_EQ(replayed->stateHash(), log.finalHash());
+}
+
+TEST(InputLogTest, ReplayDependsOnEvents) {
+    auto original = newMachine();
+    InputLog log;
+    record(*original, log);
+
+    // the same session without input stays waiting for the first key
+    InputLog silent;
+    auto machine = newMachine();
+    machine->cpu.setCyclesPerFrame(12);
+    silent.start(*machine, log.romHash(), log.seed());
+    machine->cpu.run(log.endCycle());
+    silent.finish(*machine);
+
+    auto replayed = newMachine();
+    replay(silent, *replayed);
+    EXPECT_EQ(replayed->stateHash(), silent.finalHash());
+    EXPECT_NE(silent.finalHash(), log.finalHash());
+}
+
+TEST(InputLogTest, SaveLoad) {
+    auto original = newMachine();
+    InputLog log;
+    record(*original, log);
+
+    const char *path = "inputlog.test.c8il";
+    ASSERT_TRUE(log.save(path));
+    InputLog loaded;
+    ASSERT_TRUE(loaded.load(path));
+    EXPECT_EQ(loaded.seed(), 1234u);
+    EXPECT_EQ(loaded.cyclesPerFrame(), 12u);
+    EXPECT_EQ(loaded.quirks(), QuirkProfile::SuperChip);
+    EXPECT_EQ(loaded.romHash(), log.romHash());
+    EXPECT_EQ(loaded.endCycle(), log.endCycle());
+    EXPECT_EQ(loaded.finalHash(), log.finalHash());
+    ASSERT_EQ(loaded.events().size(), log.events().size());
+    for (size_t i = 0; i < log.events().size(); ++i) {
+        EXPECT_EQ(loaded.events()[i].cycle, log.events()[i].cycle);
+        EXPECT_EQ(loaded.events()[i].key, log.events()[i].key);
+        EXPECT_EQ(loaded.events()[i].down, log.events()[i].down);
+    }
+
+    auto replayed = newMachine();
+    replay(loaded, *replayed);
+    EXPECT_EQ(replayed->stateHash(), log.finalHash());
+
+    // a truncated log is rejected
+    FILE *file = fopen(path, "r+b");
+    ASSERT_NE(file, nullptr);
+    fseek(file, 40, SEEK_SET);
+    fputc(0xFF, file);
+    fclose(file);
+    EXPECT_FALSE(loaded.load(path));
+    EXPECT_EQ(loaded.events().size(), log.events().size());
+    remove(path);
+}
+
+#pragma clang diagnostic pop
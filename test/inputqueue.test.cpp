@@ -0,0 +1,27 @@
+#pragma clang diagnostic push
+#pragma ide diagnostic ignored "cert-err58-cpp"
+
+#include <InputQueue.h>
+#include "gtest/gtest.h"
+
+TEST(InputQueueTest, DropsWhenFull) {
+    InputQueue queue;
+    auto now = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < InputQueue::CAPACITY; ++i) {
+        EXPECT_TRUE(queue.push(KeyEvent{now, (uint8_t) (i % 16), true}));
+    }
+    EXPECT_FALSE(queue.push(KeyEvent{now, 0, false}));
+    EXPECT_EQ(queue.dropped(), 1u);
+
+    KeyEvent events[InputQueue::CAPACITY];
+    EXPECT_EQ(queue.drain(events, 10), 10u);
+    EXPECT_EQ(events[3].key, 3);
+    EXPECT_EQ(queue.drain(events, InputQueue::CAPACITY), InputQueue::CAPACITY - 10);
+    EXPECT_EQ(events[0].key, 10);
+    EXPECT_EQ(queue.drain(events, 1), 0u);
+
+    EXPECT_TRUE(queue.push(KeyEvent{now, 7, false}));
+    EXPECT_EQ(queue.drain(events, 1), 1u);
+    EXPECT_EQ(events[0].key, 7);
+    EXPECT_FALSE(events[0].down);
+}
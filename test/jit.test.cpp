@@ -0,0 +1,124 @@
+#pragma clang diagnostic push
+#pragma ide diagnostic ignored "cert-err58-cpp"
+
+#include <Cpu.h>
+#include <Jit.h>
+#include <random>
+#include "gtest/gtest.h"
+
+#if defined(__x86_64__) && !defined(_WIN32)
+
+static const uint16_t ALU_OPCODES[] = {
+        0x6000, 0x7000, 0x8000, 0x8001, 0x8002, 0x8003, 0x8004, 0x8005, 0x8006, 0x8007, 0x800E, 0xA000, 0xF01E, 0xF029
+};
+
+static const uint16_t SKIP_OPCODES[] = {0x3000, 0x4000, 0x5000, 0x9000};
+
+TEST(JitTest, MatchesInterpreter) {
+    std::mt19937 rng(1234);
+
+    for (int round = 0; round < 500; ++round) {
+        auto memory = Memory();
+        auto graphics = Graphics(memory);
+        auto input = Input();
+        Cpu cpu(memory, graphics, input, 0x200);
+        QuirkProfile quirks = (QuirkProfile) (round % (int) QuirkProfile::Count);
+        cpu.setQuirks(quirks);
+
+        // a random block of ALU instructions on random registers, ended by a random skip
+        uint16_t addr = 0x200;
+        int length = 1 + rng() % 20;
+        for (int i = 0; i < length; ++i) {
+            uint16_t opcode = ALU_OPCODES[rng() % 14] | ((rng() % 16) << 8u);
+            if ((opcode & 0xF000u) == 0x8000) {
+                opcode |= (rng() % 16) << 4u;
+            } else if ((opcode & 0xF000u) == 0x6000 || (opcode & 0xF000u) == 0x7000 || (opcode & 0xF000u) == 0xA000) {
+                opcode |= rng() & 0xFFu;
+            }
+            memory[addr++] = opcode >> 8u;
+            memory[addr++] = opcode & 0xFFu;
+        }
+        uint16_t skip = SKIP_OPCODES[rng() % 4] | ((rng() % 16) << 8u) | ((rng() % 16) << 4u);
+        memory[addr++] = skip >> 8u;
+        memory[addr++] = skip & 0xFFu;
+
+        uint8_t registers[16];
+        for (auto &r : registers) {
+            r = rng() % 4 == 0 ? 0xFF : rng();
+        }
+        uint16_t i_register = rng() & 0x0FFFu;
+
+        Jit jit(quirks);
+        const Jit::Block *block = jit.lookup(0x200, memory);
+        ASSERT_NE(block, nullptr);
+        ASSERT_EQ(block->length, length + 1);
+
+        uint8_t jit_registers[16];
+        std::copy(registers, registers + 16, jit_registers);
+        uint16_t jit_i = i_register;
+        uint16_t jit_pc = block->fn(jit_registers, &jit_i);
+
+        std::copy(registers, registers + 16, cpu.data_registers);
+        cpu.instruction_register = i_register;
+        for (int i = 0; i < block->length; ++i) {
+            cpu.step();
+        }
+
+        EXPECT_EQ(jit_pc, cpu.pc);
+        EXPECT_EQ(jit_i, cpu.instruction_register);
+        for (int r = 0; r < 16; ++r) {
+            EXPECT_EQ(jit_registers[r], cpu.data_registers[r]) << "V" << r << " in round " << round;
+        }
+    }
+}
+
+TEST(JitTest, Invalidate) {
+    auto memory = Memory();
+    Jit jit;
+
+    // 0x6[0][05] - V0 = 5; 0x1[200] - Jump to 0x200
+    const uint8_t program[] = {0x60, 0x05, 0x12, 0x00};
+    memory.load(0x200, program, sizeof(program));
+
+    const Jit::Block *block = jit.lookup(0x200, memory);
+    ASSERT_NE(block, nullptr);
+    EXPECT_EQ(block->end, 0x204);
+
+    // 0xD[0][0]1 cannot be compiled
+    memory[0x200] = 0xD0;
+    memory[0x201] = 0x01;
+    jit.invalidate(0x201);
+    EXPECT_EQ(jit.lookup(0x200, memory), nullptr);
+
+    const Jit::Block *tail = jit.lookup(0x202, memory);
+    ASSERT_NE(tail, nullptr);
+    uint8_t registers[16]{};
+    uint16_t i_register = 0;
+    EXPECT_EQ(tail->fn(registers, &i_register), 0x200);
+}
+
+#endif
+
+TEST(JitTest, RunSelfModifyingCode) {
+    auto memory = Memory();
+    auto graphics = Graphics(memory);
+    auto input = Input();
+    Cpu cpu(memory, graphics, input, 0x200);
+
+    const uint8_t program[] = {
+            0x61, 0x05, // 0x200: V1 = 0x05
+            0xA2, 0x00, // 0x202: I = 0x200
+            0x60, 0x71, // 0x204: V0 = 0x71
+            0x61, 0x02, // 0x206: V1 = 0x02
+            0xF1, 0x55, // 0x208: Store V0-V1 at I, rewriting 0x200 to 0x7102 (V1 += 2)
+            0x12, 0x00, // 0x20A: Jump to 0x200
+    };
+    memory.load(0x200, program, sizeof(program));
+
+    cpu.run(6);
+    EXPECT_EQ(cpu.pc, 0x200);
+    EXPECT_EQ(cpu.data_registers[1], 0x02);
+
+    cpu.run(1);
+    EXPECT_EQ(cpu.data_registers[1], 0x04);
+}
@@ -0,0 +1,85 @@
+#pragma clang diagnostic push
+#pragma ide diagnostic ignored "cert-err58-cpp"
+
+#include <Cpu.h>
+#include <Profiler.h>
+#include <cstdio>
+#include <string>
+#include "gtest/gtest.h"
+
+static std::string collapsed(const Profiler &profiler) {
+    FILE *file = tmpfile();
+    profiler.writeCollapsed(file);
+    std::string out(ftell(file), '\0');
+    rewind(file);
+    out.resize(fread(&out[0], 1, out.size(), file));
+    fclose(file);
+    return out;
+}
+
+TEST(ProfilerTest, CallChains) {
+    Profiler profiler;
+    profiler.instruction(0x200, Op::CALL);
+    profiler.call(0x300);
+    profiler.instruction(0x300, Op::CALL);
+    profiler.call(0x400);
+    profiler.instruction(0x400, Op::RET);
+    profiler.ret();
+    profiler.instruction(0x302, Op::RET);
+    profiler.ret();
+    profiler.instruction(0x202, Op::CALL);
+    profiler.call(0x300);
+    profiler.instruction(0x300, Op::RET);
+    profiler.ret();
+    // a return from a call made before profiling started
+    profiler.ret();
+    profiler.instruction(0x204, Op::JP);
+
+    EXPECT_EQ(collapsed(profiler), "rom 3\nrom;sub_300 3\nrom;sub_300;sub_400 1\n");
+    EXPECT_EQ(profiler.totalCycles(), 7u);
+    EXPECT_EQ(profiler.executions(Op::CALL), 3u);
+    EXPECT_EQ(profiler.executionsAt(0x300), 2u);
+
+    profiler.reset();
+    EXPECT_EQ(collapsed(profiler), "");
+    EXPECT_EQ(profiler.totalCycles(), 0u);
+}
+
+#ifdef CHIP8_PROFILE
+TEST(ProfilerTest, CountsCpu) {
+    auto memory = Memory();
+    auto graphics = Graphics(memory);
+    auto input = Input();
+    Cpu cpu(memory, graphics, input, 0x200);
+    Profiler profiler;
+    cpu.setProfiler(&profiler);
+
+    const uint8_t program[] = {
+            0x22, 0x08, // 0x200: call 0x208
+            0xF0, 0x0A, // 0x202: V0 = wait for key
+            0x12, 0x04, // 0x204: jump to itself
+            0x00, 0x00,
+            0xA2, 0x10, // 0x208: I = 0x210
+            0xD0, 0x02, // 0x20A: draw 2 rows at (V0, V0)
+            0xD0, 0x02, // 0x20C: draw them again, colliding
+            0x00, 0xEE, // 0x20E: return
+            0xF0, 0x81, // 0x210: sprite
+    };
+    memory.load(0x200, program, sizeof(program));
+
+    cpu.run(20);
+    input.onKeyDown(7);
+    cpu.run(10);
+
+    EXPECT_EQ(profiler.totalCycles(), cpu.cycles);
+    EXPECT_EQ(profiler.executions(Op::DRW), 2u);
+    EXPECT_EQ(profiler.pixelsDrawn(), 12u);
+    EXPECT_EQ(profiler.collisions(), 1u);
+    EXPECT_EQ(profiler.executions(Op::LD_VX_K), 1u);
+    EXPECT_EQ(profiler.keyWaitCycles(), 15u);
+    EXPECT_EQ(profiler.cycles(Op::LD_VX_K), 16u);
+    EXPECT_EQ(profiler.cyclesAt(0x202), 16u);
+    EXPECT_EQ(profiler.executionsAt(0x204), 9u);
+    EXPECT_EQ(collapsed(profiler), "rom 26\nrom;sub_208 4\n");
+}
+#endif
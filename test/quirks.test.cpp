@@ -0,0 +1,207 @@
+#pragma clang diagnostic push
+#pragma ide diagnostic ignored "cert-err58-cpp"
+
+#include <Machine.h>
+#include <Quirks.h>
+#include <Rom.h>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include "gtest/gtest.h"
+
+static std::unique_ptr<Machine> newMachine(const uint8_t *program, size_t size, QuirkProfile quirks) {
+    std::unique_ptr<Machine> machine(new Machine());
+    machine->loadRom(program, size);
+    machine->cpu.seed(1);
+    machine->cpu.setQuirks(quirks);
+    return machine;
+}
+
+TEST(QuirksTest, Names) {
+    for (QuirkProfile profile : {QuirkProfile::CosmacVip, QuirkProfile::SuperChip, QuirkProfile::Modern}) {
+        QuirkProfile parsed = QuirkProfile::Count;
+        EXPECT_TRUE(parseQuirkProfile(quirkProfileName(profile), parsed));
+        EXPECT_EQ(parsed, profile);
+    }
+    QuirkProfile untouched = QuirkProfile::SuperChip;
+    EXPECT_FALSE(parseQuirkProfile("chip48", untouched));
+    EXPECT_EQ(untouched, QuirkProfile::SuperChip);
+    EXPECT_TRUE(quirkFlags(QuirkProfile::CosmacVip).shift_vy);
+    EXPECT_FALSE(quirkFlags(QuirkProfile::Modern).clip);
+}
+
+TEST(QuirksTest, Shifts) {
+    const uint8_t program[] = {
+            0x81, 0x26, // 0x200: V1 = V2 >> 1 or V1 >> 1
+            0x83, 0x4E, // 0x202: V3 = V4 << 1 or V3 << 1
+            0x8F, 0x56, // 0x204: VF = V5 >> 1 or VF >> 1, then VF = the bit shifted out
+    };
+
+    for (QuirkProfile quirks : {QuirkProfile::CosmacVip, QuirkProfile::Modern}) {
+        auto machine = newMachine(program, sizeof(program), quirks);
+        Cpu &cpu = machine->cpu;
+        bool vip = quirks == QuirkProfile::CosmacVip;
+        cpu.data_registers[1] = 0x10;
+        cpu.data_registers[2] = 0x03;
+        cpu.data_registers[3] = 0x01;
+        cpu.data_registers[4] = 0x81;
+        cpu.data_registers[5] = 0x03;
+
+        cpu.step();
+        EXPECT_EQ(cpu.data_registers[1], vip ? 0x01 : 0x08);
+        EXPECT_EQ(cpu.data_registers[0xF], vip ? 1 : 0);
+
+        cpu.step();
+        EXPECT_EQ(cpu.data_registers[3], 0x02);
+        EXPECT_EQ(cpu.data_registers[0xF], vip ? 1 : 0);
+
+        // the flag is written last, so it wins over the result
+        cpu.data_registers[0xF] = 0x04;
+        cpu.step();
+        EXPECT_EQ(cpu.data_registers[0xF], vip ? 1 : 0);
+    }
+
+    // switching profiles replaces instructions that were already decoded
+    auto machine = newMachine(program, sizeof(program), QuirkProfile::Modern);
+    Cpu &cpu = machine->cpu;
+    cpu.data_registers[2] = 0x03;
+    cpu.step();
+    EXPECT_EQ(cpu.data_registers[1], 0x00);
+    cpu.setQuirks(QuirkProfile::CosmacVip);
+    EXPECT_EQ(cpu.quirks(), QuirkProfile::CosmacVip);
+    cpu.pc = 0x200;
+    cpu.step();
+    EXPECT_EQ(cpu.data_registers[1], 0x01);
+}
+
+TEST(QuirksTest, MemoryIncrementsI) {
+    const uint8_t program[] = {
+            0xA3, 0x00, // 0x200: I = 0x300
+            0xF2, 0x55, // 0x202: Store V0-V2 at I
+            0xF1, 0x65, // 0x204: Load V0-V1 from I
+    };
+
+    for (QuirkProfile quirks : {QuirkProfile::CosmacVip, QuirkProfile::SuperChip, QuirkProfile::Modern}) {
+        auto machine = newMachine(program, sizeof(program), quirks);
+        Cpu &cpu = machine->cpu;
+        bool vip = quirks == QuirkProfile::CosmacVip;
+        machine->memory[0x303] = 0x33;
+        machine->memory[0x304] = 0x44;
+        cpu.data_registers[0] = 0x11;
+        cpu.data_registers[1] = 0x22;
+        cpu.data_registers[2] = 0x30;
+
+        cpu.run(2);
+        EXPECT_EQ(machine->memory[0x302], 0x30);
+        EXPECT_EQ(cpu.instruction_register, vip ? 0x303 : 0x300);
+
+        cpu.step();
+        EXPECT_EQ(cpu.data_registers[0], vip ? 0x33 : 0x11);
+        EXPECT_EQ(cpu.data_registers[1], vip ? 0x44 : 0x22);
+        EXPECT_EQ(cpu.instruction_register, vip ? 0x305 : 0x300);
+    }
+}
+
+TEST(QuirksTest, JumpVx) {
+    // 0xB[3]10 - Jump to 0x310 + V0, or 0x310 + V3
+    const uint8_t program[] = {0xB3, 0x10};
+
+    for (QuirkProfile quirks : {QuirkProfile::CosmacVip, QuirkProfile::SuperChip, QuirkProfile::Modern}) {
+        auto machine = newMachine(program, sizeof(program), quirks);
+        machine->cpu.data_registers[0] = 0x02;
+        machine->cpu.data_registers[3] = 0x04;
+        machine->cpu.step();
+        EXPECT_EQ(machine->cpu.pc, quirks == QuirkProfile::SuperChip ? 0x314 : 0x312);
+    }
+}
+
+TEST(QuirksTest, DisplayWait) {
+    const uint8_t program[] = {
+            0xD0, 0x11, // 0x200: Draw 1 row at (V0, V1)
+            0x72, 0x01, // 0x202: V2 += 1
+            0x12, 0x00, // 0x204: Jump to 0x200
+    };
+
+    // a draw only happens at the start of a frame; until then it is retried, a cycle at a time
+    auto machine = newMachine(program, sizeof(program), QuirkProfile::CosmacVip);
+    Cpu &cpu = machine->cpu;
+    cpu.setCyclesPerFrame(4);
+    cpu.run(3);
+    EXPECT_EQ(cpu.pc, 0x200);
+    EXPECT_EQ(cpu.data_registers[2], 1);
+    EXPECT_EQ(machine->graphics.get(0, 0), 1);
+    cpu.step();
+    EXPECT_EQ(cpu.pc, 0x200);
+    EXPECT_EQ(cpu.cycles, 4u);
+    cpu.step();
+    EXPECT_EQ(cpu.pc, 0x202);
+    EXPECT_EQ(machine->graphics.get(0, 0), 0);
+
+    // run() skips the wait, ending in the same state as stepping
+    auto stepped = newMachine(program, sizeof(program), QuirkProfile::CosmacVip);
+    auto run = newMachine(program, sizeof(program), QuirkProfile::CosmacVip);
+    for (int i = 0; i < 105; ++i) {
+        stepped->cpu.step();
+    }
+    run->cpu.run(105);
+    EXPECT_EQ(run->cpu.pc, stepped->cpu.pc);
+    EXPECT_EQ(run->cpu.data_registers[2], 11);
+    EXPECT_EQ(run->stateHash(), stepped->stateHash());
+
+    // without the quirk drawing never waits
+    auto modern = newMachine(program, sizeof(program), QuirkProfile::Modern);
+    modern->cpu.run(105);
+    EXPECT_EQ(modern->cpu.data_registers[2], 35);
+}
+
+TEST(QuirksTest, Clip) {
+    // 0xD[0][1]1 - Draw 1 row at (V0, V1)
+    const uint8_t program[] = {0xD0, 0x11};
+
+    for (QuirkProfile quirks : {QuirkProfile::SuperChip, QuirkProfile::Modern}) {
+        auto machine = newMachine(program, sizeof(program), quirks);
+        machine->memory[0x300] = 0xFF;
+        machine->cpu.instruction_register = 0x300;
+        // the position wraps under every profile, the pixels past the edge only without clipping
+        machine->cpu.data_registers[0] = 64 + 62;
+        machine->cpu.data_registers[1] = 5;
+        machine->cpu.step();
+        EXPECT_EQ(machine->graphics.get(62, 5), 1);
+        EXPECT_EQ(machine->graphics.get(63, 5), 1);
+        EXPECT_EQ(machine->graphics.get(0, 5), quirks == QuirkProfile::SuperChip ? 0 : 1);
+    }
+}
+
+TEST(QuirksTest, Database) {
+    const uint8_t chip8[] = {0x60, 0x01, 0x12, 0x00};
+    const uint8_t schip[] = {0x00, 0xFF, 0x00, 0xFB, 0x12, 0x00};
+
+    QuirkDatabase db;
+    EXPECT_EQ(db.select(chip8, sizeof(chip8)), QuirkProfile::Modern);
+    EXPECT_EQ(db.select(schip, sizeof(schip)), QuirkProfile::SuperChip);
+
+    const char *path = "quirks.test.txt";
+    FILE *file = fopen(path, "w");
+    ASSERT_NE(file, nullptr);
+    fprintf(file, "# hash profile name\n\n%016llx vip some game\n",
+            (unsigned long long) romHash(chip8, sizeof(chip8)));
+    fclose(file);
+    EXPECT_TRUE(db.load(path));
+    EXPECT_EQ(db.size(), 1u);
+    EXPECT_EQ(db.select(chip8, sizeof(chip8)), QuirkProfile::CosmacVip);
+    EXPECT_EQ(db.select(schip, sizeof(schip)), QuirkProfile::SuperChip);
+
+    // entries before a bad line are kept
+    file = fopen(path, "w");
+    ASSERT_NE(file, nullptr);
+    fprintf(file, "%016llx modern\n0123 chip48\n", (unsigned long long) romHash(schip, sizeof(schip)));
+    fclose(file);
+    EXPECT_FALSE(db.load(path));
+    QuirkProfile profile;
+    ASSERT_TRUE(db.find(romHash(schip, sizeof(schip)), profile));
+    EXPECT_EQ(profile, QuirkProfile::Modern);
+    EXPECT_FALSE(db.find(0x123, profile));
+    remove(path);
+
+    EXPECT_FALSE(db.load("quirks.test.missing"));
+}
@@ -0,0 +1,96 @@
+#pragma clang diagnostic push
+#pragma ide diagnostic ignored "cert-err58-cpp"
+
+#include <Rewind.h>
+#include <cstring>
+#include "gtest/gtest.h"
+
+// Draws at random positions and stores a counter to memory that walks through several pages
+static const uint8_t ROM[] = {
+        0xC0, 0x3F, // 0x200: V0 = random & 0x3F
+        0xC1, 0x1F, // 0x202: V1 = random & 0x1F
+        0xA2, 0x20, // 0x204: I = 0x220
+        0xD0, 0x15, // 0x206: Draw 5 rows at (V0, V1)
+        0x72, 0x01, // 0x208: V2 += 1
+        0xA4, 0x00, // 0x20A: I = 0x400
+        0xF2, 0x1E, // 0x20C: I += V2
+        0xF2, 0x55, // 0x20E: Store V0-V2 at I
+        0x12, 0x00, // 0x210: Jump to 0x200
+        0x00, 0x00,
+        0x00, 0x00,
+        0x00, 0x00,
+        0x00, 0x00,
+        0x00, 0x00,
+        0x00, 0x00,
+        0x00, 0x00,
+        0xF0, 0x90, 0x90, 0x90, 0xF0, // 0x220: sprite
+};
+
+static bool sameState(Machine &machine, const MachineState &expected) {
+    MachineState actual{};
+    machine.snapshot(actual);
+    return actual.cpu.pc == expected.cpu.pc
+           && actual.quirks == expected.quirks
+           && actual.cpu.cycles == expected.cpu.cycles
+           && actual.cpu.rng_state == expected.cpu.rng_state
+           && memcmp(actual.cpu.data_registers, expected.cpu.data_registers, 16) == 0
+           && actual.cpu.instruction_register == expected.cpu.instruction_register
+           && memcmp(actual.memory, expected.memory, sizeof(actual.memory)) == 0
+           && memcmp(actual.rows, expected.rows, sizeof(actual.rows)) == 0;
+}
+
+TEST(MemoryTest, DirtyPages) {
+    Memory memory;
+    memory.clearDirtyPages();
+
+    memory.read(0x300);
+    EXPECT_EQ(memory.dirtyPages(), 0);
+
+    memory[0x300] = 1;
+    memory[0xFFF] = 1;
+    EXPECT_EQ(memory.dirtyPages(), (1ull << (0x300 / Memory::PAGE_SIZE)) | (1ull << 63u));
+}
+
+TEST(RewindTest, StepsBackThroughEveryFrame) {
+    Machine machine;
+    machine.loadRom(ROM, sizeof(ROM));
+    machine.cpu.setQuirks(QuirkProfile::SuperChip);
+    Rewind rewind(machine, 1024 * 1024, 7);
+
+    std::vector<std::unique_ptr<MachineState>> expected;
+    for (int frame = 0; frame < 50; ++frame) {
+        machine.cpu.run(machine.cpu.cyclesPerFrame());
+        rewind.record();
+        expected.emplace_back(new MachineState());
+        machine.snapshot(*expected.back());
+    }
+    EXPECT_EQ(rewind.frames(), 50);
+
+    for (int frame = 48; frame >= 0; --frame) {
+        ASSERT_TRUE(rewind.stepBack());
+        EXPECT_TRUE(sameState(machine, *expected[frame])) << "frame " << frame;
+    }
+    EXPECT_FALSE(rewind.stepBack());
+
+    // recording resumes from the restored frame
+    machine.cpu.run(machine.cpu.cyclesPerFrame());
+    rewind.record();
+    ASSERT_TRUE(rewind.stepBack());
+    EXPECT_TRUE(sameState(machine, *expected[0]));
+}
+
+TEST(RewindTest, StaysWithinBudget) {
+    Machine machine;
+    machine.loadRom(ROM, sizeof(ROM));
+    const size_t budget = 64 * 1024;
+    Rewind rewind(machine, budget, 10);
+
+    for (int frame = 0; frame < 1000; ++frame) {
+        machine.cpu.run(machine.cpu.cyclesPerFrame());
+        rewind.record();
+    }
+
+    EXPECT_LE(rewind.memoryUsage(), budget);
+    EXPECT_LT(rewind.frames(), 1000);
+    EXPECT_GT(rewind.frames(), 10);
+}
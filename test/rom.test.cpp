@@ -0,0 +1,83 @@
+#pragma clang diagnostic push
+#pragma ide diagnostic ignored "cert-err58-cpp"
+
+#include <Machine.h>
+#include <Rom.h>
+#include <cstdio>
+#include <string>
+#include <sys/stat.h>
+#include "gtest/gtest.h"
+
+static void writeFile(const std::string &path, const std::vector<uint8_t> &data) {
+    FILE *file = fopen(path.c_str(), "wb");
+    ASSERT_NE(file, nullptr);
+    fwrite(data.data(), 1, data.size(), file);
+    fclose(file);
+}
+
+TEST(RomTest, Hash) {
+    // reference values of 64-bit FNV-1a
+    EXPECT_EQ(romHash(nullptr, 0), 0xCBF29CE484222325ull);
+    const uint8_t a[] = {'a'};
+    EXPECT_EQ(romHash(a, 1), 0xAF63DC4C8601EC8Cull);
+}
+
+TEST(RomTest, OpenValidatesSize) {
+    const std::string path = "rom.test.ch8";
+
+    writeFile(path, {0x12, 0x00});
+    RomFile rom;
+    ASSERT_TRUE(rom.open(path.c_str()));
+    EXPECT_EQ(rom.size(), 2);
+    EXPECT_EQ(rom.data()[0], 0x12);
+    EXPECT_EQ(rom.hash(), romHash(rom.data(), 2));
+
+    writeFile(path, std::vector<uint8_t>(Machine::MAX_PROGRAM_SIZE, 0xAB));
+    EXPECT_TRUE(rom.open(path.c_str()));
+
+    writeFile(path, std::vector<uint8_t>(Machine::MAX_PROGRAM_SIZE + 1, 0xAB));
+    EXPECT_FALSE(rom.open(path.c_str()));
+
+    writeFile(path, {});
+    EXPECT_FALSE(rom.open(path.c_str()));
+
+    remove(path.c_str());
+    EXPECT_FALSE(rom.open(path.c_str()));
+}
+
+TEST(RomTest, DetectProfile) {
+    const uint8_t chip8[] = {0x60, 0x01, 0xD0, 0x15, 0x12, 0x00};
+    EXPECT_EQ(detectProfile(chip8, sizeof(chip8)), RomProfile::Chip8);
+
+    // 00FF - high resolution; DXY0 - 16x16 sprite
+    const uint8_t schip[] = {0x00, 0xFF, 0xD0, 0x10, 0x12, 0x00};
+    EXPECT_EQ(detectProfile(schip, sizeof(schip)), RomProfile::SuperChip);
+}
+
+TEST(RomLibraryTest, IndexesDirectory) {
+    const std::string dir = "rom.test.library";
+    mkdir(dir.c_str(), 0755);
+    writeFile(dir + "/a.ch8", {0x12, 0x00});
+    writeFile(dir + "/b game.ch8", {0x00, 0xFF, 0xD0, 0x10});
+
+    RomLibrary library(dir);
+    EXPECT_EQ(library.refresh(), 2);
+    ASSERT_EQ(library.entries().size(), 2);
+    EXPECT_EQ(library.entries()[0].name, "a.ch8");
+    EXPECT_EQ(library.entries()[1].profile, RomProfile::SuperChip);
+
+    // a second library reads the index rather than the roms
+    RomLibrary reloaded(dir);
+    EXPECT_EQ(reloaded.refresh(), 0);
+    ASSERT_EQ(reloaded.entries().size(), 2);
+    const RomEntry *entry = reloaded.find("b game.ch8");
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(entry->profile, RomProfile::SuperChip);
+    EXPECT_EQ(reloaded.find(entry->hash), entry);
+    EXPECT_EQ(reloaded.path(*entry), dir + "/b game.ch8");
+
+    remove((dir + "/a.ch8").c_str());
+    remove((dir + "/b game.ch8").c_str());
+    remove((dir + "/" + RomLibrary::INDEX_NAME).c_str());
+    rmdir(dir.c_str());
+}
@@ -0,0 +1,186 @@
+#pragma clang diagnostic push
+#pragma ide diagnostic ignored "cert-err58-cpp"
+
+#include <Machine.h>
+#include <SaveState.h>
+#include <cstdio>
+#include <cstring>
+#include "gtest/gtest.h"
+
+// Draws at random positions, calls a subroutine and keeps the timers running
+static const uint8_t ROM[] = {
+        0xC0, 0x3F, // 0x200: V0 = random & 0x3F
+        0xC1, 0x1F, // 0x202: V1 = random & 0x1F
+        0xA2, 0x20, // 0x204: I = 0x220
+        0xD0, 0x15, // 0x206: Draw 5 rows at (V0, V1)
+        0x22, 0x14, // 0x208: Call 0x214
+        0xF0, 0x15, // 0x20A: delay = V0
+        0xF1, 0x18, // 0x20C: sound = V1
+        0xF2, 0x33, // 0x20E: BCD of V2 at I
+        0x12, 0x00, // 0x210: Jump to 0x200
+        0x00, 0x00,
+        0x72, 0x03, // 0x214: V2 += 3
+        0x00, 0xEE, // 0x216: Return
+        0x00, 0x00,
+        0x00, 0x00,
+        0x00, 0x00,
+        0x00, 0x00,
+        0xF0, 0x90, 0x90, 0x90, 0xF0, // 0x220: sprite
+};
+
+static void expectSameState(const MachineState &a, const MachineState &b) {
+    EXPECT_EQ(a.cpu.pc, b.cpu.pc);
+    EXPECT_EQ(a.quirks, b.quirks);
+    EXPECT_EQ(a.cpu.instruction_register, b.cpu.instruction_register);
+    EXPECT_EQ(memcmp(a.cpu.data_registers, b.cpu.data_registers, sizeof(a.cpu.data_registers)), 0);
+    EXPECT_EQ(a.cpu.stack_pointer, b.cpu.stack_pointer);
+    EXPECT_EQ(memcmp(a.cpu.stack, b.cpu.stack, sizeof(a.cpu.stack)), 0);
+    EXPECT_EQ(a.cpu.delay_timer, b.cpu.delay_timer);
+    EXPECT_EQ(a.cpu.sound_timer, b.cpu.sound_timer);
+    EXPECT_EQ(a.cpu.frame_countdown, b.cpu.frame_countdown);
+    EXPECT_EQ(a.cpu.cycles, b.cpu.cycles);
+    EXPECT_EQ(a.cpu.rng_state, b.cpu.rng_state);
+    EXPECT_EQ(memcmp(a.memory, b.memory, sizeof(a.memory)), 0);
+    EXPECT_EQ(memcmp(a.rows, b.rows, sizeof(a.rows)), 0);
+    EXPECT_EQ(a.hires, b.hires);
+    EXPECT_EQ(memcmp(a.hires_rows, b.hires_rows, sizeof(a.hires_rows)), 0);
+}
+
+TEST(SaveStateTest, RestoreContinuesIdentically) {
+    Machine original;
+    original.loadRom(ROM, sizeof(ROM));
+    original.cpu.seed(5);
+    original.cpu.run(1001);
+
+    for (bool compress : {false, true}) {
+        MachineState saved{};
+        original.snapshot(saved);
+        std::vector<uint8_t> file = encodeState(saved, compress);
+
+        MachineState decoded{};
+        ASSERT_TRUE(decodeState(file.data(), file.size(), decoded));
+        expectSameState(saved, decoded);
+
+        Machine copy;
+        ASSERT_TRUE(copy.restore(decoded));
+        copy.cpu.run(777);
+
+        Machine reference;
+        ASSERT_TRUE(reference.restore(saved));
+        reference.cpu.run(777);
+
+        MachineState a{}, b{};
+        copy.snapshot(a);
+        reference.snapshot(b);
+        expectSameState(a, b);
+        EXPECT_NE(a.cpu.cycles, saved.cpu.cycles);
+    }
+}
+
+TEST(SaveStateTest, CompressionShrinksState) {
+    Machine machine;
+    machine.loadRom(ROM, sizeof(ROM));
+    machine.cpu.run(100);
+
+    MachineState state{};
+    machine.snapshot(state);
+    EXPECT_LT(encodeState(state, true).size(), encodeState(state, false).size() / 4);
+}
+
+TEST(SaveStateTest, RejectsInvalidData) {
+    Machine machine;
+    machine.loadRom(ROM, sizeof(ROM));
+    MachineState state{};
+    machine.snapshot(state);
+    std::vector<uint8_t> file = encodeState(state, true);
+
+    MachineState out{};
+    EXPECT_FALSE(decodeState(file.data(), file.size() - 1, out));
+    EXPECT_FALSE(decodeState(file.data(), 8, out));
+
+    std::vector<uint8_t> version = file;
+    version[4] = 1;
+    EXPECT_FALSE(decodeState(version.data(), version.size(), out));
+
+    std::vector<uint8_t> quirks = file;
+    quirks[8] = (uint8_t) QuirkProfile::Count;
+    EXPECT_FALSE(decodeState(quirks.data(), quirks.size(), out));
+
+    // a payload size other than that of a serialized state, here 4 GiB, is rejected before decompressing
+    for (bool compress : {true, false}) {
+        std::vector<uint8_t> size = encodeState(state, compress);
+        memset(&size[10], 0xFF, 4);
+        EXPECT_FALSE(decodeState(size.data(), size.size(), out));
+    }
+
+    // a stack pointer past the end of the call stack
+    state.cpu.stack_pointer = Cpu::STACK_SIZE + 1;
+    EXPECT_FALSE(machine.restore(state));
+}
+
+TEST(SaveStateTest, RestoreDiscardsPredecodedCode) {
+    Machine machine;
+    // 0x6[0]01 - V0 = 1; 0x1[200] - Jump to 0x200
+    const uint8_t program[] = {0x60, 0x01, 0x12, 0x00};
+    machine.loadRom(program, sizeof(program));
+
+    MachineState state{};
+    machine.snapshot(state);
+    machine.cpu.step();
+
+    // 0x6[0]02 - V0 = 2, written behind the cpu's back
+    state.memory[0x201] = 0x02;
+    ASSERT_TRUE(machine.restore(state));
+    machine.cpu.step();
+    EXPECT_EQ(machine.cpu.data_registers[0], 2);
+}
+
+TEST(SaveStateTest, SaveAndLoadFile) {
+    const char *path = "savestate.test.state";
+
+    Machine machine;
+    machine.loadRom(ROM, sizeof(ROM));
+    machine.cpu.run(500);
+    ASSERT_TRUE(machine.save(path));
+
+    Machine loaded;
+    ASSERT_TRUE(loaded.load(path));
+    std::remove(path);
+
+    MachineState a{}, b{};
+    machine.snapshot(a);
+    loaded.snapshot(b);
+    expectSameState(a, b);
+
+    EXPECT_FALSE(loaded.load(path));
+}
+
+TEST(SaveStateTest, RestoresQuirkProfile) {
+    Machine machine;
+    machine.loadRom(ROM, sizeof(ROM));
+    machine.cpu.setQuirks(QuirkProfile::CosmacVip);
+    machine.cpu.run(500);
+    MachineState state{};
+    machine.snapshot(state);
+    std::vector<uint8_t> file = encodeState(state, true);
+
+    // a state taken under the VIP's quirks continues under them in a machine running another profile
+    Machine loaded;
+    loaded.loadRom(ROM, sizeof(ROM));
+    EXPECT_EQ(loaded.cpu.quirks(), QuirkProfile::Modern);
+    MachineState decoded{};
+    ASSERT_TRUE(decodeState(file.data(), file.size(), decoded));
+    EXPECT_EQ(decoded.quirks, QuirkProfile::CosmacVip);
+    ASSERT_TRUE(loaded.restore(decoded));
+    EXPECT_EQ(loaded.cpu.quirks(), QuirkProfile::CosmacVip);
+
+    machine.cpu.run(500);
+    loaded.cpu.run(500);
+    EXPECT_EQ(loaded.stateHash(), machine.stateHash());
+
+    // an unknown profile is rejected before anything changes
+    decoded.quirks = QuirkProfile::Count;
+    decoded.cpu.pc = 0x300;
+    EXPECT_FALSE(loaded.restore(decoded));
+    EXPECT_NE(loaded.cpu.pc, 0x300);
+}
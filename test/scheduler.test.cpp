@@ -0,0 +1,91 @@
+#pragma clang diagnostic push
+#pragma ide diagnostic ignored "cert-err58-cpp"
+
+#include <Machine.h>
+#include <Scheduler.h>
+#include <vector>
+#include "gtest/gtest.h"
+
+// 0x1[200] - Jump to itself
+static const uint8_t LOOP_ROM[] = {0x12, 0x00};
+
+TEST(SchedulerTest, RunFrame) {
+    Machine machine;
+    machine.loadRom(LOOP_ROM, sizeof(LOOP_ROM));
+    Scheduler scheduler(machine.cpu);
+    scheduler.setInstructionsPerFrame(25);
+
+    scheduler.runFrame();
+    scheduler.runFrame();
+    EXPECT_EQ(scheduler.frames(), 2);
+    EXPECT_EQ(machine.cpu.cycles, 50);
+}
+
+TEST(SchedulerTest, Paced) {
+    Machine machine;
+    machine.loadRom(LOOP_ROM, sizeof(LOOP_ROM));
+    Scheduler scheduler(machine.cpu);
+
+    // 600 frames per second, so 6 frames take at least 5 frame periods
+    scheduler.setPacing(Pacing::Multiplier, 10.0);
+    auto start = Scheduler::Clock::now();
+    while (scheduler.frames() < 6) {
+        scheduler.advance();
+        scheduler.wait();
+    }
+    auto elapsed = Scheduler::Clock::now() - start;
+
+    EXPECT_GE(elapsed, std::chrono::microseconds(5 * 1000000 / 600));
+    EXPECT_EQ(machine.cpu.cycles, scheduler.frames() * Cpu::DEFAULT_CYCLES_PER_FRAME);
+}
+
+TEST(SchedulerTest, Unthrottled) {
+    Machine machine;
+    machine.loadRom(LOOP_ROM, sizeof(LOOP_ROM));
+    Scheduler scheduler(machine.cpu);
+    scheduler.setPacing(Pacing::Unthrottled);
+
+    // one call runs for a whole host frame, far more than one emulated frame
+    scheduler.advance();
+    EXPECT_GT(scheduler.frames(), 1);
+}
+
+TEST(SchedulerTest, InputAtCycles) {
+    Machine machine;
+    machine.loadRom(LOOP_ROM, sizeof(LOOP_ROM));
+    Scheduler scheduler(machine.cpu);
+    scheduler.setInstructionsPerFrame(100);
+
+    InputQueue queue;
+    std::vector<uint64_t> applied;
+    scheduler.setInputQueue(&queue, [&](uint8_t key, bool down) {
+        applied.push_back(machine.cpu.cycles);
+        if (down) {
+            machine.input.onKeyDown(key);
+        } else {
+            machine.input.onKeyUp(key);
+        }
+    });
+
+    // the first frame covers the frame period before its deadline, which reset() sets to now
+    scheduler.reset();
+    auto deadline = Scheduler::Clock::now();
+    auto period = std::chrono::microseconds(1000000 / Scheduler::FRAME_RATE);
+    queue.push(KeyEvent{deadline - 2 * period, 1, true});
+    queue.push(KeyEvent{deadline - period / 2, 2, true});
+    queue.push(KeyEvent{deadline + std::chrono::hours(1), 1, false});
+    scheduler.advance();
+
+    ASSERT_EQ(applied.size(), 2u);
+    EXPECT_EQ(applied[0], 0u);
+    EXPECT_NEAR((double) applied[1], 50.0, 2.0);
+    EXPECT_TRUE(machine.input.keys[1]);
+    EXPECT_TRUE(machine.input.keys[2]);
+
+    // unpaced frames apply everything left before their first instruction
+    uint64_t start = machine.cpu.cycles;
+    scheduler.runFrame();
+    ASSERT_EQ(applied.size(), 3u);
+    EXPECT_EQ(applied[2], start);
+    EXPECT_FALSE(machine.input.keys[1]);
+}
@@ -0,0 +1,35 @@
+#pragma clang diagnostic push
+#pragma ide diagnostic ignored "cert-err58-cpp"
+
+#include <ThreadPool.h>
+#include <atomic>
+#include "gtest/gtest.h"
+
+TEST(ThreadPoolTest, RunsEveryTask) {
+    std::atomic<int> sum(0);
+    ThreadPool pool(4);
+
+    for (int i = 1; i <= 1000; ++i) {
+        pool.submit([&sum, i] { sum += i; });
+    }
+    pool.wait();
+
+    EXPECT_EQ(sum, 1000 * 1001 / 2);
+}
+
+TEST(ThreadPoolTest, NestedSubmit) {
+    std::atomic<int> count(0);
+    ThreadPool pool(3);
+
+    for (int i = 0; i < 10; ++i) {
+        pool.submit([&pool, &count] {
+            for (int j = 0; j < 10; ++j) {
+                pool.submit([&count] { count++; });
+            }
+            count++;
+        });
+    }
+    pool.wait();
+
+    EXPECT_EQ(count, 10 * 11);
+}
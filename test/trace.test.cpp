@@ -0,0 +1,51 @@
+#pragma clang diagnostic push
+#pragma ide diagnostic ignored "cert-err58-cpp"
+
+#include <Cpu.h>
+#include <Trace.h>
+#include "gtest/gtest.h"
+
+TEST(TraceTest, RingDropsWhenFull) {
+    TraceBuffer buffer(3);
+
+    for (uint16_t i = 0; i < 6; ++i) {
+        TraceRecord record{};
+        record.pc = 0x200 + i;
+        buffer.push(record);
+    }
+    EXPECT_EQ(buffer.dropped(), 2u);
+
+    TraceRecord out[8];
+    ASSERT_EQ(buffer.drain(out, 8), 4u);
+    EXPECT_EQ(out[0].pc, 0x200);
+    EXPECT_EQ(out[3].pc, 0x203);
+    EXPECT_EQ(buffer.drain(out, 8), 0u);
+}
+
+#if CHIP8_TRACE_LEVEL >= CHIP8_TRACE_INSTRUCTIONS
+TEST(TraceTest, RecordsInstructions) {
+    auto memory = Memory();
+    auto graphics = Graphics(memory);
+    auto input = Input();
+    Cpu cpu(memory, graphics, input, 0x200);
+    TraceBuffer buffer;
+    cpu.setTraceBuffer(&buffer);
+
+    // 0x6[3][42] - V3 = 0x42; 0x5[0][0]1 - unknown opcode
+    const uint8_t program[] = {0x63, 0x42, 0x50, 0x01};
+    memory.load(0x200, program, sizeof(program));
+
+    cpu.step();
+    cpu.step();
+
+    TraceRecord out[4];
+    ASSERT_EQ(buffer.drain(out, 4), 3u);
+    EXPECT_EQ(out[0].pc, 0x200);
+    EXPECT_EQ(out[0].opcode, 0x6342);
+    EXPECT_EQ(out[0].data_registers[3], 0);
+    EXPECT_EQ(out[1].pc, 0x202);
+    EXPECT_EQ(out[1].data_registers[3], 0x42);
+    EXPECT_EQ(out[2].kind, (uint8_t) TraceKind::UnknownOpcode);
+    EXPECT_EQ(out[2].opcode, 0x5001);
+}
+#endif
@@ -0,0 +1,141 @@
+#pragma clang diagnostic push
+#pragma ide diagnostic ignored "cert-err58-cpp"
+
+#include <Machine.h>
+#include <Translator.h>
+#include <memory>
+#include "gtest/gtest.h"
+
+static const uint8_t ROM[] = {
+        0x60, 0x05, // 0x200: V0 = 5
+        0x71, 0x01, // 0x202: V1 += 1
+        0xD0, 0x15, // 0x204: draw, left to the interpreter
+        0x80, 0x14, // 0x206: V0 += V1
+        0x31, 0x10, // 0x208: skip if V1 == 0x10
+        0x12, 0x02, // 0x20A: jump to 0x202
+        0xA2, 0x0C, // 0x20C: I = 0x20C
+        0x12, 0x0E, // 0x20E: jump to 0x20E
+};
+
+// what Chip8Emu_aot writes for ROM
+static uint16_t block_200(uint8_t *v, uint16_t *) {
+    v[0x0] = 0x05;
+    return 0x202;
+}
+
+static uint16_t block_202(uint8_t *v, uint16_t *) {
+    v[0x1] += 0x01;
+    return 0x204;
+}
+
+static uint16_t block_206(uint8_t *v, uint16_t *) {
+    uint8_t v0 = v[0x0], v1 = v[0x1], vF = v[0xF];
+    vF = (uint8_t) (v0 + v1 > 0xFF);
+    v0 += v1;
+    v[0x0] = v0;
+    v[0xF] = vF;
+    return v1 == 0x10 ? 0x20C : 0x20A;
+}
+
+static uint16_t block_20A(uint8_t *, uint16_t *) {
+    return 0x202;
+}
+
+static uint16_t block_20C(uint8_t *, uint16_t *i) {
+    *i = 0x20C;
+    return 0x20E;
+}
+
+static uint16_t block_20E(uint8_t *, uint16_t *) {
+    return 0x20E;
+}
+
+static const TranslatedBlock BLOCKS[] = {
+        {0x200, 0x202, 1, &block_200},
+        {0x202, 0x204, 1, &block_202},
+        {0x206, 0x20A, 2, &block_206},
+        {0x20A, 0x20C, 1, &block_20A},
+        {0x20C, 0x20E, 1, &block_20C},
+        {0x20E, 0x210, 1, &block_20E},
+};
+
+TEST(TranslationTest, Blocks) {
+    Translator translator;
+    ASSERT_TRUE(translator.translate(ROM, sizeof(ROM)));
+    ASSERT_EQ(translator.blocks().size(), 6u);
+    for (size_t i = 0; i < translator.blocks().size(); ++i) {
+        EXPECT_EQ(translator.blocks()[i].start, BLOCKS[i].start);
+        EXPECT_EQ(translator.blocks()[i].end, BLOCKS[i].end);
+        EXPECT_EQ(translator.blocks()[i].length, BLOCKS[i].length);
+    }
+    EXPECT_TRUE(translator.skippedBlocks().empty());
+
+    // FX33 overwrites the jump, so the only block is left to the interpreter
+    const uint8_t modified[] = {0xA2, 0x06, 0xF0, 0x33, 0x60, 0x01, 0x12, 0x00};
+    ASSERT_TRUE(translator.translate(modified, sizeof(modified)));
+    EXPECT_TRUE(translator.blocks().empty());
+    ASSERT_EQ(translator.skippedBlocks().size(), 1u);
+    EXPECT_EQ(translator.skippedBlocks()[0].start, 0x200);
+
+    EXPECT_FALSE(translator.translate(ROM, 0));
+    EXPECT_FALSE(translator.write(stdout, "empty"));
+}
+
+TEST(TranslationTest, MatchesInterpreter) {
+    std::unique_ptr<Machine> translated(new Machine());
+    std::unique_ptr<Machine> interpreted(new Machine());
+    Translation translation(ROM, sizeof(ROM), BLOCKS, sizeof(BLOCKS) / sizeof(BLOCKS[0]));
+    EXPECT_EQ(translation.size(), 6u);
+    for (Machine *machine : {translated.get(), interpreted.get()}) {
+        machine->loadRom(ROM, sizeof(ROM));
+        machine->cpu.seed(1);
+    }
+    translated->cpu.setTranslation(&translation);
+    EXPECT_NE(translation.lookup(0x206), nullptr);
+
+    for (uint64_t cycles : {1u, 7u, 100u, 5000u}) {
+        translated->cpu.run(cycles);
+        interpreted->cpu.run(cycles);
+        ASSERT_EQ(translated->cpu.cycles, interpreted->cpu.cycles);
+        ASSERT_EQ(translated->stateHash(), interpreted->stateHash()) << "after " << cycles << " cycles";
+    }
+}
+
+TEST(TranslationTest, Invalidate) {
+    std::unique_ptr<Machine> machine(new Machine());
+    machine->loadRom(ROM, sizeof(ROM));
+    Translation translation(ROM, sizeof(ROM), BLOCKS, sizeof(BLOCKS) / sizeof(BLOCKS[0]));
+    EXPECT_EQ(translation.lookup(0x200), nullptr);
+    machine->cpu.setTranslation(&translation);
+    ASSERT_NE(translation.lookup(0x200), nullptr);
+    EXPECT_EQ(translation.lookup(0x204), nullptr);
+
+    MachineState state;
+    machine->snapshot(state);
+
+    // only the block covering 0x20B is disabled
+    machine->memory[0x20B] = 0x04;
+    EXPECT_EQ(translation.lookup(0x20A), nullptr);
+    EXPECT_NE(translation.lookup(0x206), nullptr);
+    EXPECT_NE(translation.lookup(0x20C), nullptr);
+
+    // the modified code is interpreted: the jump now goes to 0x204
+    machine->cpu.run(6);
+    EXPECT_EQ(machine->cpu.pc, 0x204);
+
+    machine->restore(state);
+    EXPECT_NE(translation.lookup(0x20A), nullptr);
+}
+
+TEST(TranslationTest, Quirks) {
+    std::unique_ptr<Machine> machine(new Machine());
+    machine->loadRom(ROM, sizeof(ROM));
+    Translation translation(ROM, sizeof(ROM), BLOCKS, sizeof(BLOCKS) / sizeof(BLOCKS[0]), QuirkProfile::CosmacVip);
+    EXPECT_EQ(translation.quirks(), QuirkProfile::CosmacVip);
+
+    // blocks translated for another profile could shift the wrong register
+    EXPECT_FALSE(machine->cpu.setTranslation(&translation));
+    machine->cpu.setQuirks(QuirkProfile::CosmacVip);
+    EXPECT_TRUE(machine->cpu.setTranslation(&translation));
+    EXPECT_NE(translation.lookup(0x200), nullptr);
+}
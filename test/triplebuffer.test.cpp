@@ -0,0 +1,70 @@
+#pragma clang diagnostic push
+#pragma ide diagnostic ignored "cert-err58-cpp"
+
+#include <TripleBuffer.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include "gtest/gtest.h"
+
+TEST(TripleBufferTest, NewestWins) {
+    TripleBuffer<int> buffer;
+    EXPECT_FALSE(buffer.acquire());
+    EXPECT_EQ(buffer.repeated(), 1u);
+
+    buffer.write() = 1;
+    buffer.publish();
+    EXPECT_TRUE(buffer.acquire());
+    EXPECT_EQ(buffer.read(), 1);
+
+    // nothing new: the last value stays
+    EXPECT_FALSE(buffer.acquire());
+    EXPECT_EQ(buffer.read(), 1);
+    EXPECT_EQ(buffer.repeated(), 2u);
+
+    buffer.write() = 2;
+    buffer.publish();
+    buffer.write() = 3;
+    buffer.publish();
+    buffer.write() = 4;
+    buffer.publish();
+    EXPECT_EQ(buffer.dropped(), 2u);
+    EXPECT_TRUE(buffer.acquire());
+    EXPECT_EQ(buffer.read(), 4);
+}
+
+TEST(TripleBufferTest, Threads) {
+    struct Value {
+        uint64_t a;
+        uint64_t b[64];
+    };
+    TripleBuffer<Value> buffer;
+    const uint64_t count = 100000;
+
+    std::thread producer([&buffer, count]() {
+        for (uint64_t i = 1; i <= count; ++i) {
+            Value &value = buffer.write();
+            value.a = i;
+            std::fill(value.b, value.b + 64, i);
+            buffer.publish();
+        }
+    });
+
+    uint64_t last = 0, acquired = 0;
+    bool torn = false, backwards = false;
+    while (last < count) {
+        if (!buffer.acquire()) {
+            continue;
+        }
+        const Value &value = buffer.read();
+        torn |= std::any_of(value.b, value.b + 64, [&value](uint64_t b) { return b != value.a; });
+        backwards |= value.a <= last;
+        last = value.a;
+        acquired++;
+    }
+    producer.join();
+
+    EXPECT_FALSE(torn);
+    EXPECT_FALSE(backwards);
+    EXPECT_EQ(acquired + buffer.dropped(), count);
+}
@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Analyzer.h"
+#include "Rom.h"
+#include "ThreadPool.h"
+
+/*
+ * Analyzes every ROM given and writes a JSON array with one object per ROM:
+ *   {"rom": path, "hash": FNV-1a hash, "analysis": the object written by Analysis::writeJson}
+ * or, with --listing, a disassembly listing of each ROM.
+ */
+
+struct Result {
+    std::string error;
+    uint64_t hash = 0;
+    Analysis analysis;
+};
+
+static void usage(const char *name) {
+    printf("Usage: %s [-j threads] [-o file] [--listing] rom-file...\n"
+           "  -j         worker threads (default: one per hardware thread)\n"
+           "  -o         where to write the results (default: standard output)\n"
+           "  --listing  write a disassembly listing instead of JSON\n", name);
+}
+
+static bool writeString(FILE *file, const std::string &value) {
+    bool written = fputc('"', file) != EOF;
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            written &= fprintf(file, "\\%c", c) > 0;
+        } else if ((unsigned char) c < 0x20) {
+            written &= fprintf(file, "\\u%04x", c) > 0;
+        } else {
+            written &= fputc(c, file) != EOF;
+        }
+    }
+    written &= fputc('"', file) != EOF;
+    return written;
+}
+
+int main(int argc, char **argv) {
+    unsigned threads = 0;
+    const char *out_path = nullptr;
+    bool listing = false;
+    std::vector<std::string> roms;
+
+    for (int i = 1; i < argc; ++i) {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "-j") == 0 && has_value) {
+            threads = (unsigned) strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "-o") == 0 && has_value) {
+            out_path = argv[++i];
+        } else if (strcmp(argv[i], "--listing") == 0) {
+            listing = true;
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else {
+            roms.emplace_back(argv[i]);
+        }
+    }
+
+    if (roms.empty()) {
+        usage(argv[0]);
+        return 1;
+    }
+    std::sort(roms.begin(), roms.end());
+
+    std::vector<std::unique_ptr<Result>> results(roms.size());
+    {
+        ThreadPool pool(threads);
+        for (size_t i = 0; i < roms.size(); ++i) {
+            pool.submit([&results, &roms, i] {
+                std::unique_ptr<Result> result(new Result());
+                RomFile rom;
+                if (!rom.open(roms[i].c_str())) {
+                    result->error = rom.error();
+                } else {
+                    result->hash = rom.hash();
+                    result->analysis.analyze(rom.data(), rom.size());
+                }
+                results[i] = std::move(result);
+            });
+        }
+        pool.wait();
+    }
+
+    FILE *out = out_path != nullptr ? fopen(out_path, "w") : stdout;
+    if (out == nullptr) {
+        fprintf(stderr, "%s could not be opened!\n", out_path);
+        return 1;
+    }
+
+    bool written = true;
+    size_t failed = 0;
+    written &= listing || fputs("[", out) >= 0;
+    for (size_t i = 0; i < roms.size(); ++i) {
+        const Result &result = *results[i];
+        if (!result.error.empty()) {
+            fprintf(stderr, "%s %s!\n", roms[i].c_str(), result.error.c_str());
+            failed++;
+            continue;
+        }
+
+        if (listing) {
+            written &= fprintf(out, "; %s (%016" PRIx64 ")\n", roms[i].c_str(), result.hash) > 0;
+            written &= result.analysis.writeListing(out);
+            written &= fputs("\n", out) >= 0;
+            continue;
+        }
+        written &= fputs(i - failed == 0 ? "\n{\"rom\": " : ",\n{\"rom\": ", out) >= 0;
+        written &= writeString(out, roms[i]);
+        written &= fprintf(out, ", \"hash\": \"%016" PRIx64 "\", \"analysis\": ", result.hash) > 0;
+        written &= result.analysis.writeJson(out);
+        written &= fputs("}", out) >= 0;
+    }
+    written &= listing || fputs("\n]\n", out) >= 0;
+
+    if (out != stdout) {
+        written &= fclose(out) == 0;
+    }
+    if (!written) {
+        fprintf(stderr, "Could not write the results!\n");
+        return 1;
+    }
+    return failed == 0 ? 0 : 1;
+}
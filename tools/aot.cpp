@@ -0,0 +1,84 @@
+#include <cstdio>
+#include <cstring>
+
+#include "Quirks.h"
+#include "Rom.h"
+#include "Translator.h"
+
+/*
+ * Translates a ROM into C++ source for a dedicated executable, see Translator.h. Build the output
+ * together with Chip8Emu_lib, e.g. through chip8_translate_rom() in tools/CMakeLists.txt.
+ */
+
+int main(int argc, char **argv) {
+    const char *out_path = nullptr;
+    const char *rom_path = nullptr;
+    const char *quirks_name = nullptr;
+    QuirkDatabase quirks_db;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (strcmp(argv[i], "--quirks") == 0 && i + 1 < argc) {
+            quirks_name = argv[++i];
+        } else if (strcmp(argv[i], "--quirks-db") == 0 && i + 1 < argc) {
+            if (!quirks_db.load(argv[++i])) {
+                fprintf(stderr, "Could not read the quirk database %s\n", argv[i]);
+                return 1;
+            }
+        } else if (argv[i][0] != '-' && rom_path == nullptr) {
+            rom_path = argv[i];
+        } else {
+            rom_path = nullptr;
+            break;
+        }
+    }
+
+    if (rom_path == nullptr) {
+        printf("Usage: %s [-o file] [--quirks vip|schip|modern] [--quirks-db file] rom-file\n"
+               "  -o            where to write the C++ source (default: standard output)\n"
+               "  --quirks      the quirk profile to run under (default: from the database or the rom's opcodes)\n"
+               "  --quirks-db   known roms and their quirk profiles\n", argv[0]);
+        return 1;
+    }
+
+    RomFile rom;
+    if (!rom.open(rom_path)) {
+        fprintf(stderr, "Could not read %s: %s\n", rom_path, rom.error());
+        return 1;
+    }
+
+    QuirkProfile quirks = quirks_db.select(rom.data(), rom.size());
+    if (quirks_name != nullptr && !parseQuirkProfile(quirks_name, quirks)) {
+        fprintf(stderr, "Unknown quirk profile %s\n", quirks_name);
+        return 1;
+    }
+
+    Translator translator;
+    if (!translator.translate(rom.data(), rom.size(), quirks)) {
+        fprintf(stderr, "Could not translate %s: it is empty or does not fit in memory\n", rom_path);
+        return 1;
+    }
+
+    FILE *out = out_path != nullptr ? fopen(out_path, "w") : stdout;
+    if (out == nullptr) {
+        fprintf(stderr, "Could not write %s\n", out_path);
+        return 1;
+    }
+    bool written = translator.write(out, rom_path);
+    if (out != stdout) {
+        written &= fclose(out) == 0;
+    }
+    if (!written) {
+        fprintf(stderr, "Could not write %s\n", out_path != nullptr ? out_path : "the output");
+        return 1;
+    }
+
+    size_t instructions = 0;
+    for (auto &block : translator.blocks()) {
+        instructions += block.length;
+    }
+    fprintf(stderr, "%s (%s): %zu of %zu reachable instructions translated into %zu blocks, %zu blocks may be modified\n",
+            rom_path, quirkProfileName(quirks), instructions, translator.analysis().instructions().size(), translator.blocks().size(),
+            translator.skippedBlocks().size());
+    return 0;
+}
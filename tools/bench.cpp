@@ -0,0 +1,240 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "Machine.h"
+
+/*
+ * Every allocation made by the process is counted, so a case reports the allocations made while
+ * it was being timed. The hot paths are expected to report 0.
+ */
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+// the replacements below pair malloc and free themselves
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+static std::atomic<uint64_t> allocations(0);
+
+void *operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void *p = std::malloc(size != 0 ? size : 1);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+    std::free(p);
+}
+
+// 8XYN arithmetic and logic on a handful of registers
+static const uint8_t ALU_ROM[] = {
+        0x60, 0x13, // 0x200: V0 = 0x13
+        0x61, 0x07, // 0x202: V1 = 0x07
+        0x80, 0x14, // 0x204: V0 += V1
+        0x81, 0x05, // 0x206: V1 -= V0
+        0x82, 0x01, // 0x208: V2 |= V0
+        0x83, 0x12, // 0x20A: V3 &= V1
+        0x84, 0x23, // 0x20C: V4 ^= V2
+        0x85, 0x46, // 0x20E: V5 >>= 1
+        0x86, 0x57, // 0x210: V6 = V5 - V6
+        0x87, 0x6E, // 0x212: V7 <<= 1
+        0x88, 0x70, // 0x214: V8 = V7
+        0x12, 0x04, // 0x216: Jump to 0x204
+};
+
+// subroutine calls, returns and conditional skips
+static const uint8_t BRANCH_ROM[] = {
+        0x22, 0x08, // 0x200: Call 0x208
+        0x30, 0x00, // 0x202: Skip if V0 == 0
+        0x71, 0x01, // 0x204: V1 += 1
+        0x12, 0x00, // 0x206: Jump to 0x200
+        0x70, 0x01, // 0x208: V0 += 1
+        0x40, 0x80, // 0x20A: Skip if V0 != 0x80
+        0x60, 0x00, // 0x20C: V0 = 0
+        0x00, 0xEE, // 0x20E: Return
+};
+
+// 15 row sprites drawn at positions moving across the screen
+static const uint8_t DRAW_ROM[] = {
+        0xA2, 0x10, // 0x200: I = 0x210
+        0xD0, 0x1F, // 0x202: Draw 15 rows at (V0, V1)
+        0x70, 0x05, // 0x204: V0 += 5
+        0x71, 0x03, // 0x206: V1 += 3
+        0x12, 0x02, // 0x208: Jump to 0x202
+        0x00, 0x00,
+        0x00, 0x00,
+        0x00, 0x00,
+        0xFF, 0x81, 0xBD, 0xA5, 0xA5, 0xBD, 0x81, 0xFF, // 0x210: sprite
+        0x18, 0x3C, 0x7E, 0xFF, 0x7E, 0x3C, 0x18,
+};
+
+// BCD conversion and register block stores and loads
+static const uint8_t MEMORY_ROM[] = {
+        0xA3, 0x00, // 0x200: I = 0x300
+        0x79, 0x07, // 0x202: V9 += 7
+        0xF9, 0x33, // 0x204: BCD of V9 at I
+        0xF8, 0x55, // 0x206: Store V0-V8 at I
+        0xF8, 0x65, // 0x208: Load V0-V8 from I
+        0x12, 0x02, // 0x20A: Jump to 0x202
+};
+
+struct Result {
+    std::string name;
+    const char *unit;
+    uint64_t ops;
+    double seconds;
+    uint64_t allocations;
+};
+
+/**
+ * Calls body(ops) with doubling op counts until one call takes min_seconds, and returns that call
+ */
+static Result measure(const char *name, const char *unit, double min_seconds, const std::function<void(uint64_t)> &body) {
+    Result result{name, unit, 0, 0, 0};
+    for (uint64_t ops = 1000;; ops *= 2) {
+        uint64_t before = allocations.load(std::memory_order_relaxed);
+        auto start = std::chrono::steady_clock::now();
+        body(ops);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        result.ops = ops;
+        result.seconds = seconds;
+        result.allocations = allocations.load(std::memory_order_relaxed) - before;
+        if (seconds >= min_seconds) {
+            return result;
+        }
+    }
+}
+
+static Result runRom(const char *name, const uint8_t *rom, size_t size, double min_seconds) {
+    std::unique_ptr<Machine> machine(new Machine());
+    machine->loadRom(rom, size);
+    machine->cpu.seed(1);
+    // warm up the decode cache, and the block cache when built with CHIP8_JIT
+    machine->cpu.run(1000);
+
+    return measure(name, "instruction", min_seconds, [&machine](uint64_t ops) {
+        machine->cpu.run(ops);
+    });
+}
+
+static Result runArgb(double min_seconds) {
+    std::unique_ptr<Machine> machine(new Machine());
+    for (int y = 0; y < Graphics::HEIGHT; ++y) {
+        machine->graphics.rows[y] = 0x0123456789ABCDEFull * (y + 1);
+    }
+    std::vector<uint32_t> pixels(Graphics::WIDTH * Graphics::HEIGHT);
+
+    return measure("argb", "frame", min_seconds, [&machine, &pixels](uint64_t ops) {
+        for (uint64_t i = 0; i < ops; ++i) {
+            machine->graphics.toARGB(pixels.data());
+        }
+    });
+}
+
+static void usage(const char *name) {
+    printf("Usage: %s [-t seconds] [-o json-file] [case...]\n"
+           "  -t  minimum measured time per case (default: 0.5)\n"
+           "  -o  write the results as JSON to json-file instead of stdout\n"
+           "  cases: alu, branch, draw, memory, argb (default: all)\n", name);
+}
+
+int main(int argc, char **argv) {
+    double min_seconds = 0.5;
+    const char *output = nullptr;
+    std::vector<std::string> cases;
+
+    for (int i = 1; i < argc; ++i) {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "-t") == 0 && has_value) {
+            min_seconds = strtod(argv[++i], nullptr);
+        } else if (strcmp(argv[i], "-o") == 0 && has_value) {
+            output = argv[++i];
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else {
+            cases.emplace_back(argv[i]);
+        }
+    }
+
+    auto selected = [&cases](const char *name) {
+        return cases.empty() || std::find(cases.begin(), cases.end(), name) != cases.end();
+    };
+
+    std::vector<Result> results;
+    if (selected("alu")) {
+        results.push_back(runRom("alu", ALU_ROM, sizeof(ALU_ROM), min_seconds));
+    }
+    if (selected("branch")) {
+        results.push_back(runRom("branch", BRANCH_ROM, sizeof(BRANCH_ROM), min_seconds));
+    }
+    if (selected("draw")) {
+        results.push_back(runRom("draw", DRAW_ROM, sizeof(DRAW_ROM), min_seconds));
+    }
+    if (selected("memory")) {
+        results.push_back(runRom("memory", MEMORY_ROM, sizeof(MEMORY_ROM), min_seconds));
+    }
+    if (selected("argb")) {
+        results.push_back(runArgb(min_seconds));
+    }
+
+    FILE *json = output != nullptr ? fopen(output, "w") : stdout;
+    if (json == nullptr) {
+        fprintf(stderr, "%s could not be opened!\n", output);
+        return 1;
+    }
+
+#ifdef CHIP8_JIT
+    const bool jit = true;
+#else
+    const bool jit = false;
+#endif
+
+    fprintf(json, "{\n  \"jit\": %s,\n  \"trace_level\": %d,\n  \"results\": [\n", jit ? "true" : "false", CHIP8_TRACE_LEVEL);
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result &result = results[i];
+        double per_second = result.ops / result.seconds;
+        fprintf(json, "    {\"name\": \"%s\", \"unit\": \"%s\", \"ops\": %llu, \"seconds\": %.6f, "
+                      "\"ops_per_second\": %.0f, \"ns_per_op\": %.3f, \"allocations\": %llu}%s\n",
+                result.name.c_str(), result.unit, (unsigned long long) result.ops, result.seconds,
+                per_second, 1e9 / per_second, (unsigned long long) result.allocations,
+                i + 1 < results.size() ? "," : "");
+
+        fprintf(stderr, "%-8s %14.0f %ss/s %10.3f ns/op %6llu allocations\n", result.name.c_str(), per_second,
+                result.unit, 1e9 / per_second, (unsigned long long) result.allocations);
+    }
+    fprintf(json, "  ]\n}\n");
+
+    if (json != stdout) {
+        fclose(json);
+    }
+    return 0;
+}
@@ -0,0 +1,388 @@
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "FrameStream.h"
+#include "Image.h"
+#include "Machine.h"
+#include "Quirks.h"
+#include "Rom.h"
+#include "Scheduler.h"
+#include "ThreadPool.h"
+
+/*
+ * Every ROM has a golden file next to it, <rom-file>.golden, holding the script it is run with
+ * and the expected framebuffer hashes:
+ *
+ *   chip8-golden 1
+ *   seed 1
+ *   cycles-per-frame 10
+ *   quirks schip
+ *   press 1000 7
+ *   release 1100 7
+ *   checkpoint 6000 0123456789abcdef
+ *
+ * Keys are pressed and released before the instruction at the given cycle; a checkpoint hashes the
+ * screen shown after that many instructions, in whichever mode it is. The quirk profile the hashes
+ * were recorded under is kept too; files without one run under the profile QuirkDatabase::select()
+ * picks. <rom-file>.c8fs keeps the expected frames themselves, so a mismatch can be shown as a diff image.
+ */
+
+static const char GOLDEN_HEADER[] = "chip8-golden 1";
+
+// one, ten and a hundred seconds of emulated time at the default clock
+static const uint64_t DEFAULT_CHECKPOINTS[] = {600, 6000, 60000};
+
+struct Step {
+    uint64_t cycle;
+    enum Kind : uint8_t { Press, Release, Checkpoint } kind;
+    uint8_t key;
+    uint64_t hash;
+};
+
+struct Golden {
+    uint32_t seed = 1;
+    uint32_t cycles_per_frame = Cpu::DEFAULT_CYCLES_PER_FRAME;
+    bool has_quirks = false;
+    QuirkProfile quirks = QuirkProfile::Modern;
+    std::vector<Step> steps;
+};
+
+struct Result {
+    bool passed = false;
+    std::string message;
+    std::vector<std::string> diffs;
+};
+
+static bool readGolden(const std::string &path, Golden &golden) {
+    FILE *file = fopen(path.c_str(), "r");
+    if (file == nullptr) {
+        return false;
+    }
+
+    char line[256];
+    bool valid = fgets(line, sizeof(line), file) != nullptr && strncmp(line, GOLDEN_HEADER, strlen(GOLDEN_HEADER)) == 0;
+    while (valid && fgets(line, sizeof(line), file) != nullptr) {
+        char word[32];
+        unsigned long long cycle, value = 0;
+        int fields = sscanf(line, "%31s %llu %llx", word, &cycle, &value);
+        if (fields <= 0 || word[0] == '#') {
+            continue;
+        }
+        char name[16];
+        if (strcmp(word, "quirks") == 0) {
+            valid = sscanf(line, "%*s %15s", name) == 1 && parseQuirkProfile(name, golden.quirks);
+            golden.has_quirks = valid;
+        } else if (strcmp(word, "seed") == 0 && fields >= 2) {
+            golden.seed = (uint32_t) cycle;
+        } else if (strcmp(word, "cycles-per-frame") == 0 && fields >= 2 && cycle > 0) {
+            golden.cycles_per_frame = (uint32_t) cycle;
+        } else if ((strcmp(word, "press") == 0 || strcmp(word, "release") == 0) && fields == 3 && value < 16) {
+            golden.steps.push_back(Step{cycle, word[0] == 'p' ? Step::Press : Step::Release, (uint8_t) value, 0});
+        } else if (strcmp(word, "checkpoint") == 0 && fields >= 2) {
+            golden.steps.push_back(Step{cycle, Step::Checkpoint, 0, value});
+        } else {
+            valid = false;
+        }
+    }
+    fclose(file);
+
+    std::stable_sort(golden.steps.begin(), golden.steps.end(), [](const Step &a, const Step &b) {
+        return a.cycle < b.cycle;
+    });
+    return valid;
+}
+
+static bool writeGolden(const std::string &path, const Golden &golden) {
+    FILE *file = fopen(path.c_str(), "w");
+    if (file == nullptr) {
+        return false;
+    }
+
+    bool written = fprintf(file, "%s\nseed %u\ncycles-per-frame %u\nquirks %s\n", GOLDEN_HEADER, golden.seed,
+                           golden.cycles_per_frame, quirkProfileName(golden.quirks)) > 0;
+    for (auto &step : golden.steps) {
+        if (step.kind == Step::Checkpoint) {
+            written &= fprintf(file, "checkpoint %llu %016llx\n", (unsigned long long) step.cycle,
+                               (unsigned long long) step.hash) > 0;
+        } else {
+            written &= fprintf(file, "%s %llu %x\n", step.kind == Step::Press ? "press" : "release",
+                               (unsigned long long) step.cycle, step.key) > 0;
+        }
+    }
+    return fclose(file) == 0 && written;
+}
+
+/**
+ * Hashes the screen's bytes row by row. High resolution screens are hashed with a leading 1, so they
+ * never match a low resolution one.
+ */
+static uint64_t frameHash(const Graphics::Screen &screen) {
+    uint8_t bytes[1 + Graphics::HIRES_HEIGHT * 2 * 8];
+    const uint64_t *words = screen.hires ? screen.hires_rows[0] : screen.rows;
+    size_t count = screen.hires ? Graphics::HIRES_HEIGHT * 2 : Graphics::HEIGHT;
+    uint8_t *out = bytes;
+    if (screen.hires) {
+        *out++ = 1;
+    }
+    for (size_t w = 0; w < count; ++w) {
+        for (int i = 0; i < 8; ++i) {
+            *out++ = (uint8_t) (words[w] >> (56u - 8u * i));
+        }
+    }
+    return romHash(bytes, out - bytes);
+}
+
+/**
+ * The pixel at (x, y) of the 128x64 grid; low resolution pixels cover four of its pixels
+ */
+static unsigned pixel(const Graphics::Screen &screen, int x, int y) {
+    if (screen.hires) {
+        return (unsigned) (screen.hires_rows[y][x / 64] >> (63u - x % 64)) & 1u;
+    }
+    return (unsigned) (screen.rows[y / 2] >> (63u - x / 2)) & 1u;
+}
+
+/**
+ * Reads the frame shown at every checkpoint from a stream of golden frames
+ */
+static bool readFrames(const std::string &path, const Golden &golden, std::vector<Graphics::Screen> &out) {
+    FILE *file = fopen(path.c_str(), "rb");
+    FrameReader reader;
+    if (file == nullptr || !reader.open(file)) {
+        if (file != nullptr) {
+            fclose(file);
+        }
+        return false;
+    }
+
+    // frames only appear in the stream when they changed, so a checkpoint shows the last frame at or before it
+    Graphics::Screen screen{}, next{};
+    uint64_t next_cycle;
+    bool more = reader.next(next_cycle, next);
+    for (auto &step : golden.steps) {
+        if (step.kind != Step::Checkpoint) {
+            continue;
+        }
+        while (more && next_cycle <= step.cycle) {
+            screen = next;
+            more = reader.next(next_cycle, next);
+        }
+        out.push_back(screen);
+    }
+    fclose(file);
+    return true;
+}
+
+/**
+ * Writes a PNG showing pixels set in both frames white, only in the expected frame red and only in
+ * the actual frame green. Frames of either mode are drawn at the same size, so they can be compared.
+ */
+static bool writeDiff(const std::string &path, const Graphics::Screen &expected, const Graphics::Screen &actual) {
+    const int scale = 4;
+    IndexedImage image{Graphics::HIRES_WIDTH * scale, Graphics::HIRES_HEIGHT * scale,
+                       {0x000000, 0xFFFFFF, 0xFF0000, 0x00FF00}, {}};
+    image.pixels.resize((size_t) image.width * image.height);
+    for (int y = 0; y < image.height; ++y) {
+        for (int x = 0; x < image.width; ++x) {
+            unsigned e = pixel(expected, x / scale, y / scale), a = pixel(actual, x / scale, y / scale);
+            image.pixels[(size_t) y * image.width + x] = (uint8_t) (e && a ? 1 : e ? 2 : a ? 3 : 0);
+        }
+    }
+
+    FILE *file = fopen(path.c_str(), "wb");
+    bool written = file != nullptr && writePng(file, image);
+    return file != nullptr && fclose(file) == 0 && written;
+}
+
+static std::string baseName(const std::string &path) {
+    size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+/**
+ * Runs a rom against its golden file, or records a new one with update. forced, if not null, overrides
+ * the quirk profile the golden file was recorded under.
+ */
+static Result check(const std::string &rom_path, bool update, const std::string &diff_dir,
+                    const QuirkProfile *forced, const QuirkDatabase &quirks_db) {
+    Result result;
+    const std::string golden_path = rom_path + ".golden", frames_path = rom_path + ".c8fs";
+
+    Golden golden;
+    if (!readGolden(golden_path, golden)) {
+        FILE *existing = fopen(golden_path.c_str(), "r");
+        if (existing != nullptr) {
+            fclose(existing);
+            result.message = golden_path + " is not a valid golden file";
+            return result;
+        }
+        if (!update) {
+            result.message = "no golden file, run with --update to create one";
+            return result;
+        }
+        for (uint64_t cycle : DEFAULT_CHECKPOINTS) {
+            golden.steps.push_back(Step{cycle, Step::Checkpoint, 0, 0});
+        }
+    }
+
+    RomFile rom;
+    if (!rom.open(rom_path.c_str())) {
+        result.message = std::string("rom ") + rom.error();
+        return result;
+    }
+    if (forced != nullptr) {
+        golden.quirks = *forced;
+    } else if (!golden.has_quirks) {
+        golden.quirks = quirks_db.select(rom.data(), rom.size());
+    }
+
+    std::unique_ptr<Machine> machine(new Machine());
+    machine->loadRom(rom.data(), rom.size());
+    machine->cpu.setQuirks(golden.quirks);
+    machine->cpu.seed(golden.seed);
+    machine->cpu.setCyclesPerFrame(golden.cycles_per_frame);
+
+    FILE *frames_file = update ? fopen(frames_path.c_str(), "wb") : nullptr;
+    FrameRecorder recorder;
+    if (frames_file != nullptr) {
+        recorder.open(frames_file, Scheduler::FRAME_RATE * golden.cycles_per_frame);
+    }
+
+    std::vector<Graphics::Screen> expected_frames;
+    bool have_frames = !update && readFrames(frames_path, golden, expected_frames);
+
+    Cpu &cpu = machine->cpu;
+    size_t checkpoint = 0, mismatches = 0;
+    for (auto &step : golden.steps) {
+        if (step.cycle > cpu.cycles && isFault(cpu.run(step.cycle - cpu.cycles))) {
+            char message[96];
+            snprintf(message, sizeof(message), "fault at pc %03x, cycle %" PRIu64 ", before cycle %" PRIu64,
+                     cpu.pc, cpu.cycles, step.cycle);
+            result.message = message;
+            break;
+        }
+
+        if (step.kind == Step::Press) {
+            machine->input.onKeyDown(step.key);
+        } else if (step.kind == Step::Release) {
+            machine->input.onKeyUp(step.key);
+        } else {
+            Graphics::Screen screen;
+            machine->graphics.copyTo(screen);
+            uint64_t hash = frameHash(screen);
+            if (update) {
+                step.hash = hash;
+                recorder.capture(machine->graphics, cpu.cycles);
+            } else if (hash != step.hash) {
+                mismatches++;
+                char message[96];
+                snprintf(message, sizeof(message), "%scycle %" PRIu64 ": %016" PRIx64 " != %016" PRIx64,
+                         mismatches > 1 ? "; " : "", step.cycle, hash, step.hash);
+                result.message += message;
+                if (have_frames) {
+                    std::string diff = diff_dir + "/" + baseName(rom_path) + "-" + std::to_string(step.cycle) + ".png";
+                    if (writeDiff(diff, expected_frames[checkpoint], screen)) {
+                        result.diffs.push_back(diff);
+                    }
+                }
+            }
+            checkpoint++;
+        }
+    }
+
+    if (frames_file != nullptr) {
+        recorder.flush();
+        fclose(frames_file);
+    }
+    if (update && result.message.empty() && !writeGolden(golden_path, golden)) {
+        result.message = "could not write " + golden_path;
+    }
+    result.passed = result.message.empty();
+    return result;
+}
+
+static void usage(const char *name) {
+    printf("Usage: %s [--update] [-j threads] [--diff directory] [--quirks vip|schip|modern] [--quirks-db file]\n"
+           "          rom-file...\n"
+           "  --update     record the current hashes as golden, creating golden files where missing\n"
+           "  -j           worker threads (default: one per hardware thread)\n"
+           "  --diff       where to write diff images of mismatching frames (default: .)\n"
+           "  --quirks     run every rom under this quirk profile (default: the one recorded in its golden file,\n"
+           "               else from the database or the rom's opcodes)\n"
+           "  --quirks-db  known roms and their quirk profiles\n", name);
+}
+
+int main(int argc, char **argv) {
+    bool update = false;
+    unsigned threads = 0;
+    std::string diff_dir = ".";
+    const char *quirks_name = nullptr;
+    QuirkDatabase quirks_db;
+    std::vector<std::string> roms;
+
+    for (int i = 1; i < argc; ++i) {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--update") == 0) {
+            update = true;
+        } else if (strcmp(argv[i], "-j") == 0 && has_value) {
+            threads = (unsigned) strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--diff") == 0 && has_value) {
+            diff_dir = argv[++i];
+        } else if (strcmp(argv[i], "--quirks") == 0 && has_value) {
+            quirks_name = argv[++i];
+        } else if (strcmp(argv[i], "--quirks-db") == 0 && has_value) {
+            if (!quirks_db.load(argv[++i])) {
+                fprintf(stderr, "Could not read the quirk database %s\n", argv[i]);
+                return 1;
+            }
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else {
+            roms.emplace_back(argv[i]);
+        }
+    }
+
+    if (roms.empty()) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    QuirkProfile forced_quirks = QuirkProfile::Modern;
+    if (quirks_name != nullptr && !parseQuirkProfile(quirks_name, forced_quirks)) {
+        fprintf(stderr, "Unknown quirk profile %s\n", quirks_name);
+        return 1;
+    }
+    const QuirkProfile *forced = quirks_name != nullptr ? &forced_quirks : nullptr;
+    std::sort(roms.begin(), roms.end());
+
+    std::vector<Result> results(roms.size());
+    {
+        ThreadPool pool(threads);
+        for (size_t i = 0; i < roms.size(); ++i) {
+            pool.submit([&results, &roms, update, &diff_dir, forced, &quirks_db, i] {
+                results[i] = check(roms[i], update, diff_dir, forced, quirks_db);
+            });
+        }
+        pool.wait();
+    }
+
+    size_t failed = 0;
+    for (size_t i = 0; i < roms.size(); ++i) {
+        const Result &result = results[i];
+        printf("%-6s %s%s%s\n", result.passed ? (update ? "update" : "ok") : "FAIL", roms[i].c_str(),
+               result.passed ? "" : ": ", result.message.c_str());
+        for (auto &diff : result.diffs) {
+            printf("       diff: %s\n", diff.c_str());
+        }
+        failed += result.passed ? 0 : 1;
+    }
+    printf("%zu of %zu roms passed\n", roms.size() - failed, roms.size());
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,131 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "FrameStream.h"
+#include "Image.h"
+
+/**
+ * Renders a frame at the size of the high resolution screen if hires_size is set, so streams that
+ * switch modes keep one image size, and at the size of its own mode otherwise
+ */
+static IndexedImage render(const Graphics::Screen &screen, bool hires_size, int scale) {
+    if (screen.hires) {
+        return renderRows(screen.hires_rows, Graphics::HIRES_WIDTH, Graphics::HIRES_HEIGHT, scale);
+    }
+    return renderRows(screen.rows, Graphics::WIDTH, Graphics::HEIGHT, hires_size ? 2 * scale : scale);
+}
+
+static void usage(const char *name) {
+    printf("Usage: %s (--gif out.gif | --png prefix) [--scale n] frame-stream\n"
+           "  --gif    write an animated gif\n"
+           "  --png    write every frame to <prefix><frame>.png, e.g. <prefix>00042.png\n"
+           "  --scale  pixels per emulated pixel (default: 8), per 128x64 pixel in streams using that mode\n", name);
+}
+
+int main(int argc, char **argv) {
+    const char *gif_path = nullptr;
+    const char *png_prefix = nullptr;
+    const char *path = nullptr;
+    int scale = 8;
+
+    for (int i = 1; i < argc; ++i) {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--gif") == 0 && has_value) {
+            gif_path = argv[++i];
+        } else if (strcmp(argv[i], "--png") == 0 && has_value) {
+            png_prefix = argv[++i];
+        } else if (strcmp(argv[i], "--scale") == 0 && has_value) {
+            scale = atoi(argv[++i]);
+        } else if (argv[i][0] != '-' && path == nullptr) {
+            path = argv[i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (path == nullptr || (gif_path == nullptr) == (png_prefix == nullptr) || scale < 1 || scale > 64) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    FILE *file = fopen(path, "rb");
+    if (file == nullptr) {
+        fprintf(stderr, "%s could not be opened!\n", path);
+        return 1;
+    }
+    FrameReader reader;
+    if (!reader.open(file)) {
+        fprintf(stderr, "%s is not a frame stream of this version!\n", path);
+        fclose(file);
+        return 1;
+    }
+
+    // a first pass finds out whether any frame needs the high resolution size
+    uint64_t cycle;
+    Graphics::Screen screen{};
+    bool hires = false;
+    while (!hires && reader.next(cycle, screen)) {
+        hires = screen.hires;
+    }
+    rewind(file);
+    reader.open(file);
+    screen = Graphics::Screen{};
+
+    uint64_t frames = 0;
+    bool written = true;
+
+    if (png_prefix != nullptr) {
+        while (written && reader.next(cycle, screen)) {
+            char name[16];
+            snprintf(name, sizeof(name), "%05llu.png", (unsigned long long) frames++);
+            std::string out_path = std::string(png_prefix) + name;
+            FILE *out = fopen(out_path.c_str(), "wb");
+            written = out != nullptr && writePng(out, render(screen, hires, scale));
+            written = out != nullptr && fclose(out) == 0 && written;
+        }
+    } else {
+        FILE *out = fopen(gif_path, "wb");
+        GifWriter gif;
+        IndexedImage image = render(screen, hires, scale);
+        written = out != nullptr && gif.open(out, image.width, image.height, image.palette);
+
+        // a frame is shown until the next one; delays are in hundredths of a second, so the
+        // rounding error is carried over instead of accumulating
+        double cycles_per_centisecond = reader.cyclesPerSecond() / 100.0;
+        bool pending = written && reader.next(cycle, screen);
+        double carried = 0;
+        while (pending) {
+            image = render(screen, hires, scale);
+            uint64_t shown_at = cycle;
+            pending = reader.next(cycle, screen);
+
+            uint16_t delay = 2;
+            if (pending && cycles_per_centisecond > 0) {
+                double exact = (cycle - shown_at) / cycles_per_centisecond + carried;
+                double rounded = exact < 65535 ? (double) (long long) (exact + 0.5) : 65535;
+                carried = exact - rounded;
+                delay = (uint16_t) rounded;
+            }
+            if (delay == 0) {
+                // replaced within the same hundredth; most viewers would stretch a 0 delay instead
+                continue;
+            }
+            written = gif.addFrame(image, delay);
+            pending = pending && written;
+            frames++;
+        }
+        written = out != nullptr && written && gif.close();
+        written = out != nullptr && fclose(out) == 0 && written;
+    }
+    fclose(file);
+
+    if (!written) {
+        fprintf(stderr, "Could not write %s!\n", gif_path != nullptr ? gif_path : png_prefix);
+        return 1;
+    }
+    fprintf(stderr, "%llu frames written\n", (unsigned long long) frames);
+    return 0;
+}
@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "FrameStream.h"
+#include "Machine.h"
+#include "Profiler.h"
+#include "Quirks.h"
+#include "Rom.h"
+#include "Scheduler.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+
+struct Instance {
+    size_t rom;
+    uint32_t seed;
+    uint64_t instructions;
+    double seconds;
+    State state;
+
+    /**
+     * Set if its trace or frames file could not be opened, in which case it did not run
+     */
+    bool failed;
+};
+
+static const char *stateName(State state) {
+    switch (state) {
+        case State::Running:
+            return "running";
+        case State::WaitingForKey:
+            return "waiting-for-key";
+        case State::PcOutOfBounds:
+            return "fault-pc-out-of-bounds";
+        case State::StackOverflow:
+            return "fault-stack-overflow";
+        case State::StackUnderflow:
+            return "fault-stack-underflow";
+    }
+    return "unknown";
+}
+
+static void writeProfile(const Profiler &profiler, const std::string &prefix) {
+    FILE *file;
+    if ((file = fopen((prefix + ".txt").c_str(), "w")) != nullptr) {
+        profiler.writeReport(file);
+        fclose(file);
+    }
+    if ((file = fopen((prefix + ".json").c_str(), "w")) != nullptr) {
+        profiler.writeJson(file);
+        fclose(file);
+    }
+    if ((file = fopen((prefix + ".folded").c_str(), "w")) != nullptr) {
+        profiler.writeCollapsed(file);
+        fclose(file);
+    }
+}
+
+static void usage(const char *name) {
+    printf("Usage: %s [-n instances] [-c cycles] [-j threads] [-s seed] [-t trace-prefix] [-r frames-prefix]\n"
+           "          [-p profile-prefix] [--quirks vip|schip|modern] [--quirks-db file] [-q] rom-file...\n"
+           "  -n  number of emulator instances, assigned to the roms round-robin (default: one per rom)\n"
+           "  -c  instructions executed by every instance (default: 1000000)\n"
+           "  -j  worker threads (default: one per hardware thread)\n"
+           "  -s  seed of the first instance; instance i uses seed + i (default: 1)\n"
+           "  -t  write the trace of instance i to <trace-prefix><i>.trace; needs CHIP8_TRACE_LEVEL > 0\n"
+           "  -r  record the frames of instance i to <frames-prefix><i>.c8fs\n"
+           "  -p  write the profile of instance i to <profile-prefix><i>.txt, .json and .folded; needs CHIP8_PROFILE\n"
+           "  -q  only print the totals\n"
+           "  --quirks     run every rom under this quirk profile (default: from the database or the rom's opcodes)\n"
+           "  --quirks-db  known roms and their quirk profiles\n", name);
+}
+
+int main(int argc, char **argv) {
+    size_t instance_count = 0;
+    uint64_t cycles = 1000000;
+    unsigned threads = 0;
+    uint32_t seed = 1;
+    bool quiet = false;
+    const char *trace_prefix = nullptr;
+    const char *frames_prefix = nullptr;
+    const char *profile_prefix = nullptr;
+    const char *quirks_name = nullptr;
+    QuirkDatabase quirks_db;
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; ++i) {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "-n") == 0 && has_value) {
+            instance_count = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "-c") == 0 && has_value) {
+            cycles = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "-j") == 0 && has_value) {
+            threads = (unsigned) strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "-s") == 0 && has_value) {
+            seed = (uint32_t) strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "-t") == 0 && has_value) {
+            trace_prefix = argv[++i];
+        } else if (strcmp(argv[i], "-r") == 0 && has_value) {
+            frames_prefix = argv[++i];
+        } else if (strcmp(argv[i], "-p") == 0 && has_value) {
+            profile_prefix = argv[++i];
+        } else if (strcmp(argv[i], "--quirks") == 0 && has_value) {
+            quirks_name = argv[++i];
+        } else if (strcmp(argv[i], "--quirks-db") == 0 && has_value) {
+            if (!quirks_db.load(argv[++i])) {
+                fprintf(stderr, "Could not read the quirk database %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-q") == 0) {
+            quiet = true;
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else {
+            paths.emplace_back(argv[i]);
+        }
+    }
+
+    if (paths.empty()) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    QuirkProfile forced_quirks = QuirkProfile::Modern;
+    if (quirks_name != nullptr && !parseQuirkProfile(quirks_name, forced_quirks)) {
+        fprintf(stderr, "Unknown quirk profile %s\n", quirks_name);
+        return 1;
+    }
+
+    std::vector<std::vector<uint8_t>> roms;
+    std::vector<QuirkProfile> quirks;
+    for (auto &path : paths) {
+        RomFile file;
+        if (!file.open(path.c_str())) {
+            fprintf(stderr, "%s %s!\n", path.c_str(), file.error());
+            return 1;
+        }
+        roms.emplace_back(file.data(), file.data() + file.size());
+        quirks.push_back(quirks_name != nullptr ? forced_quirks : quirks_db.select(file.data(), file.size()));
+    }
+
+    if (instance_count == 0) {
+        instance_count = roms.size();
+    }
+
+    std::vector<Instance> instances(instance_count);
+    for (size_t i = 0; i < instance_count; ++i) {
+        instances[i].rom = i % roms.size();
+        instances[i].seed = seed + (uint32_t) i;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    {
+        ThreadPool pool(threads);
+        for (size_t i = 0; i < instances.size(); ++i) {
+            Instance &instance = instances[i];
+            pool.submit([&instance, &roms, &quirks, cycles, trace_prefix, frames_prefix, profile_prefix, i] {
+                auto begin = std::chrono::steady_clock::now();
+
+                std::unique_ptr<Machine> machine(new Machine());
+                const std::vector<uint8_t> &rom = roms[instance.rom];
+                machine->loadRom(rom.data(), rom.size());
+                machine->cpu.setQuirks(quirks[instance.rom]);
+                machine->cpu.seed(instance.seed);
+                std::unique_ptr<Profiler> profiler;
+                if (profile_prefix != nullptr) {
+                    profiler.reset(new Profiler());
+                    machine->cpu.setProfiler(profiler.get());
+                }
+
+                if (trace_prefix == nullptr && frames_prefix == nullptr) {
+                    instance.state = machine->cpu.run(cycles);
+                } else {
+                    // run in slices small enough for the trace ring, draining it in between;
+                    // frames are recorded once per emulated frame, as they would be presented
+                    FILE *trace_file = nullptr;
+                    TraceBuffer trace;
+                    if (trace_prefix != nullptr) {
+                        std::string path = std::string(trace_prefix) + std::to_string(i) + ".trace";
+                        trace_file = fopen(path.c_str(), "wb");
+                        if (trace_file == nullptr || !TraceBuffer::writeHeader(trace_file)) {
+                            fprintf(stderr, "Could not write %s!\n", path.c_str());
+                            instance.failed = true;
+                        }
+                        machine->cpu.setTraceBuffer(&trace);
+                    }
+                    FILE *frames_file = nullptr;
+                    FrameRecorder recorder;
+                    uint64_t slice_size = 1u << 15u;
+                    if (frames_prefix != nullptr && !instance.failed) {
+                        std::string path = std::string(frames_prefix) + std::to_string(i) + ".c8fs";
+                        frames_file = fopen(path.c_str(), "wb");
+                        slice_size = machine->cpu.cyclesPerFrame();
+                        if (frames_file == nullptr
+                            || !recorder.open(frames_file, Scheduler::FRAME_RATE * machine->cpu.cyclesPerFrame())) {
+                            fprintf(stderr, "Could not write %s!\n", path.c_str());
+                            instance.failed = true;
+                        } else {
+                            recorder.capture(machine->graphics, 0);
+                        }
+                    }
+
+                    uint64_t remaining = instance.failed ? 0 : cycles;
+                    instance.state = State::Running;
+                    while (remaining > 0 && !isFault(instance.state)) {
+                        uint64_t slice = std::min<uint64_t>(remaining, slice_size);
+                        instance.state = machine->cpu.run(slice);
+                        if (trace_file != nullptr) {
+                            trace.write(trace_file);
+                        }
+                        if (frames_file != nullptr && machine->graphics.isDirty()) {
+                            recorder.capture(machine->graphics, machine->cpu.cycles);
+                            machine->graphics.clearDirty();
+                        }
+                        remaining -= slice;
+                    }
+                    if (trace_file != nullptr) {
+                        fclose(trace_file);
+                    }
+                    if (frames_file != nullptr) {
+                        recorder.flush();
+                        fclose(frames_file);
+                    }
+                }
+                if (profiler) {
+                    writeProfile(*profiler, std::string(profile_prefix) + std::to_string(i));
+                }
+                instance.instructions = machine->cpu.cycles;
+                instance.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+            });
+        }
+        pool.wait();
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    uint64_t total = 0;
+    size_t faults = 0, failures = 0;
+    if (!quiet) {
+        printf("instance,rom,seed,instructions,seconds,instructions_per_second,state\n");
+    }
+    for (size_t i = 0; i < instances.size(); ++i) {
+        const Instance &instance = instances[i];
+        total += instance.instructions;
+        faults += isFault(instance.state) ? 1 : 0;
+        failures += instance.failed ? 1 : 0;
+        if (!quiet) {
+            printf("%zu,%s,%u,%llu,%.6f,%.0f,%s\n", i, paths[instance.rom].c_str(), instance.seed,
+                   (unsigned long long) instance.instructions, instance.seconds,
+                   instance.seconds > 0 ? instance.instructions / instance.seconds : 0.0,
+                   instance.failed ? "error-output" : stateName(instance.state));
+        }
+    }
+
+    fprintf(stderr, "%zu instances, %zu faulted, %llu instructions in %.3f s: %.0f instructions/s\n",
+            instances.size(), faults, (unsigned long long) total, elapsed, elapsed > 0 ? total / elapsed : 0.0);
+    if (failures > 0) {
+        fprintf(stderr, "%zu instances could not write their output\n", failures);
+        return 1;
+    }
+    return 0;
+}
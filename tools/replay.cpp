@@ -0,0 +1,47 @@
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <memory>
+
+#include "InputLog.h"
+#include "Machine.h"
+#include "Rom.h"
+#include "Scheduler.h"
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        printf("Usage: %s input-log rom-file\n", argv[0]);
+        return 1;
+    }
+
+    InputLog log;
+    if (!log.load(argv[1])) {
+        fprintf(stderr, "%s is not an input log of this version!\n", argv[1]);
+        return 1;
+    }
+    RomFile rom;
+    if (!rom.open(argv[2])) {
+        fprintf(stderr, "%s %s!\n", argv[2], rom.error());
+        return 1;
+    }
+    if (rom.hash() != log.romHash()) {
+        fprintf(stderr, "%s (%016" PRIx64 ") is not the rom the log was recorded with (%016" PRIx64 ")!\n",
+                argv[2], rom.hash(), log.romHash());
+        return 1;
+    }
+
+    std::unique_ptr<Machine> machine(new Machine());
+    machine->loadRom(rom.data(), rom.size());
+
+    auto begin = std::chrono::steady_clock::now();
+    State state = replay(log, *machine);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    uint64_t hash = machine->stateHash();
+    uint64_t frames = log.endCycle() / log.cyclesPerFrame();
+    printf("%zu events, %" PRIu64 " cycles (%.1f s of emulated time) in %.3f s%s\n", log.events().size(),
+           machine->cpu.cycles, (double) frames / Scheduler::FRAME_RATE, seconds, isFault(state) ? ", ended in a fault" : "");
+    printf("final state %016" PRIx64 ", recorded %016" PRIx64 ": %s\n", hash, log.finalHash(),
+           hash == log.finalHash() ? "match" : "MISMATCH");
+    return hash == log.finalHash() ? 0 : 2;
+}
@@ -0,0 +1,103 @@
+#include <cstdio>
+#include <cstring>
+
+#include "Analyzer.h"
+#include "Rom.h"
+#include "Trace.h"
+
+static const char *kindName(uint8_t kind) {
+    switch ((TraceKind) kind) {
+        case TraceKind::Instruction:
+            return "instruction";
+        case TraceKind::UnknownOpcode:
+            return "unknown-opcode";
+        case TraceKind::Fault:
+            return "fault";
+    }
+    return "?";
+}
+
+int main(int argc, char **argv) {
+    bool csv = false;
+    const char *path = nullptr;
+    const char *rom_path = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--csv") == 0) {
+            csv = true;
+        } else if (strcmp(argv[i], "--rom") == 0 && i + 1 < argc) {
+            rom_path = argv[++i];
+        } else {
+            path = argv[i];
+        }
+    }
+
+    if (path == nullptr) {
+        printf("Usage: %s [--csv] [--rom rom-file] trace-file\n"
+               "  --rom  annotate instructions with their disassembly, and flag those the static\n"
+               "         analysis of rom-file did not find to be code\n", argv[0]);
+        return 1;
+    }
+
+    Analysis analysis;
+    if (rom_path != nullptr) {
+        RomFile rom;
+        if (!rom.open(rom_path)) {
+            fprintf(stderr, "%s %s!\n", rom_path, rom.error());
+            return 1;
+        }
+        analysis.analyze(rom.data(), rom.size());
+    }
+
+    FILE *file = fopen(path, "rb");
+    if (file == nullptr) {
+        fprintf(stderr, "%s could not be opened!\n", path);
+        return 1;
+    }
+    if (!TraceBuffer::readHeader(file)) {
+        fprintf(stderr, "%s is not a trace file of this version!\n", path);
+        fclose(file);
+        return 1;
+    }
+
+    if (csv) {
+        printf("cycle,kind,detail,pc,opcode,i");
+        for (int r = 0; r < 16; ++r) {
+            printf(",v%X", r);
+        }
+        printf(rom_path != nullptr ? ",text,static_code\n" : "\n");
+    }
+
+    TraceRecord record;
+    char text[32];
+    while (fread(&record, sizeof(record), 1, file) == 1) {
+        if (csv) {
+            printf("%llu,%s,%u,0x%03X,0x%04X,0x%03X", (unsigned long long) record.cycle, kindName(record.kind),
+                   record.detail, record.pc, record.opcode, record.instruction_register);
+            for (uint8_t v : record.data_registers) {
+                printf(",%u", v);
+            }
+            if (rom_path != nullptr) {
+                disassemble(record.opcode, text, sizeof(text));
+                printf(",\"%s\",%d", text, analysis.isInstruction(record.pc) ? 1 : 0);
+            }
+            printf("\n");
+        } else {
+            printf("%10llu  %03X  %04X  I=%03X ", (unsigned long long) record.cycle, record.pc, record.opcode,
+                   record.instruction_register);
+            for (uint8_t v : record.data_registers) {
+                printf(" %02X", v);
+            }
+            if (rom_path != nullptr) {
+                disassemble(record.opcode, text, sizeof(text));
+                printf("  %-16s%s", text, analysis.isInstruction(record.pc) ? "" : " [not static code]");
+            }
+            if (record.kind != (uint8_t) TraceKind::Instruction) {
+                printf("  %s %u", kindName(record.kind), record.detail);
+            }
+            printf("\n");
+        }
+    }
+
+    fclose(file);
+    return 0;
+}